@@ -0,0 +1,48 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef BEDROCKFORMAT_ASYNC_H
+#define BEDROCKFORMAT_ASYNC_H
+
+#include "format.h"
+#include "chunk.h"
+
+#include <stddef.h>
+
+#define ASYNC_LOAD_NONE 0
+#define DEFAULT_PREFETCH_PRIORITY (-1)
+
+typedef unsigned long long AsyncLoadId;
+typedef void (*AsyncLoadCallback)(void* userData, AsyncLoadId id, Result result, Subchunk* subchunk);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+Result StartAsyncLoader(World* world, unsigned int threadCount);
+void StopAsyncLoader(World* world);
+
+Result LoadSubchunkAsync(
+        World* world, int x, unsigned char y, int z, Dimension dimension,
+        int priority, AsyncLoadCallback callback, void* userData, AsyncLoadId* id
+);
+Result PrefetchSubchunks(World* world, const Position* positions, size_t count, int priority, AsyncLoadId* ids);
+void CancelAsyncLoad(World* world, AsyncLoadId id);
+unsigned int PollAsyncLoads(World* world);
+Result WaitAsyncLoad(World* world, AsyncLoadId id, Subchunk** subchunk);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BEDROCKFORMAT_ASYNC_H
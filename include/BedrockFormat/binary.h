@@ -15,24 +15,26 @@
 
 typedef struct ByteStream_T {
     unsigned int position;
+    unsigned int length;
     unsigned char* buffer;
 } ByteStream;
 
 ByteStream* CreateByteStream(unsigned int preAllocated);
 ByteStream* CreateFilledByteStream(unsigned char* data, unsigned int size);
+void InitByteStream(ByteStream* stream, const unsigned char* data, unsigned int size);
 void DestroyByteStream(ByteStream* stream, int freeBuffer);
 
 void WriteByte(ByteStream* stream, unsigned char value);
 void WriteShort(ByteStream* stream, short value);
 void WriteInt(ByteStream* stream, int value);
-void WriteLong(ByteStream* stream, long value);
+void WriteLong(ByteStream* stream, long long value);
 void WriteFloat(ByteStream* stream, float value);
 void WriteDouble(ByteStream* stream, double value);
 
 unsigned char ReadByte(ByteStream* stream);
 short ReadShort(ByteStream* stream);
 int ReadInt(ByteStream* stream);
-long ReadLong(ByteStream* stream);
+long long ReadLong(ByteStream* stream);
 float ReadFloat(ByteStream* stream);
 double ReadDouble(ByteStream* stream);
 
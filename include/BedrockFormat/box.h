@@ -0,0 +1,62 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef BEDROCKFORMAT_BOX_H
+#define BEDROCKFORMAT_BOX_H
+
+#include "format.h"
+#include "chunk.h"
+
+typedef struct BlockBox_T {
+    int minX;
+    int minY;
+    int minZ;
+    int maxX; // Inclusive
+    int maxY; // Inclusive
+    int maxZ; // Inclusive
+} BlockBox;
+
+typedef struct SubchunkSpan_T {
+    Subchunk* subchunk; // NULL if the subchunk does not exist or failed to load
+    int x; // Subchunk coordinates
+    unsigned char y; // Signed like the y byte of subchunk keys
+    int z;
+    unsigned char minX; // Part of the subchunk inside the box, inclusive local coordinates
+    unsigned char minY;
+    unsigned char minZ;
+    unsigned char maxX;
+    unsigned char maxY;
+    unsigned char maxZ;
+} SubchunkSpan;
+
+typedef struct BlockRun_T {
+    int x; // World coordinates of the first block
+    int y;
+    int z;
+    unsigned int length; // The blocks follow each other in the XZY order of the subchunk: y first, then z, then x
+    const unsigned int* ids; // Runtime IDs, INVALID_BLOCK_STATE_ID if the subchunk does not exist
+    Subchunk* subchunk; // NULL if the subchunk does not exist or failed to load
+} BlockRun;
+
+typedef int (*SubchunkSpanCallback)(void* userData, const SubchunkSpan* span);
+typedef int (*BlockRunCallback)(void* userData, const BlockRun* run);
+
+Result ForEachSubchunkInBox(
+        World* world, Dimension dimension, const BlockBox* box, SubchunkSpanCallback callback, void* userData
+);
+Result ForEachBlockInBox(
+        World* world, Dimension dimension, const BlockBox* box, BlockRunCallback callback, void* userData
+);
+Result FillBlockBox(World* world, Dimension dimension, const BlockBox* box, unsigned int runtimeId);
+
+#endif // BEDROCKFORMAT_BOX_H
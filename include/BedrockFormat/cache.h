@@ -0,0 +1,78 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef BEDROCKFORMAT_CACHE_H
+#define BEDROCKFORMAT_CACHE_H
+
+#include "format.h"
+#include "chunk.h"
+
+#include <stddef.h>
+
+#define DEFAULT_CHUNK_CACHE_BUDGET (256 * 1024 * 1024)
+
+typedef struct ChunkCacheEntry_T {
+    unsigned long long key;
+    Subchunk* subchunk;
+    size_t size;
+    unsigned int pins;
+    unsigned char referenced;
+    struct ChunkCacheEntry_T* next;
+    struct ChunkCacheEntry_T* previous;
+} ChunkCacheEntry;
+
+typedef struct ChunkCacheSlot_T {
+    unsigned long long key;
+    ChunkCacheEntry* entry;
+} ChunkCacheSlot;
+
+typedef struct ChunkCache_T {
+    ChunkCacheSlot* slots;
+    unsigned int slotMask;
+    ChunkCacheEntry* hand;
+    size_t budget;
+    size_t size;
+    unsigned int entryCount;
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+} ChunkCache;
+
+typedef struct ChunkCacheStats_T {
+    size_t budget;
+    size_t size;
+    unsigned int entryCount;
+    unsigned int pinnedCount;
+    unsigned int dirtyCount;
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+} ChunkCacheStats;
+
+ChunkCache* CreateChunkCache(size_t budget);
+void DestroyChunkCache(ChunkCache* cache);
+
+unsigned long long PackSubchunkKey(int x, unsigned char y, int z, Dimension dimension);
+Subchunk* FindCachedSubchunk(ChunkCache* cache, unsigned long long key);
+Result InsertCachedSubchunk(ChunkCache* cache, Subchunk* subchunk);
+Result AdoptCachedSubchunk(ChunkCache* cache, Subchunk* subchunk, Subchunk** cached);
+void RemoveCachedSubchunk(ChunkCache* cache, Subchunk* subchunk);
+void UpdateCachedSubchunkSize(ChunkCache* cache, Subchunk* subchunk);
+void EvictChunkCache(ChunkCache* cache, size_t target);
+
+void SetChunkCacheBudget(World* world, size_t budget);
+void GetChunkCacheStats(World* world, ChunkCacheStats* stats);
+Result PinSubchunk(World* world, Subchunk* subchunk);
+void UnpinSubchunk(World* world, Subchunk* subchunk);
+
+#endif // BEDROCKFORMAT_CACHE_H
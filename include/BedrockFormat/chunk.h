@@ -13,8 +13,14 @@
 #ifndef BEDROCKFORMAT_CHUNK_H
 #define BEDROCKFORMAT_CHUNK_H
 
+#include "arena.h"
 #include "format.h"
 #include "nbt.h"
+#include "storage.h"
+
+#include <stddef.h>
+
+#define SUBCHUNK_KEY_MAX_LENGTH 14
 
 typedef struct Position_T {
     int x;
@@ -23,19 +29,72 @@ typedef struct Position_T {
     Dimension dimension;
 } Position;
 
+typedef struct SubchunkLayer_T {
+    unsigned int offset; // Offset of the serialized storage in the layer data of the subchunk
+    BlockStorage storage; // The palette is NULL until the layer has been decoded
+} SubchunkLayer;
+
 typedef struct Subchunk_T {
     unsigned char version;
-    unsigned short blocks[4096]; // 4096 blocks
-    unsigned short paletteSize;
-    NbtTag** palette;
-    Position* position;
+    unsigned char layerCount;
+    unsigned char dirty; // Set by edits until the subchunk is written back, dirty subchunks are never evicted
+    BlockStorage storage; // First layer, always decoded
+    SubchunkLayer* layers; // Layers after the first, decoded by GetSubchunkLayer
+    unsigned char* layerData; // Serialized layers after the first
+    unsigned int layerDataLength;
+    Position position;
+    Arena arena; // Owns the storages, their palettes and the layer data
 } Subchunk;
 
+typedef struct SubchunkEncoder_T {
+    unsigned char* buffer; // Value of the last encoded subchunk
+    size_t capacity;
+    size_t length;
+    unsigned short blocks[SUBCHUNK_BLOCK_COUNT];
+    unsigned int palette[SUBCHUNK_BLOCK_COUNT];
+} SubchunkEncoder;
+
+unsigned int GenerateSubchunkKey(int x, unsigned char y, int z, Dimension dimension, unsigned char* key);
+int ParseSubchunkKey(
+        const unsigned char* key, unsigned int keyLen, int* x, unsigned char* y, int* z, Dimension* dimension
+);
+Result ReadBlockStorageHeader(
+        ByteStream* stream, unsigned char* bitsPerBlock, const unsigned char** words, unsigned int* paletteSize
+);
+Result DecodeSubchunk(ByteStream* stream, Subchunk* decoded);
+Result DecodeSubchunkValue(
+        const unsigned char* data, unsigned int length,
+        int x, unsigned char y, int z, Dimension dimension, Subchunk** subchunk
+);
+
 Result LoadSubchunk(World* world, Subchunk** subchunk, int x, unsigned char y, int z, Dimension dimension);
+Result LoadChunkColumn(World* world, int x, int z, Dimension dimension, unsigned int* loaded);
+Result LoadRegion(World* world, Dimension dimension, int minX, int minZ, int maxX, int maxZ, unsigned int* loaded);
+Result GetSubchunkLayer(Subchunk* subchunk, unsigned char layer, BlockStorage** storage);
 void FreeSubchunk(World* world, Subchunk* subchunk);
+size_t GetSubchunkMemorySize(Subchunk* subchunk);
 void PrintSubchunk(Subchunk* subchunk);
 
-NbtTag* GetBlockAtSubchunkPosition(Subchunk* subchunk, unsigned char x, unsigned char y, unsigned char z);
-NbtTag* GetBlockAtWorldPosition(World* world, Position* position);
+unsigned int GetBlockIdAtSubchunkPosition(Subchunk* subchunk, unsigned char x, unsigned char y, unsigned char z);
+unsigned int GetBlockIdAtWorldPosition(World* world, Position* position);
+const NbtTag* GetBlockAtSubchunkPosition(Subchunk* subchunk, unsigned char x, unsigned char y, unsigned char z);
+const NbtTag* GetBlockAtWorldPosition(World* world, Position* position);
+
+void InitSubchunkEncoder(SubchunkEncoder* encoder);
+void DestroySubchunkEncoder(SubchunkEncoder* encoder);
+Result EncodeSubchunk(SubchunkEncoder* encoder, const Subchunk* subchunk);
+Result SaveSubchunk(World* world, Subchunk* subchunk, SubchunkEncoder* encoder);
+
+Result SetBlockIdAtSubchunkPosition(
+        World* world, Subchunk* subchunk, unsigned char x, unsigned char y, unsigned char z, unsigned int runtimeId
+);
+Result SetBlockIdAtWorldPosition(World* world, Position* position, unsigned int runtimeId);
+Result SetBlockAtWorldPosition(World* world, Position* position, const NbtTag* state);
+Result SetSubchunkBlockRun(
+        World* world, Subchunk* subchunk, unsigned int start, unsigned int length, const unsigned int* ids
+);
+Result FillSubchunkBlockRun(
+        World* world, Subchunk* subchunk, unsigned int start, unsigned int length, unsigned int runtimeId
+);
 
 #endif // BEDROCKFORMAT_CHUNK_H
@@ -13,11 +13,16 @@
 #ifndef BEDROCK_FORMAT_FORMAT_HPP
 #define BEDROCK_FORMAT_FORMAT_HPP
 
-#include "hashmap.h"
+#include <stddef.h>
 
 #define BF_FAILED(x) x != SUCCESS
 #define BF_UNUSED(x) (void)x
 
+#define DEFAULT_BLOCK_CACHE_SIZE (40 * 1024 * 1024)
+#define DEFAULT_BLOOM_FILTER_BITS 10
+#define DEFAULT_WRITE_BUFFER_SIZE (4 * 1024 * 1024)
+#define DEFAULT_MAX_OPEN_FILES 1000
+
 typedef enum Result_T {
     SUCCESS,
     SUBCHUNK_NOT_FOUND,
@@ -26,15 +31,48 @@ typedef enum Result_T {
     DATABASE_READ_ERROR,
     INVALID_DATA,
     DESERIALIZATION_FAILED,
-    HASHMAP_INSERTION_FAILED
+    HASHMAP_INSERTION_FAILED,
+    LOAD_CANCELLED,
+    INVALID_ARGUMENT,
+    DATABASE_WRITE_ERROR
 } Result;
 
+typedef struct WorldOptions_T {
+    size_t blockCacheSize; // LevelDB cache for uncompressed table blocks, 0 uses the small cache LevelDB creates itself
+    int bloomFilterBits; // Bits per key of the bloom filter, 0 disables the filter
+    size_t writeBufferSize;
+    int maxOpenFiles;
+    int paranoidChecks; // Non-zero to verify checksums and stop at the first sign of corruption
+    int verifyScanChecksums; // Non-zero to verify checksums during iteration and bulk loads, implied by paranoidChecks
+    int buildPresenceIndex; // Non-zero to run BuildPresenceIndex while opening the world
+    size_t chunkCacheBudget; // Bytes the decoded subchunks are allowed to occupy, see SetChunkCacheBudget
+} WorldOptions;
+
 typedef struct World_T {
     void* db;
+    void* settings;
     void* leveldbCache;
-    struct hashmap_s chunkCache;
+    struct ChunkCache_T* chunkCache;
+    void* asyncLoader;
+    void* pipelineWorkers;
+    struct PresenceIndex_T* presenceIndex; // NULL until BuildPresenceIndex is called
+    int readOnly; // Set by OpenWorldReadOnly, writes fail with INVALID_ARGUMENT
 } World;
 
+typedef struct Entry_T {
+    const unsigned char* data;
+    unsigned int length;
+    void* handle;
+} Entry;
+
+typedef struct EntryIterator_T {
+    const unsigned char* key;
+    unsigned int keyLength;
+    const unsigned char* data;
+    unsigned int length;
+    void* handle;
+} EntryIterator;
+
 typedef enum Dimension_T {
     OVERWORLD,
     NETHER,
@@ -45,12 +83,25 @@ typedef enum Dimension_T {
 extern "C" {
 #endif
 
-Result OpenWorld(const char *path, World** world);
+void InitWorldOptions(WorldOptions* options);
+Result OpenWorld(const char* path, const WorldOptions* options, World** world);
+Result OpenWorldReadOnly(const char* path, const WorldOptions* options, World** world);
 Result CloseWorld(World* world);
 
 Result LoadEntry(
         World* world, const unsigned char* key, unsigned int keyLen, unsigned char** buffer, unsigned int* bufferLen
 );
+Result AcquireEntry(World* world, const unsigned char* key, unsigned int keyLen, Entry* entry);
+Result AcquireScanEntry(World* world, const unsigned char* key, unsigned int keyLen, Entry* entry);
+void ReleaseEntry(Entry* entry);
+Result StoreEntry(
+        World* world, const unsigned char* key, unsigned int keyLen, const unsigned char* data, unsigned int length
+);
+
+Result OpenEntryIterator(World* world, EntryIterator* iterator);
+int SeekEntryIterator(EntryIterator* iterator, const unsigned char* key, unsigned int keyLen);
+int NextEntryIterator(EntryIterator* iterator);
+Result CloseEntryIterator(EntryIterator* iterator);
 
 void ClearChunkCache(World* world);
 const char* TranslateErrorString(Result error);
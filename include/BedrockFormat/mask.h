@@ -0,0 +1,44 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef BEDROCKFORMAT_MASK_H
+#define BEDROCKFORMAT_MASK_H
+
+#include "format.h"
+#include "chunk.h"
+#include "registry.h"
+
+#include <stddef.h>
+
+typedef struct BlockMask_T {
+    unsigned long long bits[64]; // Bit i % 64 of word i / 64 belongs to the block with index i in XZY order
+} BlockMask;
+
+Result ExtractBlockMask(Subchunk* subchunk, unsigned char layer, BlockStatePredicate predicate, void* predicateData, BlockMask* mask);
+void AndBlockMasks(BlockMask* destination, const BlockMask* a, const BlockMask* b, size_t count);
+void OrBlockMasks(BlockMask* destination, const BlockMask* a, const BlockMask* b, size_t count);
+void NotBlockMasks(BlockMask* destination, const BlockMask* source, size_t count);
+size_t CountBlockMasks(const BlockMask* masks, size_t count);
+
+/// @brief Checks whether a block is set in a mask
+/// @param mask Mask of a subchunk
+/// @param x X coordinate of the block inside the subchunk
+/// @param y Y coordinate of the block inside the subchunk
+/// @param z Z coordinate of the block inside the subchunk
+/// @returns 1 if the block is set, 0 otherwise
+static inline int TestBlockMask(const BlockMask* mask, unsigned char x, unsigned char y, unsigned char z) {
+    unsigned int index = x * 256u + z * 16u + y;
+    return (int)((mask->bits[index / 64] >> (index % 64)) & 1);
+}
+
+#endif // BEDROCKFORMAT_MASK_H
@@ -10,11 +10,17 @@
 //
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+
 #ifndef BEDROCKFORMAT_NBT_H
 #define BEDROCKFORMAT_NBT_H
 
+#include "arena.h"
 #include "binary.h"
-#include "hashmap.h"
+
+#include <stddef.h>
+
+#define MAX_NBT_DEPTH 512
+#define NBT_COMPOUND_INDEX_THRESHOLD 16
 
 enum NbtTagType {
     NBT_END,
@@ -32,18 +38,169 @@ enum NbtTagType {
     NBT_LONG_ARRAY
 };
 
+typedef struct NbtString_T {
+    const char* data; // NUL terminated when it belongs to a decoded tree
+    unsigned int length;
+} NbtString;
+
 typedef struct NbtTag_T {
-    enum NbtTagType type;
-    void* payload;
+    union {
+        unsigned char byteValue;
+        short shortValue;
+        int intValue;
+        long long longValue;
+        float floatValue;
+        double doubleValue;
+        const char* stringValue;
+        void* arrayValues;
+        struct NbtTag_T* listElements; // Contiguous, the elements have no names
+        struct NbtCompoundEntry_T* compoundEntries; // Contiguous, in the order they were stored in
+    } payload;
+    unsigned int length; // Length of strings, amount of values in arrays and entries in lists and compounds
+    unsigned char type;
+    unsigned char elementType; // Type of the elements in lists
 } NbtTag;
 
+typedef struct NbtCompoundEntry_T {
+    const char* name; // Always NUL terminated
+    unsigned int nameLength;
+    unsigned int hash;
+    NbtTag tag;
+} NbtCompoundEntry;
+
+typedef enum NbtVisitResult_T {
+    NBT_VISIT_CONTINUE,
+    NBT_VISIT_SKIP, // Jumps over the payload of a key or the rest of a container without reporting it
+    NBT_VISIT_STOP
+} NbtVisitResult;
+
+typedef struct NbtVisitor_T {
+    NbtVisitResult (*key)(void* userData, enum NbtTagType type, const char* name, unsigned int nameLength);
+    NbtVisitResult (*beginCompound)(void* userData);
+    NbtVisitResult (*endCompound)(void* userData);
+    NbtVisitResult (*beginList)(void* userData, enum NbtTagType elementType, unsigned int count);
+    NbtVisitResult (*endList)(void* userData);
+    NbtVisitResult (*scalar)(void* userData, const NbtTag* value);
+    NbtVisitResult (*string)(void* userData, const char* data, unsigned int length);
+    NbtVisitResult (*array)(void* userData, enum NbtTagType type, const unsigned char* values, unsigned int count);
+} NbtVisitor;
+
 const char* TranslateNbtType(enum NbtTagType type);
 
-char* DecodeRawNbtString(ByteStream* stream);
-int DecodeNbtTagWithParent(ByteStream* stream, struct hashmap_s* parent);
+int ReadNbtScalar(ByteStream* stream, enum NbtTagType type, NbtTag* tag);
+int SkipNbtPayload(ByteStream* stream, enum NbtTagType type);
+int VisitNbt(ByteStream* stream, const NbtVisitor* visitor, void* userData);
+int VisitNbtPayload(ByteStream* stream, enum NbtTagType type, const NbtVisitor* visitor, void* userData);
+
+char* DecodeRawNbtString(ByteStream* stream, Arena* arena);
+NbtTag* DecodeNbtCompound(ByteStream* stream, Arena* arena);
+
+unsigned int HashNbtName(const char* name, unsigned int length);
+NbtTag* GetNbtCompoundEntry(const NbtTag* tag, const char* name);
+NbtTag* FindNbtCompoundEntry(const NbtTag* tag, const char* name, unsigned int nameLength, unsigned int hash);
+unsigned int HashNbtTag(const NbtTag* tag);
+int CompareNbtTags(const NbtTag* a, const NbtTag* b);
+
+void PrintNbtTagInner(const NbtTag* tag, const char* name, int indentation);
+void PrintNbtTag(const NbtTag* tag);
+void FreeNbtTag(NbtTag* tag, Arena* arena);
+size_t GetNbtTagMemorySize(NbtTag* tag, Arena* arena);
+
+/// @brief Retrieves the value of a byte tag
+/// @returns Value of the tag, 0 if the tag has a different type
+static inline unsigned char GetNbtByte(const NbtTag* tag) {
+    return tag->type == NBT_BYTE ? tag->payload.byteValue : 0;
+}
+
+/// @brief Retrieves the value of a short tag
+/// @returns Value of the tag, 0 if the tag has a different type
+static inline short GetNbtShort(const NbtTag* tag) {
+    return tag->type == NBT_SHORT ? tag->payload.shortValue : 0;
+}
+
+/// @brief Retrieves the value of an int tag
+/// @returns Value of the tag, 0 if the tag has a different type
+static inline int GetNbtInt(const NbtTag* tag) {
+    return tag->type == NBT_INT ? tag->payload.intValue : 0;
+}
+
+/// @brief Retrieves the value of a long tag
+/// @returns Value of the tag, 0 if the tag has a different type
+static inline long long GetNbtLong(const NbtTag* tag) {
+    return tag->type == NBT_LONG ? tag->payload.longValue : 0;
+}
+
+/// @brief Retrieves the value of a float tag
+/// @returns Value of the tag, 0 if the tag has a different type
+static inline float GetNbtFloat(const NbtTag* tag) {
+    return tag->type == NBT_FLOAT ? tag->payload.floatValue : 0.0f;
+}
+
+/// @brief Retrieves the value of a double tag
+/// @returns Value of the tag, 0 if the tag has a different type
+static inline double GetNbtDouble(const NbtTag* tag) {
+    return tag->type == NBT_DOUBLE ? tag->payload.doubleValue : 0.0;
+}
+
+/// @brief Retrieves the value of a string tag
+/// @returns View of the string, an empty string if the tag has a different type
+/// @attention The view stays valid for as long as the tag is alive
+static inline NbtString GetNbtString(const NbtTag* tag) {
+    NbtString string = { "", 0 };
+    if(tag->type == NBT_STRING) {
+        string.data = tag->payload.stringValue;
+        string.length = tag->length;
+    }
+    return string;
+}
+
+/// @brief Retrieves the amount of elements in a list tag
+/// @returns Amount of elements, 0 if the tag has a different type
+static inline unsigned int GetNbtListSize(const NbtTag* tag) {
+    return tag->type == NBT_LIST ? tag->length : 0;
+}
+
+/// @brief Retrieves an element of a list tag
+/// @returns Pointer to the element, NULL if the index is out of range or the tag has a different type
+static inline NbtTag* GetNbtListElement(const NbtTag* tag, unsigned int index) {
+    return index < GetNbtListSize(tag) ? &tag->payload.listElements[index] : NULL;
+}
+
+/// @brief Retrieves the amount of entries in a compound tag
+/// @returns Amount of entries, 0 if the tag has a different type
+static inline unsigned int GetNbtCompoundSize(const NbtTag* tag) {
+    return tag->type == NBT_COMPOUND ? tag->length : 0;
+}
+
+/// @brief Retrieves an entry of a compound tag by position, entries keep the order they were stored in
+/// @returns Pointer to the entry, NULL if the index is out of range or the tag has a different type
+static inline NbtCompoundEntry* GetNbtCompoundEntryAt(const NbtTag* tag, unsigned int index) {
+    return index < GetNbtCompoundSize(tag) ? &tag->payload.compoundEntries[index] : NULL;
+}
+
+/// @brief Retrieves the amount of values in a byte, int or long array tag
+/// @returns Amount of values, 0 if the tag is not an array
+static inline unsigned int GetNbtArraySize(const NbtTag* tag) {
+    return tag->type == NBT_BYTE_ARRAY || tag->type == NBT_INT_ARRAY || tag->type == NBT_LONG_ARRAY
+           ? tag->length : 0;
+}
+
+/// @brief Retrieves the values of a byte array tag
+/// @returns Pointer to GetNbtArraySize values, NULL if the tag has a different type
+static inline const unsigned char* GetNbtByteArray(const NbtTag* tag) {
+    return tag->type == NBT_BYTE_ARRAY ? (const unsigned char*)tag->payload.arrayValues : NULL;
+}
+
+/// @brief Retrieves the values of an int array tag
+/// @returns Pointer to GetNbtArraySize values, NULL if the tag has a different type
+static inline const int* GetNbtIntArray(const NbtTag* tag) {
+    return tag->type == NBT_INT_ARRAY ? (const int*)tag->payload.arrayValues : NULL;
+}
 
-void PrintNbtTagInner(enum NbtTagType type, void* payload, const char* name, int indentation);
-void PrintNbtTag(NbtTag* tag);
-void FreeNbtTag(NbtTag* tag);
+/// @brief Retrieves the values of a long array tag
+/// @returns Pointer to GetNbtArraySize values, NULL if the tag has a different type
+static inline const long long* GetNbtLongArray(const NbtTag* tag) {
+    return tag->type == NBT_LONG_ARRAY ? (const long long*)tag->payload.arrayValues : NULL;
+}
 
 #endif // BEDROCKFORMAT_NBT_H
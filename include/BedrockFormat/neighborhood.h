@@ -0,0 +1,69 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef BEDROCKFORMAT_NEIGHBORHOOD_H
+#define BEDROCKFORMAT_NEIGHBORHOOD_H
+
+#include "format.h"
+#include "chunk.h"
+#include "pipeline.h"
+
+#define NEIGHBORHOOD_EDGE 18 // A subchunk plus one block of every neighbor on each side
+#define NEIGHBORHOOD_BLOCK_COUNT (NEIGHBORHOOD_EDGE * NEIGHBORHOOD_EDGE * NEIGHBORHOOD_EDGE)
+#define NEIGHBORHOOD_STRIDE_X (NEIGHBORHOOD_EDGE * NEIGHBORHOOD_EDGE)
+#define NEIGHBORHOOD_STRIDE_Z NEIGHBORHOOD_EDGE
+#define NEIGHBORHOOD_STRIDE_Y 1
+
+typedef struct SubchunkNeighborhood_T {
+    World* world;
+    Position position; // Position of the center subchunk, in subchunk coordinates
+    Subchunk* subchunks[27]; // Pinned subchunks in XZY order, NULL if the subchunk does not exist
+    unsigned int ids[NEIGHBORHOOD_BLOCK_COUNT]; // Runtime IDs of the padded view in XZY order, see GetNeighborhoodIndex
+} SubchunkNeighborhood;
+
+Result LoadSubchunkNeighborhood(
+        World* world, int x, unsigned char y, int z, Dimension dimension, const PipelineOptions* options,
+        SubchunkNeighborhood* neighborhood
+);
+void ReleaseSubchunkNeighborhood(SubchunkNeighborhood* neighborhood);
+
+/// @brief Calculates the index of a block in the padded view of a neighborhood
+/// @param x X coordinate relative to the center subchunk, from -1 to 16
+/// @param y Y coordinate relative to the center subchunk, from -1 to 16
+/// @param z Z coordinate relative to the center subchunk, from -1 to 16
+/// @returns Index into the ids of the neighborhood, neighbors are NEIGHBORHOOD_STRIDE_* away from it
+static inline unsigned int GetNeighborhoodIndex(int x, int y, int z) {
+    return (unsigned int)((x + 1) * NEIGHBORHOOD_STRIDE_X + (z + 1) * NEIGHBORHOOD_STRIDE_Z + (y + 1));
+}
+
+/// @brief Retrieves the runtime ID of a block in or around the center subchunk of a neighborhood
+/// @param neighborhood Loaded neighborhood
+/// @param x X coordinate relative to the center subchunk, from -1 to 16
+/// @param y Y coordinate relative to the center subchunk, from -1 to 16
+/// @param z Z coordinate relative to the center subchunk, from -1 to 16
+/// @returns Runtime ID of the block state, INVALID_BLOCK_STATE_ID if the subchunk containing it does not exist
+static inline unsigned int GetNeighborhoodBlockId(const SubchunkNeighborhood* neighborhood, int x, int y, int z) {
+    return neighborhood->ids[GetNeighborhoodIndex(x, y, z)];
+}
+
+/// @brief Retrieves a subchunk of a neighborhood
+/// @param neighborhood Loaded neighborhood
+/// @param dx Offset to the center subchunk on the x axis, from -1 to 1
+/// @param dy Offset to the center subchunk on the y axis, from -1 to 1
+/// @param dz Offset to the center subchunk on the z axis, from -1 to 1
+/// @returns Pointer to the subchunk, NULL if it does not exist
+static inline Subchunk* GetNeighborSubchunk(const SubchunkNeighborhood* neighborhood, int dx, int dy, int dz) {
+    return neighborhood->subchunks[(dx + 1) * 9 + (dz + 1) * 3 + (dy + 1)];
+}
+
+#endif // BEDROCKFORMAT_NEIGHBORHOOD_H
@@ -0,0 +1,53 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef BEDROCKFORMAT_PIPELINE_H
+#define BEDROCKFORMAT_PIPELINE_H
+
+#include "format.h"
+#include "chunk.h"
+
+#include <stddef.h>
+
+#define DEFAULT_PIPELINE_QUEUE_DEPTH 64
+
+typedef struct PipelineOptions_T {
+    unsigned int threadCount;
+    unsigned int queueDepth;
+} PipelineOptions;
+
+typedef void (*PipelineTask)(void* data);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+Result StartPipelineWorkers(World* world, unsigned int threadCount);
+void StopPipelineWorkers(World* world);
+void SubmitPipelineTasks(World* world, unsigned int threadCount, PipelineTask task, void* data);
+
+void InitPipelineOptions(PipelineOptions* options);
+
+Result LoadSubchunksParallel(
+        World* world, const Position* positions, size_t count, const PipelineOptions* options, unsigned int* loaded
+);
+Result LoadRegionParallel(
+        World* world, Dimension dimension, int minX, int minZ, int maxX, int maxZ,
+        const PipelineOptions* options, unsigned int* loaded
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BEDROCKFORMAT_PIPELINE_H
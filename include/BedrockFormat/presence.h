@@ -0,0 +1,51 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef BEDROCKFORMAT_PRESENCE_H
+#define BEDROCKFORMAT_PRESENCE_H
+
+#include "format.h"
+
+typedef struct PresenceColumn_T {
+    unsigned long long key; // Column key packed by PackSubchunkKey with y = 0
+    int x;
+    int z;
+    unsigned long long layers[4]; // Bit y % 64 of word y / 64 is set if the subchunk with the unsigned y byte exists
+} PresenceColumn;
+
+typedef struct PresenceIndex_T {
+    PresenceColumn* columns; // Open addressing table, a slot without any layer bits is empty
+    unsigned int slotMask;
+    unsigned int columnCount;
+    unsigned int subchunkCount;
+} PresenceIndex;
+
+typedef struct PresenceStats_T {
+    unsigned int columnCount;
+    unsigned int subchunkCount;
+    int minX; // Bounds in chunks, inclusive. Only valid if columnCount is not 0.
+    int maxX;
+    int minZ;
+    int maxZ;
+    int minY; // Bounds in subchunks, inclusive
+    int maxY;
+} PresenceStats;
+
+Result BuildPresenceIndex(World* world);
+void DestroyPresenceIndex(PresenceIndex* index);
+void MarkSubchunkPresent(World* world, int x, unsigned char y, int z, Dimension dimension);
+int IsSubchunkPresent(World* world, int x, unsigned char y, int z, Dimension dimension);
+int IsColumnPresent(World* world, int x, int z, Dimension dimension);
+Result GetPresenceStats(World* world, Dimension dimension, PresenceStats* stats);
+
+#endif // BEDROCKFORMAT_PRESENCE_H
@@ -0,0 +1,40 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef BEDROCKFORMAT_QUERY_H
+#define BEDROCKFORMAT_QUERY_H
+
+#include "binary.h"
+#include "nbt.h"
+
+typedef struct NbtPathStep_T {
+    const char* name; // NULL for list index steps
+    unsigned int nameLength;
+    unsigned int hash;
+    unsigned int index;
+} NbtPathStep;
+
+typedef struct NbtPath_T {
+    NbtPathStep* steps;
+    unsigned int stepCount;
+} NbtPath;
+
+NbtPath* CompileNbtPath(const char* expression);
+void FreeNbtPath(NbtPath* path);
+
+int FindNbtPath(ByteStream* stream, enum NbtTagType type, const NbtPath* path, enum NbtTagType* matchType);
+int QueryNbtScalar(const ByteStream* stream, enum NbtTagType type, const NbtPath* path, NbtTag* value);
+int QueryNbtString(const ByteStream* stream, enum NbtTagType type, const NbtPath* path, NbtString* value);
+NbtTag* QueryNbtTag(const NbtTag* tag, const NbtPath* path);
+
+#endif // BEDROCKFORMAT_QUERY_H
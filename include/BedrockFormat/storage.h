@@ -0,0 +1,95 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef BEDROCKFORMAT_STORAGE_H
+#define BEDROCKFORMAT_STORAGE_H
+
+#include "format.h"
+
+#if defined(__AVX2__)
+#define BEDROCK_FORMAT_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BEDROCK_FORMAT_SSE2
+#endif
+
+#define SUBCHUNK_BLOCK_COUNT 4096
+#define BLOCK_MASK_MAX_COMPARES 8 // Palette entries compared at once before BuildBlockIndexMask falls back to table lookups
+
+typedef struct BlockStorage_T {
+    unsigned char bitsPerBlock; // 0 if every block uses the first palette entry
+    unsigned char blocksPerWord;
+    unsigned short paletteSize;
+    unsigned short paletteCapacity; // Entries the palette has room for, edits grow it in place until it is full
+    unsigned int* palette; // Runtime IDs of the block states, see registry.h
+    unsigned char* words; // Packed little endian words in the layout Bedrock uses, NULL if bitsPerBlock is 0
+                          // Decoded storages use the minimal width, edits only ever widen it
+} BlockStorage;
+
+int IsValidBitsPerBlock(unsigned char bitsPerBlock);
+unsigned char GetMinimalBitsPerBlock(unsigned int paletteSize);
+unsigned int GetBlockStorageWordCount(unsigned char bitsPerBlock);
+Result UnpackBlockIndices(const unsigned char* words, unsigned char bitsPerBlock, unsigned short* blocks);
+void PackBlockIndices(const unsigned short* blocks, unsigned char bitsPerBlock, unsigned char* words);
+void ExpandBlockStorage(const BlockStorage* storage, unsigned short* blocks);
+unsigned int CompactBlockIndices(unsigned short* blocks, unsigned int* palette, unsigned int paletteSize);
+unsigned int FindBlockIndex(const unsigned short* blocks, unsigned short index, unsigned short* matches);
+void BuildBlockIndexMask(const unsigned short* blocks, const unsigned char* table, unsigned int paletteSize, unsigned long long* bits);
+
+/// @brief Reads a little endian word from a block storage
+static inline unsigned int LoadBlockStorageWord(const unsigned char* words) {
+    return (unsigned int)words[0] | (unsigned int)words[1] << 8 |
+           (unsigned int)words[2] << 16 | (unsigned int)words[3] << 24;
+}
+
+/// @brief Writes a little endian word into a block storage
+static inline void StoreBlockStorageWord(unsigned char* words, unsigned int word) {
+    words[0] = (unsigned char)word;
+    words[1] = (unsigned char)(word >> 8);
+    words[2] = (unsigned char)(word >> 16);
+    words[3] = (unsigned char)(word >> 24);
+}
+
+/// @brief Retrieves the palette index of a single block without unpacking the storage
+/// @param storage Block storage containing the block
+/// @param index Index of the block in XZY order
+/// @returns Palette index of the block
+static inline unsigned short GetBlockStorageIndex(const BlockStorage* storage, unsigned int index) {
+    if(storage->bitsPerBlock == 0) return 0;
+
+    unsigned int word = LoadBlockStorageWord(storage->words + index / storage->blocksPerWord * 4);
+    unsigned int shift = index % storage->blocksPerWord * storage->bitsPerBlock;
+    return (unsigned short)((word >> shift) & ((1u << storage->bitsPerBlock) - 1));
+}
+
+/// @brief Retrieves the runtime ID of a single block without unpacking the storage
+/// @param storage Block storage containing the block
+/// @param index Index of the block in XZY order
+/// @returns Runtime ID of the block state
+static inline unsigned int GetBlockStorageId(const BlockStorage* storage, unsigned int index) {
+    return storage->palette[GetBlockStorageIndex(storage, index)];
+}
+
+/// @brief Changes the palette index of a single block without unpacking the storage
+/// @param storage Block storage containing the block, bitsPerBlock must not be 0
+/// @param index Index of the block in XZY order
+/// @param value Palette index to store, it has to fit into bitsPerBlock bits
+static inline void SetBlockStorageIndex(BlockStorage* storage, unsigned int index, unsigned short value) {
+    unsigned char* words = storage->words + index / storage->blocksPerWord * 4;
+    unsigned int shift = index % storage->blocksPerWord * storage->bitsPerBlock;
+    unsigned int mask = ((1u << storage->bitsPerBlock) - 1) << shift;
+    StoreBlockStorageWord(words, (LoadBlockStorageWord(words) & ~mask) | (unsigned int)value << shift);
+}
+
+#endif // BEDROCKFORMAT_STORAGE_H
@@ -0,0 +1,112 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "BedrockFormat/arena.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/// @brief Size of a block header, rounded up so the data behind it stays aligned
+/// @internal
+#define ARENA_HEADER_SIZE ((sizeof(ArenaBlock) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+/// @brief Initializes an empty arena, no memory is allocated until the first allocation
+/// @param arena Arena to be initialized, usually embedded in the structure that owns the allocations
+/// @param blockSize Size of the first block, following blocks start at half of it and double up to MAX_ARENA_BLOCK_SIZE
+void InitArena(Arena* arena, size_t blockSize) {
+    arena->blocks = NULL;
+    arena->blockSize = blockSize != 0 ? blockSize : DEFAULT_ARENA_BLOCK_SIZE;
+    arena->size = 0;
+}
+
+/// @brief Allocates a new block and links it into the arena
+/// @internal
+static ArenaBlock* AddArenaBlock(Arena* arena, size_t capacity, int makeCurrent) {
+    ArenaBlock* block = malloc(ARENA_HEADER_SIZE + capacity);
+    if(block == NULL) {
+        fprintf(stderr, "Failed to allocate arena block (size = %zu)\n", capacity);
+        return NULL;
+    }
+
+    block->capacity = capacity;
+    block->used = 0;
+    arena->size += ARENA_HEADER_SIZE + capacity;
+
+    if(makeCurrent || arena->blocks == NULL) {
+        block->next = arena->blocks;
+        arena->blocks = block;
+    } else {
+        // Keep the partially used block in front so its remaining space is not wasted
+        block->next = arena->blocks->next;
+        arena->blocks->next = block;
+    }
+
+    return block;
+}
+
+/// @brief Allocates memory that lives until the arena is destroyed
+/// @param arena Arena to allocate from
+/// @param size Amount of bytes to allocate
+/// @returns Pointer aligned to ARENA_ALIGNMENT, NULL if the allocation failed
+/// @attention The memory is not zeroed and can not be freed individually
+void* AllocateFromArena(Arena* arena, size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+    ArenaBlock* block = arena->blocks;
+    if(block == NULL || block->capacity - block->used < size) {
+        if(size > arena->blockSize / 4) {
+            // Large allocations get a block of their own
+            block = AddArenaBlock(arena, size, 0);
+        } else {
+            block = AddArenaBlock(arena, arena->blockSize, 1);
+
+            // The first block is usually sized for the expected contents, so blocks after it only
+            // have to absorb the estimation error. They start smaller and double from there.
+            if(block != NULL && block->next == NULL) {
+                arena->blockSize = arena->blockSize / 2 > MIN_ARENA_BLOCK_SIZE ? arena->blockSize / 2 : MIN_ARENA_BLOCK_SIZE;
+            } else if(arena->blockSize < MAX_ARENA_BLOCK_SIZE) {
+                arena->blockSize *= 2;
+            }
+        }
+
+        if(block == NULL) {
+            return NULL;
+        }
+    }
+
+    void* memory = (unsigned char*)block + ARENA_HEADER_SIZE + block->used;
+    block->used += size;
+    return memory;
+}
+
+/// @brief Frees every allocation of the arena at once
+/// @param arena Arena to be destroyed
+/// @attention The arena is left empty and can be used again
+void DestroyArena(Arena* arena) {
+    ArenaBlock* block = arena->blocks;
+    while(block != NULL) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+
+    arena->blocks = NULL;
+    arena->size = 0;
+}
+
+/// @brief Retrieves how much heap memory the arena occupies
+/// @param arena Arena to be measured
+/// @returns Size in bytes, including unused space at the end of blocks
+size_t GetArenaMemorySize(const Arena* arena) {
+    return arena->size;
+}
@@ -0,0 +1,403 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "BedrockFormat/format.h"
+
+extern "C" {
+    #include "BedrockFormat/chunk.h"
+    #include "BedrockFormat/cache.h"
+    #include "BedrockFormat/async.h"
+    #include "BedrockFormat/presence.h"
+};
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    /// @brief Load that has been requested but not delivered yet
+    /// @internal
+    struct AsyncRequest {
+        AsyncLoadCallback callback;
+        void* userData;
+        unsigned char key[SUBCHUNK_KEY_MAX_LENGTH];
+        unsigned int keyLength;
+        int x;
+        unsigned char y;
+        int z;
+        Dimension dimension;
+    };
+
+    /// @brief Entry of the priority queue, loads with a higher priority are started first
+    /// @internal
+    struct QueuedLoad {
+        int priority;
+        unsigned long long sequence;
+        AsyncLoadId id;
+
+        bool operator<(const QueuedLoad& other) const {
+            if(priority != other.priority) return priority < other.priority;
+            return sequence > other.sequence;
+        }
+    };
+
+    /// @brief Load that has been decoded by a worker and waits to be delivered
+    /// @internal
+    struct CompletedLoad {
+        AsyncLoadId id;
+        Subchunk* subchunk;
+        Result result;
+        bool cached;
+    };
+
+    /// @brief Pool of worker threads that loads subchunks in the background
+    /// @internal
+    /// @attention Workers only read and decode. Delivering a load, which inserts the subchunk into the chunk cache
+    ///            and runs the callback, happens in PollAsyncLoads and WaitAsyncLoad on the thread that owns the world.
+    class AsyncLoader {
+    public:
+        AsyncLoader(World* world, unsigned int threadCount) : world(world) {
+            if(threadCount == 0) threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+            for(unsigned int i = 0; i < threadCount; i++) {
+                workers.emplace_back(&AsyncLoader::Work, this);
+            }
+        }
+
+        ~AsyncLoader() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closing = true;
+            }
+            loadAvailable.notify_all();
+
+            for(auto& worker : workers) {
+                worker.join();
+            }
+
+            for(auto& completed : completions) {
+                if(completed.subchunk != nullptr) FreeSubchunk(nullptr, completed.subchunk);
+            }
+
+            // Give the callers a chance to clean up their user data
+            for(auto& pair : requests) {
+                if(pair.second.callback != nullptr) {
+                    pair.second.callback(pair.second.userData, pair.first, LOAD_CANCELLED, nullptr);
+                }
+            }
+        }
+
+        AsyncLoadId Submit(const AsyncRequest& request, int priority, bool cached, bool present) {
+            std::unique_lock<std::mutex> lock(mutex);
+            AsyncLoadId id = nextId++;
+            requests.emplace(id, request);
+
+            if(cached || !present) {
+                // Still delivered through PollAsyncLoads, callbacks never run inside LoadSubchunkAsync
+                completions.push_back({ id, nullptr, cached ? SUCCESS : SUBCHUNK_NOT_FOUND, cached });
+                lock.unlock();
+                completionAvailable.notify_all();
+                return id;
+            }
+
+            queue.push({ priority, nextSequence++, id });
+            lock.unlock();
+            loadAvailable.notify_one();
+            return id;
+        }
+
+        void Cancel(AsyncLoadId id) {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto it = requests.find(id);
+            if(it == requests.end()) return;
+
+            // The queue entry or a result that is still in flight is dropped once it turns up
+            AsyncRequest request = it->second;
+            requests.erase(it);
+            lock.unlock();
+
+            if(request.callback != nullptr) {
+                request.callback(request.userData, id, LOAD_CANCELLED, nullptr);
+            }
+        }
+
+        unsigned int Deliver(AsyncLoadId waitFor, Result* waitResult, Subchunk** waitSubchunk, bool* delivered) {
+            std::vector<CompletedLoad> completed;
+            std::vector<AsyncRequest> delivering;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                completed.swap(completions);
+
+                delivering.reserve(completed.size());
+                for(auto& load : completed) {
+                    auto it = requests.find(load.id);
+                    if(it == requests.end()) {
+                        // Cancelled while it was being loaded
+                        if(load.subchunk != nullptr) FreeSubchunk(nullptr, load.subchunk);
+                        load.id = ASYNC_LOAD_NONE;
+                        delivering.push_back({});
+                        continue;
+                    }
+
+                    delivering.push_back(it->second);
+                    requests.erase(it);
+                }
+            }
+
+            unsigned int count = 0;
+            for(size_t i = 0; i < completed.size(); i++) {
+                CompletedLoad& load = completed[i];
+                if(load.id == ASYNC_LOAD_NONE) continue;
+
+                const AsyncRequest& request = delivering[i];
+                Subchunk* subchunk = nullptr;
+                Result result = load.result;
+
+                if(load.cached) {
+                    // Cache hits are resolved again, the subchunk might have been evicted in the meantime
+                    result = LoadSubchunk(world, &subchunk, request.x, request.y, request.z, request.dimension);
+                } else if(load.subchunk != nullptr) {
+                    result = AdoptCachedSubchunk(world->chunkCache, load.subchunk, &subchunk);
+                }
+                if(BF_FAILED(result)) subchunk = nullptr;
+
+                if(load.id == waitFor) {
+                    *waitResult = result;
+                    *waitSubchunk = subchunk;
+                    *delivered = true;
+                }
+
+                if(request.callback != nullptr) {
+                    request.callback(request.userData, load.id, result, subchunk);
+                }
+                count++;
+            }
+
+            return count;
+        }
+
+        bool IsPending(AsyncLoadId id) {
+            std::lock_guard<std::mutex> lock(mutex);
+            return requests.find(id) != requests.end();
+        }
+
+        void WaitForCompletion() {
+            std::unique_lock<std::mutex> lock(mutex);
+            completionAvailable.wait(lock, [this] { return !completions.empty(); });
+        }
+
+    private:
+        void Work() {
+            for(;;) {
+                AsyncLoadId id;
+                AsyncRequest request;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    loadAvailable.wait(lock, [this] { return closing || !queue.empty(); });
+                    if(closing) break;
+
+                    id = queue.top().id;
+                    queue.pop();
+
+                    auto it = requests.find(id);
+                    if(it == requests.end()) continue;
+                    request = it->second;
+                }
+
+                CompletedLoad completed = { id, nullptr, SUCCESS, false };
+
+                Entry entry;
+                completed.result = AcquireEntry(world, request.key, request.keyLength, &entry);
+                if(!BF_FAILED(completed.result)) {
+                    completed.result = DecodeSubchunkValue(
+                            entry.data, entry.length,
+                            request.x, request.y, request.z, request.dimension, &completed.subchunk
+                    );
+                    if(BF_FAILED(completed.result)) completed.subchunk = nullptr;
+                    ReleaseEntry(&entry);
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    completions.push_back(completed);
+                }
+                completionAvailable.notify_all();
+            }
+        }
+
+        World* world;
+
+        std::mutex mutex;
+        std::condition_variable loadAvailable;
+        std::condition_variable completionAvailable;
+        std::unordered_map<AsyncLoadId, AsyncRequest> requests;
+        std::priority_queue<QueuedLoad> queue;
+        std::vector<CompletedLoad> completions;
+        AsyncLoadId nextId = ASYNC_LOAD_NONE + 1;
+        unsigned long long nextSequence = 0;
+        bool closing = false;
+
+        std::vector<std::thread> workers;
+    };
+
+    /// @brief Retrieves the loader of a world, starting it with the default thread count if needed
+    /// @internal
+    AsyncLoader* GetAsyncLoader(World* world) {
+        if(world->asyncLoader == nullptr) {
+            StartAsyncLoader(world, 0);
+        }
+        return (AsyncLoader*)world->asyncLoader;
+    }
+}
+
+/// @brief Starts the worker threads that load subchunks in the background
+/// @param world World to load subchunks from
+/// @param threadCount Amount of worker threads, 0 uses one thread per hardware thread
+/// @returns Result
+/// @attention Calling this function is optional, the loader is started on first use otherwise
+Result StartAsyncLoader(World* world, unsigned int threadCount) {
+    if(world->asyncLoader != nullptr) {
+        return INVALID_ARGUMENT;
+    }
+
+    world->asyncLoader = new AsyncLoader(world, threadCount);
+    return SUCCESS;
+}
+
+/// @brief Stops the background worker threads
+/// @param world World the loader belongs to
+/// @attention Loads that have not been delivered yet are cancelled, their callbacks receive LOAD_CANCELLED
+void StopAsyncLoader(World* world) {
+    delete (AsyncLoader*)world->asyncLoader;
+    world->asyncLoader = nullptr;
+}
+
+/// @brief Loads a subchunk in the background
+/// @param world World the subchunk is located in
+/// @param x X-coordinate of the subchunk
+/// @param y Y-coordinate of the subchunk
+/// @param z Z-coordinate of the subchunk
+/// @param dimension Dimension the subchunk is located in
+/// @param priority Loads with a higher priority are started first, equal priorities are started in order
+/// @param callback Function that is called once the subchunk has been delivered, can be NULL
+/// @param userData Pointer that is passed to the callback
+/// @param id Pointer to an integer that will contain the id of the load, can be NULL
+/// @returns Result
+/// @attention The decoded subchunk is inserted into the chunk cache and the callback is run when the load is
+///            delivered by PollAsyncLoads or WaitAsyncLoad, on the thread that calls them.
+///            Subchunks the presence index knows not to exist are never queued, their loads finish right away with
+///            SUBCHUNK_NOT_FOUND and are delivered by the next PollAsyncLoads.
+Result LoadSubchunkAsync(
+        World* world, int x, unsigned char y, int z, Dimension dimension,
+        int priority, AsyncLoadCallback callback, void* userData, AsyncLoadId* id
+) {
+    AsyncRequest request;
+    request.callback = callback;
+    request.userData = userData;
+    request.keyLength = GenerateSubchunkKey(x, y, z, dimension, request.key);
+    request.x = x;
+    request.y = y;
+    request.z = z;
+    request.dimension = dimension;
+
+    bool cached = FindCachedSubchunk(world->chunkCache, PackSubchunkKey(x, y, z, dimension)) != nullptr;
+    bool present = cached || IsSubchunkPresent(world, x, y, z, dimension);
+    AsyncLoadId loadId = GetAsyncLoader(world)->Submit(request, priority, cached, present);
+    if(id != nullptr) *id = loadId;
+
+    return SUCCESS;
+}
+
+/// @brief Loads a set of subchunks into the chunk cache in the background
+/// @param world World the subchunks are located in
+/// @param positions Positions of the subchunks in subchunk coordinates
+/// @param count Amount of positions
+/// @param priority Priority of the loads, DEFAULT_PREFETCH_PRIORITY puts them behind regular loads
+/// @param ids Array of count integers that will contain the ids of the loads, can be NULL.
+///            Subchunks that are already cached or known not to exist get ASYNC_LOAD_NONE.
+/// @returns Result
+Result PrefetchSubchunks(World* world, const Position* positions, size_t count, int priority, AsyncLoadId* ids) {
+    for(size_t i = 0; i < count; i++) {
+        const Position& position = positions[i];
+        if(FindCachedSubchunk(
+                world->chunkCache, PackSubchunkKey(position.x, position.y, position.z, position.dimension)
+        ) != nullptr || !IsSubchunkPresent(world, position.x, position.y, position.z, position.dimension)) {
+            if(ids != nullptr) ids[i] = ASYNC_LOAD_NONE;
+            continue;
+        }
+
+        Result result = LoadSubchunkAsync(
+                world, position.x, position.y, position.z, position.dimension,
+                priority, nullptr, nullptr, ids != nullptr ? &ids[i] : nullptr
+        );
+        if(BF_FAILED(result)) {
+            return result;
+        }
+    }
+
+    return SUCCESS;
+}
+
+/// @brief Cancels a load that has not been delivered yet
+/// @param world World the load belongs to
+/// @param id Id of the load
+/// @attention The callback is run right away with LOAD_CANCELLED. Ids of loads that have already been delivered are ignored.
+void CancelAsyncLoad(World* world, AsyncLoadId id) {
+    if(world->asyncLoader == nullptr) return;
+    ((AsyncLoader*)world->asyncLoader)->Cancel(id);
+}
+
+/// @brief Delivers every finished load without blocking
+/// @param world World the loads belong to
+/// @returns Amount of delivered loads
+unsigned int PollAsyncLoads(World* world) {
+    if(world->asyncLoader == nullptr) return 0;
+
+    Result result;
+    Subchunk* subchunk;
+    bool delivered;
+    return ((AsyncLoader*)world->asyncLoader)->Deliver(ASYNC_LOAD_NONE, &result, &subchunk, &delivered);
+}
+
+/// @brief Blocks until a load has been delivered
+/// @param world World the load belongs to
+/// @param id Id of the load
+/// @param subchunk Pointer that will point to the loaded subchunk, can be NULL
+/// @returns Result of the load, INVALID_ARGUMENT if the load has already been delivered or cancelled
+/// @attention Other loads that finish in the meantime are delivered as well
+Result WaitAsyncLoad(World* world, AsyncLoadId id, Subchunk** subchunk) {
+    if(world->asyncLoader == nullptr) {
+        return INVALID_ARGUMENT;
+    }
+
+    auto loader = (AsyncLoader*)world->asyncLoader;
+    Result result = INVALID_ARGUMENT;
+    Subchunk* loaded = nullptr;
+    bool delivered = false;
+
+    while(!delivered) {
+        if(!loader->IsPending(id)) {
+            return INVALID_ARGUMENT;
+        }
+
+        loader->WaitForCompletion();
+        loader->Deliver(id, &result, &loaded, &delivered);
+    }
+
+    if(subchunk != nullptr) *subchunk = loaded;
+    return result;
+}
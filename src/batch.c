@@ -0,0 +1,163 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "BedrockFormat/batch.h"
+#include "BedrockFormat/cache.h"
+#include "BedrockFormat/registry.h"
+#include "BedrockFormat/storage.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/// @brief Single position of a batched lookup
+/// @internal
+typedef struct BlockLookup_T {
+    unsigned long long key; // Packed key of the subchunk containing the block
+    size_t index; // Index of the position in the request
+    unsigned short block; // Index of the block in the subchunk, in XZY order
+} BlockLookup;
+
+/// @brief Orders lookups by subchunk and by block inside the subchunk
+/// @internal
+static int CompareBlockLookups(const void* a, const void* b) {
+    const BlockLookup* first = a;
+    const BlockLookup* second = b;
+
+    if(first->key != second->key) return first->key < second->key ? -1 : 1;
+    return (int)first->block - (int)second->block;
+}
+
+/// @brief Looks up a batch of blocks subchunk by subchunk
+/// @param ids Array the runtime IDs are written into, NULL if they are not needed
+/// @param blocks Array the block states are written into, NULL if they are not needed
+/// @internal
+static Result LookupBlocks(
+        World* world, const Position* positions, size_t count, const PipelineOptions* options,
+        unsigned int* ids, const NbtTag** blocks
+) {
+    if(count == 0) {
+        return SUCCESS;
+    }
+
+    BlockLookup* lookups = malloc(count * sizeof(BlockLookup));
+    if(lookups == NULL) {
+        fprintf(stderr, "Failed to allocate %zu block lookups\n", count);
+        return ALLOCATION_FAILED;
+    }
+
+    int sorted = 1;
+    for(size_t i = 0; i < count; i++) {
+        const Position* position = &positions[i];
+
+        lookups[i].key = PackSubchunkKey(position->x >> 4, position->y >> 4, position->z >> 4, position->dimension);
+        lookups[i].index = i;
+        lookups[i].block = (unsigned short)(16 * 16 * (position->x & 15) + 16 * (position->z & 15) + (position->y & 15));
+
+        if(i != 0 && sorted) sorted = CompareBlockLookups(&lookups[i - 1], &lookups[i]) <= 0;
+    }
+
+    // Callers often query positions that are already grouped, sorting them again would be wasted time
+    if(!sorted) {
+        qsort(lookups, count, sizeof(BlockLookup), CompareBlockLookups);
+    }
+
+    Result firstError = SUCCESS;
+    if(options != NULL) {
+        // Load every subchunk that is missing on the pipeline first, the loop below then only hits the cache
+        Position* missing = malloc(count * sizeof(Position));
+        if(missing == NULL) {
+            fprintf(stderr, "Failed to allocate %zu subchunk positions\n", count);
+            free(lookups);
+            return ALLOCATION_FAILED;
+        }
+
+        size_t missingCount = 0;
+        for(size_t i = 0; i < count; i++) {
+            if(i != 0 && lookups[i].key == lookups[i - 1].key) continue;
+            if(FindCachedSubchunk(world->chunkCache, lookups[i].key) != NULL) continue;
+
+            const Position* position = &positions[lookups[i].index];
+            missing[missingCount].x = position->x >> 4;
+            missing[missingCount].y = position->y >> 4;
+            missing[missingCount].z = position->z >> 4;
+            missing[missingCount].dimension = position->dimension;
+            missingCount++;
+        }
+
+        if(missingCount > 1) {
+            unsigned int loaded;
+            firstError = LoadSubchunksParallel(world, missing, missingCount, options, &loaded);
+        }
+        free(missing);
+    }
+
+    for(size_t start = 0; start < count;) {
+        size_t end = start + 1;
+        while(end < count && lookups[end].key == lookups[start].key) end++;
+
+        // A subchunk that was loaded above can still have been evicted by a small budget, LoadSubchunk handles both
+        const Position* position = &positions[lookups[start].index];
+        Subchunk* subchunk;
+        Result result = LoadSubchunk(
+                world, &subchunk, position->x >> 4, position->y >> 4, position->z >> 4, position->dimension
+        );
+        if(BF_FAILED(result)) {
+            if(result != SUBCHUNK_NOT_FOUND && !BF_FAILED(firstError)) firstError = result;
+            subchunk = NULL;
+        }
+
+        for(size_t i = start; i < end; i++) {
+            unsigned int id = subchunk != NULL
+                    ? GetBlockStorageId(&subchunk->storage, lookups[i].block) : INVALID_BLOCK_STATE_ID;
+
+            if(ids != NULL) ids[lookups[i].index] = id;
+            if(blocks != NULL) blocks[lookups[i].index] = subchunk != NULL ? GetBlockState(id) : NULL;
+        }
+
+        start = end;
+    }
+
+    free(lookups);
+    return firstError;
+}
+
+/// @brief Retrieves the runtime IDs of many blocks at once
+/// @param world World containing the blocks
+/// @param positions Positions of the blocks
+/// @param count Amount of positions
+/// @param options Pipeline used to load missing subchunks in parallel, NULL loads them on the calling thread
+/// @param ids Array of at least count integers that will contain the runtime IDs, in the order of the positions
+/// @returns Result
+/// @attention The positions are grouped by subchunk, so every subchunk is looked up and loaded only once and its
+///            blocks are read in storage order. Blocks in subchunks that do not exist or failed to load get
+///            INVALID_BLOCK_STATE_ID. The first error other than SUBCHUNK_NOT_FOUND is returned after all
+///            positions have been processed.
+Result GetBlockIds(
+        World* world, const Position* positions, size_t count, const PipelineOptions* options, unsigned int* ids
+) {
+    return LookupBlocks(world, positions, count, options, ids, NULL);
+}
+
+/// @brief Retrieves many blocks at once
+/// @param world World containing the blocks
+/// @param positions Positions of the blocks
+/// @param count Amount of positions
+/// @param options Pipeline used to load missing subchunks in parallel, NULL loads them on the calling thread
+/// @param blocks Array of at least count pointers that will point to the block states, in the order of the positions
+/// @returns Result
+/// @attention This function is very similar to GetBlockIds, blocks that could not be retrieved are NULL
+Result GetBlocks(
+        World* world, const Position* positions, size_t count, const PipelineOptions* options, const NbtTag** blocks
+) {
+    return LookupBlocks(world, positions, count, options, NULL, blocks);
+}
@@ -45,6 +45,7 @@ ByteStream* CreateByteStream(unsigned int preAllocated) {
     }
 
     pStream->position = 0;
+    pStream->length = preAllocated;
     return pStream;
 }
 
@@ -65,6 +66,19 @@ ByteStream* CreateFilledByteStream(unsigned char* data, unsigned int size) {
     return stream;
 }
 
+/// @brief Initializes a bytestream on top of memory owned by the caller
+/// @param stream Bytestream to be initialized, usually allocated on the stack
+/// @param data Data the bytestream should read from
+/// @param size Size of the data argument
+/// @internal
+/// @attention The data is not copied, it has to stay alive for as long as the bytestream is used.
+///            Never call DestroyByteStream on a bytestream initialized using this function.
+void InitByteStream(ByteStream* stream, const unsigned char* data, unsigned int size) {
+    stream->position = 0;
+    stream->length = size;
+    stream->buffer = (unsigned char*)data;
+}
+
 /// @brief Destroys the bytestream and optionally frees the internal buffer
 /// @param stream Bytestream to be freed
 /// @param freeBuffer Boolean to specify if the internal buffer should be freed too
@@ -86,7 +100,7 @@ void WriteByte(ByteStream* stream, unsigned char value) {
 /// @param value Value to be put written into the buffer
 void WriteShort(ByteStream* stream, short value) {
     for(unsigned char i = 0; i < 2; i++) {
-        stream->buffer[stream->position + i] = (char)value << (i * 8);
+        stream->buffer[stream->position + i] = (unsigned char)((unsigned short)value >> (i * 8));
     }
     stream->position += 2;
 }
@@ -96,7 +110,7 @@ void WriteShort(ByteStream* stream, short value) {
 /// @param value Value to be put written into the buffer
 void WriteInt(ByteStream* stream, int value) {
     for(unsigned char i = 0; i < 4; i++) {
-        stream->buffer[stream->position + i] = (char)value << (i * 8);
+        stream->buffer[stream->position + i] = (unsigned char)((unsigned int)value >> (i * 8));
     }
     stream->position += 4;
 }
@@ -104,9 +118,9 @@ void WriteInt(ByteStream* stream, int value) {
 /// @brief Writes a long into the buffer in the bytestream
 /// @param stream Bytestream to write value into
 /// @param value Value to be put written into the buffer
-void WriteLong(ByteStream* stream, long value) {
+void WriteLong(ByteStream* stream, long long value) {
     for(unsigned char i = 0; i < 8; i++) {
-        stream->buffer[stream->position + i] = (char)value << (i * 8);
+        stream->buffer[stream->position + i] = (unsigned char)((unsigned long long)value >> (i * 8));
     }
     stream->position += 8;
 }
@@ -145,9 +159,9 @@ unsigned char ReadByte(ByteStream* stream) {
 /// @brief Reads a short from the buffer in the bytestream
 /// @param stream Bytestream to read the value from
 short ReadShort(ByteStream* stream) {
-    int value = 0;
+    unsigned short value = 0;
     for(unsigned char i = 0; i < 2; i++) {
-        value += stream->buffer[stream->position + i] >> (i * 8);
+        value |= (unsigned short)(stream->buffer[stream->position + i] << (i * 8));
     }
     stream->position += 2;
     return (short)value;
@@ -156,23 +170,23 @@ short ReadShort(ByteStream* stream) {
 /// @brief Reads an int from the buffer in the bytestream
 /// @param stream Bytestream to read the value from
 int ReadInt(ByteStream* stream) {
-    int value = 0;
+    unsigned int value = 0;
     for(unsigned char i = 0; i < 4; i++) {
-        value += stream->buffer[stream->position + i] >> (i * 8);
+        value |= (unsigned int)stream->buffer[stream->position + i] << (i * 8);
     }
     stream->position += 4;
-    return value;
+    return (int)value;
 }
 
 /// @brief Reads a long from the buffer in the bytestream
 /// @param stream Bytestream to read the value from
-long ReadLong(ByteStream* stream) {
-    long value = 0;
+long long ReadLong(ByteStream* stream) {
+    unsigned long long value = 0;
     for(unsigned char i = 0; i < 8; i++) {
-        value += stream->buffer[stream->position + i] >> (i * 8);
+        value |= (unsigned long long)stream->buffer[stream->position + i] << (i * 8);
     }
     stream->position += 8;
-    return value;
+    return (long long)value;
 }
 
 /// @brief Reads a float from the buffer in the bytestream
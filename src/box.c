@@ -0,0 +1,266 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "BedrockFormat/box.h"
+#include "BedrockFormat/binary.h"
+#include "BedrockFormat/cache.h"
+#include "BedrockFormat/registry.h"
+#include "BedrockFormat/storage.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// @brief Lowest and highest block y that subchunk keys can address, their y byte is signed
+/// @internal
+#define BOX_MIN_Y (-128 * 16)
+#define BOX_MAX_Y (127 * 16 + 15)
+
+/// @brief Column of a box together with the key prefix it is sorted by
+/// @internal
+typedef struct BoxColumn_T {
+    unsigned char bytes[8];
+    int x;
+    int z;
+} BoxColumn;
+
+/// @brief State of a single ForEachBlockInBox call
+/// @internal
+typedef struct BlockRunVisit_T {
+    BlockRunCallback callback;
+    void* userData;
+    unsigned short indices[SUBCHUNK_BLOCK_COUNT];
+    unsigned int ids[SUBCHUNK_BLOCK_COUNT];
+} BlockRunVisit;
+
+/// @brief Orders columns the same way LevelDB orders their keys
+/// @internal
+static int CompareBoxColumns(const void* a, const void* b) {
+    return memcmp(((const BoxColumn*)a)->bytes, ((const BoxColumn*)b)->bytes, 8);
+}
+
+/// @brief Visits every subchunk that intersects a box
+/// @param world World the box is located in
+/// @param dimension Dimension the box is located in
+/// @param box Box in block coordinates, y is clamped to the range subchunk keys can address
+/// @param callback Function that is called for every subchunk, returning 0 stops the iteration
+/// @param userData Pointer that is passed to the callback
+/// @returns Result
+/// @attention Subchunks are visited in the order of their database keys and loaded into the chunk cache on the way.
+///            They are pinned while the callback runs. Subchunks that do not exist are visited with a NULL subchunk.
+///            Subchunks that fail to load are visited the same way and the first error is returned at the end.
+Result ForEachSubchunkInBox(
+        World* world, Dimension dimension, const BlockBox* box, SubchunkSpanCallback callback, void* userData
+) {
+    int minY = box->minY < BOX_MIN_Y ? BOX_MIN_Y : box->minY;
+    int maxY = box->maxY > BOX_MAX_Y ? BOX_MAX_Y : box->maxY;
+    if(box->maxX < box->minX || box->maxZ < box->minZ || maxY < minY) {
+        return SUCCESS;
+    }
+
+    int minColumnX = box->minX >> 4;
+    int maxColumnX = box->maxX >> 4;
+    int minColumnZ = box->minZ >> 4;
+    int maxColumnZ = box->maxZ >> 4;
+
+    size_t columnCount = ((size_t)maxColumnX - minColumnX + 1) * ((size_t)maxColumnZ - minColumnZ + 1);
+    BoxColumn* columns = malloc(columnCount * sizeof(BoxColumn));
+    if(columns == NULL) {
+        fprintf(stderr, "Failed to allocate %zu box columns\n", columnCount);
+        return ALLOCATION_FAILED;
+    }
+
+    size_t i = 0;
+    for(int x = minColumnX; x <= maxColumnX; x++) {
+        for(int z = minColumnZ; z <= maxColumnZ; z++, i++) {
+            ByteStream stream = { 0, 8, columns[i].bytes };
+            WriteInt(&stream, x);
+            WriteInt(&stream, z);
+            columns[i].x = x;
+            columns[i].z = z;
+        }
+    }
+    qsort(columns, columnCount, sizeof(BoxColumn), CompareBoxColumns);
+
+    Result firstError = SUCCESS;
+    int visiting = 1;
+    for(i = 0; i < columnCount && visiting; i++) {
+        SubchunkSpan span;
+        span.x = columns[i].x;
+        span.z = columns[i].z;
+        span.minX = (unsigned char)(span.x == minColumnX ? box->minX & 15 : 0);
+        span.maxX = (unsigned char)(span.x == maxColumnX ? box->maxX & 15 : 15);
+        span.minZ = (unsigned char)(span.z == minColumnZ ? box->minZ & 15 : 0);
+        span.maxZ = (unsigned char)(span.z == maxColumnZ ? box->maxZ & 15 : 15);
+
+        for(int y = minY >> 4; y <= maxY >> 4 && visiting; y++) {
+            span.y = (unsigned char)(signed char)y;
+            span.minY = (unsigned char)(y == minY >> 4 ? minY & 15 : 0);
+            span.maxY = (unsigned char)(y == maxY >> 4 ? maxY & 15 : 15);
+
+            Result result = LoadSubchunk(world, &span.subchunk, span.x, span.y, span.z, dimension);
+            if(BF_FAILED(result)) {
+                if(result != SUBCHUNK_NOT_FOUND && !BF_FAILED(firstError)) firstError = result;
+                span.subchunk = NULL;
+            }
+
+            // The callback might load other subchunks, which must not evict the one it is looking at
+            if(span.subchunk != NULL) PinSubchunk(world, span.subchunk);
+            visiting = callback(userData, &span);
+            if(span.subchunk != NULL) UnpinSubchunk(world, span.subchunk);
+        }
+    }
+
+    free(columns);
+    return firstError;
+}
+
+/// @brief Resolves the runtime IDs of a run of blocks and hands it to the callback
+/// @internal
+static int EmitBlockRun(BlockRunVisit* visit, const SubchunkSpan* span, unsigned int start, unsigned int length) {
+    const BlockStorage* storage = span->subchunk != NULL ? &span->subchunk->storage : NULL;
+
+    unsigned int* ids = visit->ids + start;
+    if(storage == NULL) {
+        for(unsigned int i = 0; i < length; i++) ids[i] = INVALID_BLOCK_STATE_ID;
+    } else if(storage->bitsPerBlock == 0) {
+        for(unsigned int i = 0; i < length; i++) ids[i] = storage->palette[0];
+    } else {
+        const unsigned short* indices = visit->indices + start;
+        for(unsigned int i = 0; i < length; i++) ids[i] = storage->palette[indices[i]];
+    }
+
+    BlockRun run;
+    run.x = span->x * 16 + (int)(start >> 8);
+    run.y = (signed char)span->y * 16 + (int)(start & 15);
+    run.z = span->z * 16 + (int)((start >> 4) & 15);
+    run.length = length;
+    run.ids = ids;
+    run.subchunk = span->subchunk;
+
+    return visit->callback(visit->userData, &run);
+}
+
+/// @brief Splits the part of a subchunk inside the box into runs that are contiguous in storage order
+/// @internal
+static int VisitSpanRuns(void* userData, const SubchunkSpan* span) {
+    BlockRunVisit* visit = userData;
+
+    if(span->subchunk != NULL && span->subchunk->storage.bitsPerBlock != 0) {
+        ExpandBlockStorage(&span->subchunk->storage, visit->indices);
+    }
+
+    // Spans that cover whole columns of the subchunk merge into longer runs, up to the whole subchunk
+    int wholeY = span->minY == 0 && span->maxY == 15;
+    int wholeZ = wholeY && span->minZ == 0 && span->maxZ == 15;
+    if(wholeZ) {
+        return EmitBlockRun(visit, span, 256u * span->minX, 256u * (span->maxX - span->minX + 1u));
+    }
+
+    for(unsigned int x = span->minX; x <= span->maxX; x++) {
+        if(wholeY) {
+            if(!EmitBlockRun(visit, span, 256 * x + 16u * span->minZ, 16u * (span->maxZ - span->minZ + 1u))) return 0;
+            continue;
+        }
+
+        for(unsigned int z = span->minZ; z <= span->maxZ; z++) {
+            if(!EmitBlockRun(visit, span, 256 * x + 16 * z + span->minY, span->maxY - span->minY + 1u)) return 0;
+        }
+    }
+
+    return 1;
+}
+
+/// @brief Visits every block inside a box in runs of blocks that follow each other in storage order
+/// @param world World the box is located in
+/// @param dimension Dimension the box is located in
+/// @param box Box in block coordinates, y is clamped to the range subchunk keys can address
+/// @param callback Function that is called for every run, returning 0 stops the iteration
+/// @param userData Pointer that is passed to the callback
+/// @returns Result
+/// @attention Subchunks are visited in the same order as ForEachSubchunkInBox. Every subchunk is unpacked once and
+///            a run covers up to the whole subchunk, so the callback is called far less often than once per block.
+Result ForEachBlockInBox(
+        World* world, Dimension dimension, const BlockBox* box, BlockRunCallback callback, void* userData
+) {
+    BlockRunVisit* visit = malloc(sizeof(BlockRunVisit));
+    if(visit == NULL) {
+        fprintf(stderr, "Failed to allocate block run buffers\n");
+        return ALLOCATION_FAILED;
+    }
+
+    visit->callback = callback;
+    visit->userData = userData;
+
+    Result result = ForEachSubchunkInBox(world, dimension, box, VisitSpanRuns, visit);
+    free(visit);
+    return result;
+}
+
+/// @brief State of a single FillBlockBox call
+/// @internal
+typedef struct BlockFill_T {
+    World* world;
+    unsigned int runtimeId;
+    Result result;
+} BlockFill;
+
+/// @brief Fills the part of a subchunk inside the box in runs that are contiguous in storage order
+/// @internal
+static int FillSpanRuns(void* userData, const SubchunkSpan* span) {
+    BlockFill* fill = userData;
+    if(span->subchunk == NULL) {
+        return 1;
+    }
+
+    // Runs are merged the same way VisitSpanRuns merges them, a box covering the subchunk is a single run
+    int wholeY = span->minY == 0 && span->maxY == 15;
+    int wholeZ = wholeY && span->minZ == 0 && span->maxZ == 15;
+    if(wholeZ) {
+        fill->result = FillSubchunkBlockRun(
+                fill->world, span->subchunk, 256u * span->minX, 256u * (span->maxX - span->minX + 1u), fill->runtimeId
+        );
+        return !BF_FAILED(fill->result);
+    }
+
+    for(unsigned int x = span->minX; x <= span->maxX; x++) {
+        for(unsigned int z = span->minZ; z <= span->maxZ; z++) {
+            unsigned int start = wholeY ? 256 * x + 16u * span->minZ : 256 * x + 16 * z + span->minY;
+            unsigned int length = wholeY ? 16u * (span->maxZ - span->minZ + 1u) : span->maxY - span->minY + 1u;
+
+            fill->result = FillSubchunkBlockRun(fill->world, span->subchunk, start, length, fill->runtimeId);
+            if(BF_FAILED(fill->result)) return 0;
+            if(wholeY) break;
+        }
+    }
+
+    return 1;
+}
+
+/// @brief Changes every block inside a box to the same state
+/// @param world World the box is located in
+/// @param dimension Dimension the box is located in
+/// @param box Box in block coordinates, y is clamped to the range subchunk keys can address
+/// @param runtimeId Runtime ID of the new block state
+/// @returns Result
+/// @attention Subchunks that do not exist are skipped, they are not created. Every subchunk that changes is marked
+///            as dirty, see SetBlockIdAtSubchunkPosition.
+Result FillBlockBox(World* world, Dimension dimension, const BlockBox* box, unsigned int runtimeId) {
+    BlockFill fill;
+    fill.world = world;
+    fill.runtimeId = runtimeId;
+    fill.result = SUCCESS;
+
+    Result result = ForEachSubchunkInBox(world, dimension, box, FillSpanRuns, &fill);
+    return BF_FAILED(fill.result) ? fill.result : result;
+}
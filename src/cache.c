@@ -0,0 +1,381 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "BedrockFormat/cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define INITIAL_CHUNK_CACHE_SLOTS 256
+
+/// @brief Packs the position of a subchunk into a single integer key
+/// @param x X-coordinate of the subchunk
+/// @param y Y-coordinate of the subchunk
+/// @param z Z-coordinate of the subchunk
+/// @param dimension Dimension the subchunk is located in
+/// @returns Key used by the chunk cache
+/// @attention X and Z get 26 bits each, which covers the whole 30 million block world border
+unsigned long long PackSubchunkKey(int x, unsigned char y, int z, Dimension dimension) {
+    return ((unsigned long long)((unsigned int)x & 0x3FFFFFF) << 38) |
+           ((unsigned long long)((unsigned int)z & 0x3FFFFFF) << 12) |
+           ((unsigned long long)y << 4) |
+           ((unsigned long long)dimension & 0xF);
+}
+
+/// @brief Packs the position of a decoded subchunk into its cache key
+/// @internal
+static inline unsigned long long GetSubchunkKey(const Subchunk* subchunk) {
+    return PackSubchunkKey(
+            subchunk->position.x, subchunk->position.y, subchunk->position.z, subchunk->position.dimension
+    );
+}
+
+/// @brief Spreads the bits of a key over the whole word so neighbouring subchunks end up in different slots
+/// @internal
+static inline unsigned long long MixKey(unsigned long long key) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    key *= 0xC4CEB9FE1A85EC53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+/// @brief Creates a new chunk cache
+/// @param budget Amount of bytes the decoded subchunks are allowed to occupy
+/// @returns Pointer to a chunk cache or NULL if the allocation failed
+/// @internal
+ChunkCache* CreateChunkCache(size_t budget) {
+    ChunkCache* cache = calloc(1, sizeof(ChunkCache));
+    if(cache == NULL) {
+        fprintf(stderr, "Failed to allocate chunk cache\n");
+        return NULL;
+    }
+
+    cache->slots = calloc(INITIAL_CHUNK_CACHE_SLOTS, sizeof(ChunkCacheSlot));
+    if(cache->slots == NULL) {
+        fprintf(stderr, "Failed to allocate chunk cache slots\n");
+        free(cache);
+        return NULL;
+    }
+
+    cache->slotMask = INITIAL_CHUNK_CACHE_SLOTS - 1;
+    cache->budget = budget;
+    return cache;
+}
+
+/// @brief Looks up the cache entry of a subchunk
+/// @internal
+static ChunkCacheEntry* FindEntry(ChunkCache* cache, unsigned long long key) {
+    for(unsigned int i = (unsigned int)MixKey(key) & cache->slotMask;; i = (i + 1) & cache->slotMask) {
+        ChunkCacheSlot* slot = &cache->slots[i];
+        if(slot->entry == NULL) return NULL;
+        if(slot->key == key) return slot->entry;
+    }
+}
+
+/// @brief Places an entry in the first free slot of its probe sequence
+/// @internal
+static void PlaceEntry(ChunkCacheSlot* slots, unsigned int slotMask, ChunkCacheEntry* entry) {
+    unsigned int i = (unsigned int)MixKey(entry->key) & slotMask;
+    while(slots[i].entry != NULL) {
+        i = (i + 1) & slotMask;
+    }
+
+    slots[i].key = entry->key;
+    slots[i].entry = entry;
+}
+
+/// @brief Doubles the amount of slots once the table is half full
+/// @internal
+static Result GrowIndex(ChunkCache* cache) {
+    unsigned int slotCount = cache->slotMask + 1;
+    if((cache->entryCount + 1) * 2 <= slotCount) {
+        return SUCCESS;
+    }
+
+    ChunkCacheSlot* slots = calloc(slotCount * 2, sizeof(ChunkCacheSlot));
+    if(slots == NULL) {
+        fprintf(stderr, "Failed to grow chunk cache to %u slots\n", slotCount * 2);
+        return ALLOCATION_FAILED;
+    }
+
+    for(unsigned int i = 0; i < slotCount; i++) {
+        if(cache->slots[i].entry != NULL) {
+            PlaceEntry(slots, slotCount * 2 - 1, cache->slots[i].entry);
+        }
+    }
+
+    free(cache->slots);
+    cache->slots = slots;
+    cache->slotMask = slotCount * 2 - 1;
+    return SUCCESS;
+}
+
+/// @brief Removes a key from the index
+/// @internal
+/// @attention The entries behind the removed slot are shifted back, so lookups never have to skip tombstones
+static void RemoveIndexKey(ChunkCache* cache, unsigned long long key) {
+    unsigned int i = (unsigned int)MixKey(key) & cache->slotMask;
+    for(;; i = (i + 1) & cache->slotMask) {
+        if(cache->slots[i].entry == NULL) return;
+        if(cache->slots[i].key == key) break;
+    }
+
+    for(unsigned int j = (i + 1) & cache->slotMask;; j = (j + 1) & cache->slotMask) {
+        if(cache->slots[j].entry == NULL) break;
+
+        // An entry can only move back if its home slot is not between the hole and its current slot
+        unsigned int home = (unsigned int)MixKey(cache->slots[j].key) & cache->slotMask;
+        if(((j - home) & cache->slotMask) >= ((j - i) & cache->slotMask)) {
+            cache->slots[i] = cache->slots[j];
+            i = j;
+        }
+    }
+
+    cache->slots[i].key = 0;
+    cache->slots[i].entry = NULL;
+}
+
+/// @brief Unlinks an entry from the index and the clock ring
+/// @internal
+static void UnlinkEntry(ChunkCache* cache, ChunkCacheEntry* entry) {
+    RemoveIndexKey(cache, entry->key);
+
+    if(entry->next == entry) {
+        cache->hand = NULL;
+    } else {
+        entry->previous->next = entry->next;
+        entry->next->previous = entry->previous;
+        if(cache->hand == entry) cache->hand = entry->next;
+    }
+
+    cache->size -= entry->size;
+    cache->entryCount--;
+}
+
+/// @brief Unlinks an entry from the cache and frees it together with its subchunk
+/// @internal
+static void DropEntry(ChunkCache* cache, ChunkCacheEntry* entry) {
+    UnlinkEntry(cache, entry);
+
+    FreeSubchunk(NULL, entry->subchunk);
+    free(entry);
+}
+
+/// @brief Frees the chunk cache and every subchunk in it, including pinned subchunks
+/// @param cache Cache to be freed
+/// @internal
+void DestroyChunkCache(ChunkCache* cache) {
+    while(cache->hand != NULL) {
+        DropEntry(cache, cache->hand);
+    }
+
+    free(cache->slots);
+    free(cache);
+}
+
+/// @brief Retrieves a subchunk from the cache
+/// @param cache Cache to search
+/// @param key Key of the subchunk, see PackSubchunkKey
+/// @returns The subchunk or NULL if it is not in the cache
+/// @internal
+Subchunk* FindCachedSubchunk(ChunkCache* cache, unsigned long long key) {
+    ChunkCacheEntry* entry = FindEntry(cache, key);
+    if(entry == NULL) {
+        cache->misses++;
+        return NULL;
+    }
+
+    cache->hits++;
+    entry->referenced = 1;
+    return entry->subchunk;
+}
+
+/// @brief Evicts unpinned subchunks until the cache occupies at most the given amount of bytes
+/// @param cache Cache to evict from
+/// @param target Amount of bytes the cache may still occupy
+/// @attention Every entry gets a second chance: an entry that was used since the clock hand last passed it
+///            is skipped once. Pinned and dirty entries are never evicted, so the target is not always reached.
+/// @internal
+void EvictChunkCache(ChunkCache* cache, size_t target) {
+    // Two sweeps clear every reference bit, anything that is left after that is pinned or dirty
+    unsigned int remaining = cache->entryCount * 2;
+
+    while(cache->size > target && cache->hand != NULL && remaining > 0) {
+        ChunkCacheEntry* entry = cache->hand;
+        remaining--;
+
+        if(entry->pins > 0 || entry->subchunk->dirty) {
+            cache->hand = entry->next;
+        } else if(entry->referenced) {
+            entry->referenced = 0;
+            cache->hand = entry->next;
+        } else {
+            DropEntry(cache, entry);
+            cache->evictions++;
+        }
+    }
+}
+
+/// @brief Inserts a subchunk into the cache, evicting other subchunks if the budget is exceeded
+/// @param cache Cache to insert the subchunk into
+/// @param subchunk Subchunk to be inserted, the cache takes ownership
+/// @returns Result
+/// @internal
+Result InsertCachedSubchunk(ChunkCache* cache, Subchunk* subchunk) {
+    ChunkCacheEntry* entry = malloc(sizeof(ChunkCacheEntry));
+    if(entry == NULL) {
+        fprintf(stderr, "Failed to allocate chunk cache entry\n");
+        return ALLOCATION_FAILED;
+    }
+
+    entry->key = GetSubchunkKey(subchunk);
+    entry->subchunk = subchunk;
+    entry->size = GetSubchunkMemorySize(subchunk) + sizeof(ChunkCacheEntry);
+    entry->pins = 0;
+    entry->referenced = 1;
+
+    EvictChunkCache(cache, entry->size < cache->budget ? cache->budget - entry->size : 0);
+
+    Result result = GrowIndex(cache);
+    if(BF_FAILED(result)) {
+        free(entry);
+        return result;
+    }
+    PlaceEntry(cache->slots, cache->slotMask, entry);
+
+    // New entries are placed right behind the hand so they are the last ones to be considered for eviction
+    if(cache->hand == NULL) {
+        entry->next = entry;
+        entry->previous = entry;
+        cache->hand = entry;
+    } else {
+        entry->next = cache->hand;
+        entry->previous = cache->hand->previous;
+        entry->previous->next = entry;
+        cache->hand->previous = entry;
+    }
+
+    cache->size += entry->size;
+    cache->entryCount++;
+    return SUCCESS;
+}
+
+/// @brief Hands a freshly decoded subchunk to the cache unless the cache already holds that subchunk
+/// @param cache Cache to insert the subchunk into
+/// @param subchunk Decoded subchunk, the cache takes ownership and frees it if it is not needed
+/// @param cached Pointer that will point to the subchunk that is in the cache afterwards
+/// @returns Result
+/// @internal
+Result AdoptCachedSubchunk(ChunkCache* cache, Subchunk* subchunk, Subchunk** cached) {
+    ChunkCacheEntry* entry = FindEntry(cache, GetSubchunkKey(subchunk));
+    if(entry != NULL) {
+        FreeSubchunk(NULL, subchunk);
+        *cached = entry->subchunk;
+        return SUCCESS;
+    }
+
+    Result result = InsertCachedSubchunk(cache, subchunk);
+    if(BF_FAILED(result)) {
+        FreeSubchunk(NULL, subchunk);
+        return result;
+    }
+
+    *cached = subchunk;
+    return SUCCESS;
+}
+
+/// @brief Removes a subchunk from the cache without freeing it
+/// @param cache Cache containing the subchunk
+/// @param subchunk Subchunk to be removed
+/// @internal
+void RemoveCachedSubchunk(ChunkCache* cache, Subchunk* subchunk) {
+    ChunkCacheEntry* entry = FindEntry(cache, GetSubchunkKey(subchunk));
+    if(entry == NULL || entry->subchunk != subchunk) return;
+
+    UnlinkEntry(cache, entry);
+    free(entry);
+}
+
+/// @brief Recalculates the size of a cached subchunk after an edit allocated from its arena
+/// @param cache Cache containing the subchunk
+/// @param subchunk Subchunk that has been edited
+/// @internal
+void UpdateCachedSubchunkSize(ChunkCache* cache, Subchunk* subchunk) {
+    ChunkCacheEntry* entry = FindEntry(cache, GetSubchunkKey(subchunk));
+    if(entry == NULL || entry->subchunk != subchunk) return;
+
+    size_t size = GetSubchunkMemorySize(subchunk) + sizeof(ChunkCacheEntry);
+    cache->size = cache->size - entry->size + size;
+    entry->size = size;
+}
+
+/// @brief Changes how much memory the decoded subchunks of a world are allowed to occupy
+/// @param world World containing the chunk cache
+/// @param budget Budget in bytes
+/// @attention Lowering the budget evicts subchunks right away
+void SetChunkCacheBudget(World* world, size_t budget) {
+    world->chunkCache->budget = budget;
+    EvictChunkCache(world->chunkCache, budget);
+}
+
+/// @brief Retrieves the usage counters of the chunk cache
+/// @param world World containing the chunk cache
+/// @param stats Struct that will be populated with the counters
+void GetChunkCacheStats(World* world, ChunkCacheStats* stats) {
+    ChunkCache* cache = world->chunkCache;
+
+    stats->budget = cache->budget;
+    stats->size = cache->size;
+    stats->entryCount = cache->entryCount;
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+
+    stats->pinnedCount = 0;
+    stats->dirtyCount = 0;
+    ChunkCacheEntry* entry = cache->hand;
+    for(unsigned int i = 0; i < cache->entryCount; i++, entry = entry->next) {
+        if(entry->pins > 0) stats->pinnedCount++;
+        if(entry->subchunk->dirty) stats->dirtyCount++;
+    }
+}
+
+/// @brief Prevents a subchunk from being evicted from the chunk cache
+/// @param world World containing the subchunk
+/// @param subchunk Subchunk to be pinned
+/// @returns Result
+/// @attention Every call has to be paired with a call to UnpinSubchunk
+Result PinSubchunk(World* world, Subchunk* subchunk) {
+    ChunkCacheEntry* entry = FindEntry(world->chunkCache, GetSubchunkKey(subchunk));
+    if(entry == NULL || entry->subchunk != subchunk) {
+        return SUBCHUNK_NOT_FOUND;
+    }
+
+    entry->pins++;
+    return SUCCESS;
+}
+
+/// @brief Allows a pinned subchunk to be evicted again
+/// @param world World containing the subchunk
+/// @param subchunk Subchunk to be unpinned
+void UnpinSubchunk(World* world, Subchunk* subchunk) {
+    ChunkCacheEntry* entry = FindEntry(world->chunkCache, GetSubchunkKey(subchunk));
+    if(entry == NULL || entry->subchunk != subchunk || entry->pins == 0) return;
+
+    entry->pins--;
+    if(entry->pins == 0 && world->chunkCache->size > world->chunkCache->budget) {
+        EvictChunkCache(world->chunkCache, world->chunkCache->budget);
+    }
+}
@@ -12,232 +12,689 @@
 
 #include "BedrockFormat/chunk.h"
 #include "BedrockFormat/binary.h"
+#include "BedrockFormat/cache.h"
 #include "BedrockFormat/format.h"
 #include "BedrockFormat/nbt.h"
+#include "BedrockFormat/presence.h"
+#include "BedrockFormat/registry.h"
+#include "BedrockFormat/storage.h"
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <math.h>
+#include <string.h>
 
 /// @brief Generates a key for a subchunk database entry
 /// @param Position Subchunk position
-/// @param bufferLen Pointer to an unsigned integer containing the length of the returned buffer
-/// @returns The raw subchunk data
+/// @param key Buffer of at least SUBCHUNK_KEY_MAX_LENGTH bytes to write the key into
+/// @returns Length of the generated key
 /// @internal
-inline unsigned char* GenerateSubchunkKey(int x, unsigned char y, int z, Dimension dimension, unsigned int* bufferLen) {
-    unsigned int bufferSize = 4 + 4 + 1 + 1;
-    if(dimension != OVERWORLD) bufferSize += 4;
+unsigned int GenerateSubchunkKey(int x, unsigned char y, int z, Dimension dimension, unsigned char* key) {
+    ByteStream stream = { 0, SUBCHUNK_KEY_MAX_LENGTH, key };
 
-    ByteStream* stream = CreateByteStream(bufferSize);
-    if(stream == NULL) {
-        return NULL;
+    WriteInt(&stream, x);
+    WriteInt(&stream, z);
+    if(dimension != OVERWORLD) WriteInt(&stream, dimension);
+
+    WriteByte(&stream, 0x2f);
+    WriteByte(&stream, y);
+
+    return stream.position;
+}
+
+/// @brief Extracts the position of a subchunk from its database key
+/// @param key Database key
+/// @param keyLen Length of the key
+/// @param x Pointer to an integer that will contain the x-coordinate of the subchunk
+/// @param y Pointer to a byte that will contain the y-coordinate of the subchunk
+/// @param z Pointer to an integer that will contain the z-coordinate of the subchunk
+/// @param dimension Pointer that will contain the dimension of the subchunk
+/// @returns 1 if the key belongs to a subchunk, 0 otherwise
+int ParseSubchunkKey(
+        const unsigned char* key, unsigned int keyLen, int* x, unsigned char* y, int* z, Dimension* dimension
+) {
+    ByteStream stream;
+    InitByteStream(&stream, key, keyLen);
+
+    if(keyLen == 10 && key[8] == 0x2f) {
+        *dimension = OVERWORLD;
+    } else if(keyLen == 14 && key[12] == 0x2f) {
+        stream.position = 8;
+        int value = ReadInt(&stream);
+        if(value != NETHER && value != END) return 0;
+        *dimension = (Dimension)value;
+    } else {
+        return 0;
     }
 
-    WriteInt(stream, x);
-    WriteInt(stream, z);
-    if(dimension != OVERWORLD) WriteInt(stream, dimension);
+    stream.position = 0;
+    *x = ReadInt(&stream);
+    *z = ReadInt(&stream);
+    *y = key[keyLen - 1];
+    return 1;
+}
+
+/// @brief Block storage that has been read up to its palette, but has not been allocated yet
+/// @internal
+typedef struct PendingBlockStorage_T {
+    const unsigned char* words;
+    unsigned char storedBitsPerBlock;
+    unsigned char bitsPerBlock;
+    int uniform;
+    unsigned int paletteSize;
+    unsigned short blocks[SUBCHUNK_BLOCK_COUNT];
+} PendingBlockStorage;
 
-    WriteByte(stream, 0x2f);
-    WriteByte(stream, y);
+/// @brief Reads the width, the packed words and the palette size of a block storage
+/// @param stream Bytestream positioned at the width byte of the storage, it is left at the first palette entry
+/// @param bitsPerBlock Pointer to a byte that will contain the width of the stored indices
+/// @param words Pointer that will point at the packed words inside the stream, they are not copied
+/// @param paletteSize Pointer to an integer that will contain the amount of palette entries that follow
+/// @returns Result
+/// @attention Storages with a width of 0 have neither words nor a palette size, the single palette entry they
+///            have follows the width byte directly
+/// @internal
+Result ReadBlockStorageHeader(
+        ByteStream* stream, unsigned char* bitsPerBlock, const unsigned char** words, unsigned int* paletteSize
+) {
+    if(stream->length - stream->position < 1) {
+        fprintf(stderr, "Block storage is truncated\n");
+        return INVALID_DATA;
+    }
+
+    *bitsPerBlock = ReadByte(stream) >> 1;
+    if(!IsValidBitsPerBlock(*bitsPerBlock)) {
+        fprintf(stderr, "Block storage has an invalid width of %i bits per block\n", *bitsPerBlock);
+        return INVALID_DATA;
+    }
+
+    *words = stream->buffer + stream->position;
+    if(*bitsPerBlock == 0) {
+        *paletteSize = 1;
+        return SUCCESS;
+    }
+
+    unsigned int wordBytes = GetBlockStorageWordCount(*bitsPerBlock) * 4;
+    if(stream->length - stream->position < wordBytes + 4) {
+        fprintf(stderr, "Block storage is truncated\n");
+        return INVALID_DATA;
+    }
+    stream->position += wordBytes;
 
-    unsigned char* buffer = stream->buffer;
-    *bufferLen = bufferSize;
+    *paletteSize = (unsigned int)ReadInt(stream);
+    if(*paletteSize == 0 || *paletteSize > SUBCHUNK_BLOCK_COUNT) {
+        fprintf(stderr, "Block storage has an invalid palette size of %u\n", *paletteSize);
+        return INVALID_DATA;
+    }
 
-    DestroyByteStream(stream, 0);
-    return buffer;
+    return SUCCESS;
 }
 
-/// @brief Loads a subchunk and stores it in the world's chunk cache
-/// @param world World the subchunk is located in
-/// @param position Position of the subchunk
+/// @brief Reads the packed words and palette size of a block storage and picks the width it is kept at
+/// @param stream Bytestream positioned at the width byte of the storage, it is left at the first palette entry
+/// @param pending Storage to read the data into
 /// @returns Result
-/// @attention This function has to be called before you can use GetBlockAtWorldPosition or GetBlockAtSubchunkPosition
-Result LoadSubchunk(World* world, Subchunk** subchunk, int x, unsigned char y, int z, Dimension dimension) {
-    printf("Loading subchunk %i, %i, %i\n", x, y, z);
+/// @internal
+static Result ReadBlockStorageIndices(ByteStream* stream, PendingBlockStorage* pending) {
+    Result result = ReadBlockStorageHeader(
+            stream, &pending->storedBitsPerBlock, &pending->words, &pending->paletteSize
+    );
+    if(BF_FAILED(result)) {
+        return result;
+    }
 
-    Subchunk* decoded = malloc(sizeof(Subchunk));
-    if(decoded == NULL) {
-        fprintf(stderr, "Failed to allocate subchunk\n");
-        return ALLOCATION_FAILED;
+    UnpackBlockIndices(pending->words, pending->storedBitsPerBlock, pending->blocks);
+
+    unsigned short maxIndex = 0;
+    pending->uniform = 1;
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i++) {
+        if(pending->blocks[i] > maxIndex) maxIndex = pending->blocks[i];
+        pending->uniform &= pending->blocks[i] == pending->blocks[0];
+    }
+    if(maxIndex >= pending->paletteSize) {
+        fprintf(stderr, "Block storage references palette entry %i of %u\n", maxIndex, pending->paletteSize);
+        return INVALID_DATA;
     }
 
-    // Set position to NULL to make sure that whenever FreeSubchunk is called before the subchunk is added to the chunk
-    // cache FreeSubchunk will still work
-    decoded->position = NULL;
+    // Uniform storages only keep the palette entry that is used, so they need neither words nor a larger palette
+    pending->bitsPerBlock = pending->uniform ? 0 : GetMinimalBitsPerBlock(maxIndex + 1u);
+    return SUCCESS;
+}
+
+/// @brief Calculates how much arena memory a block storage is kept in
+/// @internal
+static size_t GetPendingBlockStorageSize(const PendingBlockStorage* pending) {
+    size_t paletteSize = pending->uniform ? 1 : pending->paletteSize;
+    size_t paletteBytes = (paletteSize * sizeof(unsigned int) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    return paletteBytes + GetBlockStorageWordCount(pending->bitsPerBlock) * 4;
+}
 
-    // Generate the database key that corresponds to the requested subchunk
-    unsigned int keyLen;
-    unsigned char* key = GenerateSubchunkKey(x, y, z, dimension, &keyLen);
-    if(keyLen == 0) {
+/// @brief Copies the indices of a block storage into the arena and interns its palette
+/// @param stream Bytestream positioned at the first palette entry, it is left behind the last one
+/// @param pending Storage read by ReadBlockStorageIndices
+/// @param storage Block storage to decode the data into
+/// @param arena Arena to allocate the palette and the packed words from
+/// @returns Result
+/// @attention Entries of uniform storages that no block uses are skipped instead of being interned
+/// @internal
+static Result DecodeBlockStoragePalette(
+        ByteStream* stream, const PendingBlockStorage* pending, BlockStorage* storage, Arena* arena
+) {
+    storage->paletteSize = (unsigned short)(pending->uniform ? 1 : pending->paletteSize);
+    storage->paletteCapacity = storage->paletteSize;
+    storage->bitsPerBlock = pending->bitsPerBlock;
+    storage->blocksPerWord = storage->bitsPerBlock != 0 ? (unsigned char)(32 / storage->bitsPerBlock) : 0;
+
+    size_t wordBytes = GetBlockStorageWordCount(storage->bitsPerBlock) * 4;
+    storage->palette = AllocateFromArena(arena, storage->paletteSize * sizeof(unsigned int));
+    storage->words = wordBytes != 0 ? AllocateFromArena(arena, wordBytes) : NULL;
+    if(storage->palette == NULL || (wordBytes != 0 && storage->words == NULL)) {
+        fprintf(stderr, "Failed to allocate block storage with %u block states\n", storage->paletteSize);
         return ALLOCATION_FAILED;
     }
 
-    // Load the subchunk from the database using the generated key
-    unsigned int rawBufferLen;
-    unsigned char* rawBuffer;
-    Result result = LoadEntry(world, key, keyLen, &rawBuffer, &rawBufferLen);
-    free(key);
+    if(storage->bitsPerBlock != pending->storedBitsPerBlock) {
+        PackBlockIndices(pending->blocks, storage->bitsPerBlock, storage->words);
+    } else if(wordBytes != 0) {
+        memcpy(storage->words, pending->words, wordBytes);
+    }
+
+    for(unsigned int j = 0; j < pending->paletteSize; j++) {
+        stream->position += 3; // Skip tag type and name
 
+        if(pending->uniform && j != pending->blocks[0]) {
+            if(!SkipNbtPayload(stream, NBT_COMPOUND)) {
+                fprintf(stderr, "Failed to skip NBT entry\n");
+                return DESERIALIZATION_FAILED;
+            }
+            continue;
+        }
+
+        Result result = InternBlockState(stream, &storage->palette[pending->uniform ? 0 : j]);
+        if(BF_FAILED(result)) {
+            fprintf(stderr, "Failed to decode NTB entry\n");
+            return result;
+        }
+    }
+
+    return SUCCESS;
+}
+
+/// @brief Moves the stream behind a block storage without decoding it
+/// @internal
+static Result SkipBlockStorage(ByteStream* stream) {
+    unsigned char bitsPerBlock;
+    const unsigned char* words;
+    unsigned int paletteSize;
+    Result result = ReadBlockStorageHeader(stream, &bitsPerBlock, &words, &paletteSize);
     if(BF_FAILED(result)) {
         return result;
     }
 
-    // Move the buffer into a byte stream to be able to read and write
-    ByteStream* stream = CreateFilledByteStream(rawBuffer, rawBufferLen);
-    if(stream == NULL) {
-        free(rawBuffer);
-        return ALLOCATION_FAILED;
+    for(unsigned int j = 0; j < paletteSize; j++) {
+        if(stream->length - stream->position < 3) {
+            fprintf(stderr, "Block storage is truncated\n");
+            return INVALID_DATA;
+        }
+        stream->position += 3; // Skip tag type and name
+
+        if(!SkipNbtPayload(stream, NBT_COMPOUND)) {
+            fprintf(stderr, "Failed to skip NBT entry\n");
+            return DESERIALIZATION_FAILED;
+        }
     }
 
-    decoded->version = ReadByte(stream);
-    if(decoded->version != 8 && decoded->version != 1) {
-        // Invalid subchunk
-        fprintf(
-                stderr, "Subchunk %i, %i, %i has version %i (should be either 1 or 8)\n",
-                x, y, z, decoded->version
-        );
-        DestroyByteStream(stream, 1);
-        free(decoded);
+    return SUCCESS;
+}
+
+/// @brief Decodes the value of a subchunk database entry
+/// @param stream Bytestream positioned at the start of the value
+/// @param decoded Subchunk to decode the data into
+/// @returns Result
+/// @attention The storages of the subchunk are only allocated when SUCCESS is returned, they live in the arena of the subchunk.
+///            Only the first layer is decoded, the layers after it are copied as they are and decoded by
+///            GetSubchunkLayer once they are needed.
+///            Block states are interned in the block state registry, the palette only holds their runtime IDs.
+///            This function does not touch the world, so it can be called from any thread.
+/// @internal
+Result DecodeSubchunk(ByteStream* stream, Subchunk* decoded) {
+    if(stream->length < 3) {
+        fprintf(stderr, "Subchunk is truncated\n");
         return INVALID_DATA;
     }
 
-    if(decoded->version == 8) {
-        stream->position++;
+    decoded->version = ReadByte(stream);
+    decoded->dirty = 0;
+    switch(decoded->version) {
+        case 1:
+            decoded->layerCount = 1;
+            break;
+        case 8:
+            decoded->layerCount = ReadByte(stream);
+            break;
+        case 9:
+            decoded->layerCount = ReadByte(stream);
+            stream->position++; // Skip the y-index, it matches the key of the subchunk
+            break;
+        default:
+            fprintf(stderr, "Subchunk has version %i (should be either 1, 8 or 9)\n", decoded->version);
+            return INVALID_DATA;
     }
 
-    for(unsigned char i = 0; i < 1; i++) {
-        unsigned char version = ReadByte(stream);
-        unsigned char bitsPerBlock = version >> 1;
+    if(decoded->layerCount == 0) {
+        fprintf(stderr, "Subchunk has no block storages\n");
+        return INVALID_DATA;
+    }
+
+    PendingBlockStorage pending;
+    Result result = ReadBlockStorageIndices(stream, &pending);
+    if(BF_FAILED(result)) {
+        return result;
+    }
 
-        unsigned int len = 0;
-        while(len < 4096) {
-            int w = ReadInt(stream);
+    // Find the offsets of the other layers before anything is allocated, so the arena can be sized at once
+    ByteStream layerStream = *stream;
+    unsigned int layerOffsets[255];
+    for(unsigned int i = 0; i < pending.paletteSize; i++) {
+        if(layerStream.length - layerStream.position < 3) {
+            fprintf(stderr, "Block storage is truncated\n");
+            return INVALID_DATA;
+        }
+        layerStream.position += 3;
 
-            unsigned int blockCount = 32 / bitsPerBlock;
-            unsigned int allOnes = 0xFFFFFFFF;
-            unsigned int lowerZeros = allOnes << bitsPerBlock;
-            unsigned int lowerOnes = ~lowerZeros;
+        if(!SkipNbtPayload(&layerStream, NBT_COMPOUND)) {
+            fprintf(stderr, "Failed to skip NBT entry\n");
+            return DESERIALIZATION_FAILED;
+        }
+    }
 
-            for(unsigned int j = 0; j < blockCount && len < 4096; j++) {
-                unsigned int b = w & lowerOnes;
-                decoded->blocks[len] = (unsigned short)b;
-                len++;
+    unsigned int layerStart = layerStream.position;
+    for(unsigned char i = 1; i < decoded->layerCount; i++) {
+        layerOffsets[i - 1] = layerStream.position - layerStart;
 
-                w >>= bitsPerBlock;
-            }
+        result = SkipBlockStorage(&layerStream);
+        if(BF_FAILED(result)) {
+            return result;
         }
+    }
+
+    size_t extraLayers = decoded->layerCount - 1u;
+    size_t layerDataLength = layerStream.position - layerStart;
+    size_t layerTableSize = (extraLayers * sizeof(SubchunkLayer) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    InitArena(&decoded->arena, GetPendingBlockStorageSize(&pending) + layerTableSize + layerDataLength);
 
-        decoded->paletteSize = (unsigned short)ReadInt(stream);
-        decoded->palette = malloc(sizeof(NbtTag*) * decoded->paletteSize);
-        if(decoded->palette == NULL) {
-            fprintf(stderr, "Failed to allocate 4096 block states\n");
-            DestroyByteStream(stream, 1);
-            free(decoded);
+    decoded->layers = NULL;
+    decoded->layerData = NULL;
+    decoded->layerDataLength = (unsigned int)layerDataLength;
+    if(extraLayers != 0) {
+        decoded->layers = AllocateFromArena(&decoded->arena, layerTableSize);
+        decoded->layerData = AllocateFromArena(&decoded->arena, layerDataLength);
+        if(decoded->layers == NULL || decoded->layerData == NULL) {
+            fprintf(stderr, "Failed to allocate %zu block storage layers\n", extraLayers);
+            DestroyArena(&decoded->arena);
             return ALLOCATION_FAILED;
         }
 
-        for(unsigned int j = 0; j < decoded->paletteSize; j++) {
-            stream->position += 3; // Skip tag type and name
+        memcpy(decoded->layerData, stream->buffer + layerStart, layerDataLength);
+        for(size_t i = 0; i < extraLayers; i++) {
+            decoded->layers[i].offset = layerOffsets[i];
+            decoded->layers[i].storage.palette = NULL;
+        }
+    }
 
-            struct hashmap_s* compoundEntries = malloc(sizeof(struct hashmap_s));
-            if(hashmap_create(2, compoundEntries) != 0) {
-                fprintf(stderr, "Failed to create hashmap\n");
-                DestroyByteStream(stream, 1);
-                free(decoded->palette);
-                free(decoded);
-                return ALLOCATION_FAILED;
-            }
+    result = DecodeBlockStoragePalette(stream, &pending, &decoded->storage, &decoded->arena);
+    if(BF_FAILED(result)) {
+        DestroyArena(&decoded->arena);
+        return result;
+    }
 
-            int decodeResult = DecodeNbtTagWithParent(stream, compoundEntries);
-            if(!decodeResult) {
-                fprintf(stderr, "Failed to decode NTB entry\n");
-                hashmap_destroy(compoundEntries);
-                DestroyByteStream(stream, 1);
-                free(decoded->palette);
-                free(decoded);
-                return DESERIALIZATION_FAILED;
-            }
+    stream->position = layerStream.position;
+    return SUCCESS;
+}
 
-            NbtTag* tag = malloc(sizeof(NbtTag));
-            if(tag == NULL) {
-                fprintf(stderr, "Failed to decode NTB entry\n");
-                hashmap_destroy(compoundEntries);
-                DestroyByteStream(stream, 1);
-                free(decoded->palette);
-                free(decoded);
-                return ALLOCATION_FAILED;
-            }
+/// @brief Retrieves a block storage layer of a subchunk, decoding it the first time it is requested
+/// @param subchunk Subchunk containing the layer
+/// @param layer Index of the layer, 0 is the layer every subchunk has and 1 usually contains water
+/// @param storage Pointer that will point to the decoded layer
+/// @returns Result, INVALID_ARGUMENT if the subchunk does not have the layer
+/// @attention Decoding a layer allocates from the arena of the subchunk, so this function must not be called
+///            for the same subchunk from more than one thread at a time
+Result GetSubchunkLayer(Subchunk* subchunk, unsigned char layer, BlockStorage** storage) {
+    if(layer == 0) {
+        *storage = &subchunk->storage;
+        return SUCCESS;
+    }
+
+    if(layer >= subchunk->layerCount) {
+        return INVALID_ARGUMENT;
+    }
 
-            tag->type = NBT_COMPOUND;
-            tag->payload = compoundEntries;
+    SubchunkLayer* lazy = &subchunk->layers[layer - 1];
+    if(lazy->storage.palette == NULL) {
+        ByteStream stream;
+        InitByteStream(&stream, subchunk->layerData, subchunk->layerDataLength);
+        stream.position = lazy->offset;
 
-            decoded->palette[j] = tag;
+        PendingBlockStorage pending;
+        Result result = ReadBlockStorageIndices(&stream, &pending);
+        if(!BF_FAILED(result)) {
+            result = DecodeBlockStoragePalette(&stream, &pending, &lazy->storage, &subchunk->arena);
+        }
+
+        if(BF_FAILED(result)) {
+            // The arena keeps whatever was allocated, the layer is decoded again on the next request
+            lazy->storage.palette = NULL;
+            fprintf(stderr, "Failed to decode layer %i of subchunk %i, %i, %i\n",
+                    layer, subchunk->position.x, subchunk->position.y, subchunk->position.z);
+            return result;
         }
     }
 
-    *subchunk = decoded;
+    *storage = &lazy->storage;
+    return SUCCESS;
+}
 
-    Position* subchunkPosition = malloc(sizeof(Position));
-    if(subchunkPosition == NULL) {
-        fprintf(stderr, "Failed to allocate subchunk position\n");
-        FreeSubchunk(NULL, decoded);
+/// @brief Decodes a subchunk database value into a newly allocated subchunk
+/// @param data Value of the subchunk database entry, it is decoded in place
+/// @param length Length of the value
+/// @param subchunk Pointer that will point to the decoded subchunk
+/// @returns Result
+/// @attention The subchunk is not added to the chunk cache, so this function can be called from any thread
+/// @internal
+Result DecodeSubchunkValue(
+        const unsigned char* data, unsigned int length,
+        int x, unsigned char y, int z, Dimension dimension, Subchunk** subchunk
+) {
+    Subchunk* decoded = malloc(sizeof(Subchunk));
+    if(decoded == NULL) {
+        fprintf(stderr, "Failed to allocate subchunk\n");
         return ALLOCATION_FAILED;
     }
 
-    subchunkPosition->x = x;
-    subchunkPosition->y = y;
-    subchunkPosition->z = z;
-    subchunkPosition->dimension = dimension;
-    decoded->position = subchunkPosition;
+    ByteStream stream;
+    InitByteStream(&stream, data, length);
 
-    if(hashmap_put(&world->chunkCache, (char*)subchunkPosition, sizeof(Position), decoded) != 0) {
-        fprintf(stderr, "Failed to insert subchunk into chunk cache\n");
-        FreeSubchunk(NULL, decoded);
-        return HASHMAP_INSERTION_FAILED;
+    Result result = DecodeSubchunk(&stream, decoded);
+    if(BF_FAILED(result)) {
+        fprintf(stderr, "Failed to decode subchunk %i, %i, %i\n", x, y, z);
+        free(decoded);
+        return result;
     }
 
-    // Cleanup
-    DestroyByteStream(stream, 1);
+    decoded->position.x = x;
+    decoded->position.y = y;
+    decoded->position.z = z;
+    decoded->position.dimension = dimension;
 
+    *subchunk = decoded;
     return SUCCESS;
 }
 
+/// @brief Decodes a subchunk database value and stores the subchunk in the world's chunk cache
+/// @internal
+static Result DecodeAndCacheSubchunk(
+        World* world, const unsigned char* data, unsigned int length,
+        int x, unsigned char y, int z, Dimension dimension, Subchunk** subchunk
+) {
+    Subchunk* decoded;
+    Result result = DecodeSubchunkValue(data, length, x, y, z, dimension, &decoded);
+    if(BF_FAILED(result)) {
+        return result;
+    }
+
+    return AdoptCachedSubchunk(world->chunkCache, decoded, subchunk);
+}
+
+/// @brief Loads a subchunk and stores it in the world's chunk cache
+/// @param world World the subchunk is located in
+/// @param position Position of the subchunk
+/// @returns Result
+/// @attention This function has to be called before you can use GetBlockAtWorldPosition or GetBlockAtSubchunkPosition
+Result LoadSubchunk(World* world, Subchunk** subchunk, int x, unsigned char y, int z, Dimension dimension) {
+    Subchunk* cached = FindCachedSubchunk(world->chunkCache, PackSubchunkKey(x, y, z, dimension));
+    if(cached != NULL) {
+        *subchunk = cached;
+        return SUCCESS;
+    }
+
+    // Skip the database lookup if the presence index knows that the subchunk does not exist
+    if(!IsSubchunkPresent(world, x, y, z, dimension)) {
+        return SUBCHUNK_NOT_FOUND;
+    }
+
+    // Generate the database key that corresponds to the requested subchunk
+    unsigned char key[SUBCHUNK_KEY_MAX_LENGTH];
+    unsigned int keyLen = GenerateSubchunkKey(x, y, z, dimension, key);
+
+    // Load the subchunk from the database using the generated key, the value is decoded in place
+    Entry entry;
+    Result result = AcquireEntry(world, key, keyLen, &entry);
+    if(BF_FAILED(result)) {
+        return result;
+    }
+
+    result = DecodeAndCacheSubchunk(world, entry.data, entry.length, x, y, z, dimension, subchunk);
+    ReleaseEntry(&entry);
+
+    return result;
+}
+
+/// @brief Loads every subchunk of a column the iterator can reach with a single seek
+/// @param world World the column is located in
+/// @param iterator Iterator to seek with
+/// @param loaded Counter that is incremented for every subchunk of the column that is in the cache afterwards
+/// @returns Result
+/// @attention All subchunk keys of a column share the x, z, dimension and tag prefix and only differ in their
+///            last byte, so they are stored next to each other
+/// @internal
+static Result LoadColumnWithIterator(
+        World* world, EntryIterator* iterator, int x, int z, Dimension dimension, unsigned int* loaded
+) {
+    unsigned char prefix[SUBCHUNK_KEY_MAX_LENGTH];
+    unsigned int prefixLen = GenerateSubchunkKey(x, 0, z, dimension, prefix) - 1;
+
+    Result firstError = SUCCESS;
+    int valid = SeekEntryIterator(iterator, prefix, prefixLen);
+    for(; valid; valid = NextEntryIterator(iterator)) {
+        if(iterator->keyLength != prefixLen + 1 || memcmp(iterator->key, prefix, prefixLen) != 0) {
+            break;
+        }
+
+        unsigned char y = iterator->key[prefixLen];
+        Subchunk* subchunk = FindCachedSubchunk(world->chunkCache, PackSubchunkKey(x, y, z, dimension));
+        if(subchunk == NULL) {
+            Result result = DecodeAndCacheSubchunk(
+                    world, iterator->data, iterator->length, x, y, z, dimension, &subchunk
+            );
+            if(result == ALLOCATION_FAILED) {
+                return result;
+            }
+            if(BF_FAILED(result)) {
+                // Keep going, a single corrupt subchunk should not stop a bulk load
+                if(!BF_FAILED(firstError)) firstError = result;
+                continue;
+            }
+        }
+
+        (*loaded)++;
+    }
+
+    return firstError;
+}
+
+/// @brief Loads every subchunk of a chunk column and stores them in the world's chunk cache
+/// @param world World the column is located in
+/// @param x X-coordinate of the column in chunks
+/// @param z Z-coordinate of the column in chunks
+/// @param dimension Dimension the column is located in
+/// @param loaded Pointer to an integer that will contain the amount of subchunks the column has
+/// @returns Result
+/// @attention The whole column is read with one database seek instead of one lookup per subchunk
+Result LoadChunkColumn(World* world, int x, int z, Dimension dimension, unsigned int* loaded) {
+    EntryIterator iterator;
+    Result result = OpenEntryIterator(world, &iterator);
+    if(BF_FAILED(result)) {
+        return result;
+    }
+
+    *loaded = 0;
+    result = LoadColumnWithIterator(world, &iterator, x, z, dimension, loaded);
+
+    Result closeResult = CloseEntryIterator(&iterator);
+    return BF_FAILED(result) ? result : closeResult;
+}
+
+/// @brief Column key prefix used to sort the columns of a region
+/// @internal
+typedef struct ColumnKey_T {
+    unsigned char bytes[8];
+    int x;
+    int z;
+} ColumnKey;
+
+/// @brief Orders columns the same way LevelDB orders their keys
+/// @internal
+static int CompareColumnKeys(const void* a, const void* b) {
+    return memcmp(((const ColumnKey*)a)->bytes, ((const ColumnKey*)b)->bytes, 8);
+}
+
+/// @brief Loads every subchunk in a rectangular region of chunk columns and stores them in the world's chunk cache
+/// @param world World the region is located in
+/// @param dimension Dimension the region is located in
+/// @param minX Smallest x-coordinate of the region in chunks
+/// @param minZ Smallest z-coordinate of the region in chunks
+/// @param maxX Largest x-coordinate of the region in chunks (inclusive)
+/// @param maxZ Largest z-coordinate of the region in chunks (inclusive)
+/// @param loaded Pointer to an integer that will contain the amount of subchunks in the region
+/// @returns Result
+/// @attention The columns are visited in key order with a single iterator, so the database only moves forward.
+///            Subchunks that fail to decode are skipped and the first error is returned after the whole region
+///            has been loaded. Make sure the chunk cache budget can hold the region.
+Result LoadRegion(World* world, Dimension dimension, int minX, int minZ, int maxX, int maxZ, unsigned int* loaded) {
+    *loaded = 0;
+    if(maxX < minX || maxZ < minZ) {
+        return SUCCESS;
+    }
+
+    size_t columnCount = ((size_t)maxX - minX + 1) * ((size_t)maxZ - minZ + 1);
+    ColumnKey* columns = malloc(columnCount * sizeof(ColumnKey));
+    if(columns == NULL) {
+        fprintf(stderr, "Failed to allocate %zu region columns\n", columnCount);
+        return ALLOCATION_FAILED;
+    }
+
+    size_t i = 0;
+    for(int x = minX; x <= maxX; x++) {
+        for(int z = minZ; z <= maxZ; z++, i++) {
+            ByteStream stream = { 0, 8, columns[i].bytes };
+            WriteInt(&stream, x);
+            WriteInt(&stream, z);
+            columns[i].x = x;
+            columns[i].z = z;
+        }
+    }
+    qsort(columns, columnCount, sizeof(ColumnKey), CompareColumnKeys);
+
+    EntryIterator iterator;
+    Result result = OpenEntryIterator(world, &iterator);
+    if(BF_FAILED(result)) {
+        free(columns);
+        return result;
+    }
+
+    Result firstError = SUCCESS;
+    for(i = 0; i < columnCount; i++) {
+        if(!IsColumnPresent(world, columns[i].x, columns[i].z, dimension)) continue;
+
+        result = LoadColumnWithIterator(world, &iterator, columns[i].x, columns[i].z, dimension, loaded);
+        if(result == ALLOCATION_FAILED) {
+            firstError = result;
+            break;
+        }
+        if(BF_FAILED(result) && !BF_FAILED(firstError)) firstError = result;
+    }
+
+    free(columns);
+
+    Result closeResult = CloseEntryIterator(&iterator);
+    return BF_FAILED(firstError) ? firstError : closeResult;
+}
+
 /// @brief Frees the subchunk and internal palette entries from memory and removes it from the chunk cache
 /// @param world The world that contains the subchunk
 /// @param subchunk Subchunk to be freed
 /// @attention Pass NULL as the pWorld parameter to free this chunk without removing it from the cache
 ///            (this feature is only really used internally, but it might be helpful)
+/// @attention The subchunk is freed even if it is pinned
 void FreeSubchunk(World* world, Subchunk* subchunk) {
     if(world != NULL) {
-        hashmap_remove(&world->chunkCache, (char*)subchunk->position, sizeof(Position));
+        RemoveCachedSubchunk(world->chunkCache, subchunk);
     }
 
-    for(unsigned short i = 0; i < subchunk->paletteSize; i++) {
-        FreeNbtTag(subchunk->palette[i]);
-    }
-    free(subchunk->position);
-    free(subchunk->palette);
+    DestroyArena(&subchunk->arena);
     free(subchunk);
 }
 
+/// @brief Calculates how much heap memory a decoded subchunk occupies, including its palette
+/// @param subchunk Subchunk to be measured
+/// @returns Size in bytes
+/// @attention Block states are shared through the block state registry and are not included
+size_t GetSubchunkMemorySize(Subchunk* subchunk) {
+    return sizeof(Subchunk) + GetArenaMemorySize(&subchunk->arena);
+}
+
 /// @brief Logs the subchunk information to the console
 /// @param subchunk Subchunk to be logged
 void PrintSubchunk(Subchunk* subchunk) {
     printf("Subchunk version: %i\n", subchunk->version);
-    printf("Palette block count: %i\n", subchunk->paletteSize);
-    for(unsigned short i = 0; i < subchunk->paletteSize; i++) {
-        PrintNbtTag(subchunk->palette[i]);
+    printf("Layer count: %i\n", subchunk->layerCount);
+    printf("Bits per block: %i\n", subchunk->storage.bitsPerBlock);
+    printf("Palette block count: %i\n", subchunk->storage.paletteSize);
+    for(unsigned short i = 0; i < subchunk->storage.paletteSize; i++) {
+        printf("Runtime ID %u:\n", subchunk->storage.palette[i]);
+        PrintNbtTag(GetBlockState(subchunk->storage.palette[i]));
     }
 }
 
+/// @brief Retrieves the runtime ID of a block in a subchunk
+/// @param subchunk Subchunk containing the desired block
+/// @param x X-coordinate of the block
+/// @param y Y-coordinate of the block
+/// @param z Z-coordinate of the block
+/// @returns Runtime ID of the block state, blocks with the same state always have the same runtime ID
+unsigned int GetBlockIdAtSubchunkPosition(Subchunk* subchunk, unsigned char x, unsigned char y, unsigned char z) {
+    return GetBlockStorageId(&subchunk->storage, 16 * 16 * x + 16 * z + y);
+}
+
+/// @brief Retrieves the runtime ID of a block in a world
+/// @param world World containing the block
+/// @param position Position of the block
+/// @returns Runtime ID of the block state, INVALID_BLOCK_STATE_ID if the subchunk could not be loaded
+/// @attention This function will automatically load the subchunk for you if it has not been loaded before.
+///            Otherwise it will be loaded from the chunk cache.
+unsigned int GetBlockIdAtWorldPosition(World* world, Position* position) {
+    int x = position->x >> 4;
+    unsigned char y = position->y >> 4;
+    int z = position->z >> 4;
+
+    // LoadSubchunk returns the cached subchunk when it has been loaded before
+    Subchunk* subchunk;
+    Result parseResult = LoadSubchunk(world, &subchunk, x, y, z, position->dimension);
+    if(BF_FAILED(parseResult)) {
+        return INVALID_BLOCK_STATE_ID;
+    }
+
+    return GetBlockIdAtSubchunkPosition(subchunk, position->x & 15, position->y & 15, position->z & 15);
+}
+
 /// @brief Retrieves a block from a subchunk
 /// @param subchunk Subchunk containing the desired block
 /// @param x X-coordinate of the block
 /// @param y Y-coordinate of the block
 /// @param z Z-coordinate of the block
 /// @returns Pointer to an NBT tag
-NbtTag* GetBlockAtSubchunkPosition(Subchunk* subchunk, unsigned char x, unsigned char y, unsigned char z) {
-    return subchunk->palette[subchunk->blocks[16 * 16 * x + 16 * z + y]];
+/// @attention The block state is shared with every other block of the same state and must not be modified
+const NbtTag* GetBlockAtSubchunkPosition(Subchunk* subchunk, unsigned char x, unsigned char y, unsigned char z) {
+    return GetBlockState(GetBlockIdAtSubchunkPosition(subchunk, x, y, z));
 }
 
 /// @brief Retrieves a block from a world
@@ -248,20 +705,371 @@ NbtTag* GetBlockAtSubchunkPosition(Subchunk* subchunk, unsigned char x, unsigned
 ///            Otherwise it will be loaded from the chunk cache.
 /// @attention This function is very similar to GetBlockAtSubchunkPosition,
 ///            but instead of loading a block from a subchunk it loads it from a world.
-NbtTag* GetBlockAtWorldPosition(World* world, Position* position) {
-    Subchunk* subchunk = hashmap_get(&world->chunkCache, (const char*)position, sizeof(Position));
-    if(subchunk == NULL) {
-        Result parseResult = LoadSubchunk(
-            world, &subchunk,
-            (int)floor((double)position->x / 16.0),
-            (unsigned char)floor((double)position->y / 16.0),
-            (int)floor((double)position->z / 16.0),
-            position->dimension
-        );
-        if(BF_FAILED(parseResult)) {
-            return NULL;
+const NbtTag* GetBlockAtWorldPosition(World* world, Position* position) {
+    unsigned int runtimeId = GetBlockIdAtWorldPosition(world, position);
+    if(runtimeId == INVALID_BLOCK_STATE_ID) {
+        return NULL;
+    }
+
+    return GetBlockState(runtimeId);
+}
+
+/// @brief Initializes the buffers used to encode subchunks
+/// @param encoder Encoder to be initialized, it is meant to be reused for many subchunks
+/// @attention The output buffer is allocated by the first call to EncodeSubchunk and grows when a larger subchunk
+///            comes along, so encoding does not allocate in the steady state
+void InitSubchunkEncoder(SubchunkEncoder* encoder) {
+    encoder->buffer = NULL;
+    encoder->capacity = 0;
+    encoder->length = 0;
+}
+
+/// @brief Frees the output buffer of an encoder
+/// @param encoder Encoder to be freed
+void DestroySubchunkEncoder(SubchunkEncoder* encoder) {
+    free(encoder->buffer);
+    encoder->buffer = NULL;
+    encoder->capacity = 0;
+    encoder->length = 0;
+}
+
+/// @brief Encodes a subchunk into the value of its database entry
+/// @param encoder Encoder to encode the subchunk with, the value is stored in its buffer
+/// @param subchunk Subchunk to be encoded
+/// @returns Result
+/// @attention The first layer is written with a compacted palette, entries no block uses are dropped and the
+///            smallest width that fits the remaining ones is picked. The layers after it cannot be edited and are
+///            written the way they were read. Subchunks are always written as version 8 or 9.
+Result EncodeSubchunk(SubchunkEncoder* encoder, const Subchunk* subchunk) {
+    const BlockStorage* storage = &subchunk->storage;
+
+    ExpandBlockStorage(storage, encoder->blocks);
+    memcpy(encoder->palette, storage->palette, storage->paletteSize * sizeof(unsigned int));
+    unsigned int paletteSize = CompactBlockIndices(encoder->blocks, encoder->palette, storage->paletteSize);
+    unsigned char bitsPerBlock = GetMinimalBitsPerBlock(paletteSize);
+
+    // The exact size is known up front, so the value is written without any bounds checks
+    // Storages with a single palette entry are written without words and without a palette size
+    size_t wordBytes = GetBlockStorageWordCount(bitsPerBlock) * 4;
+    size_t size = 3 + 1 + wordBytes + (bitsPerBlock != 0 ? 4 : 0) + subchunk->layerDataLength;
+    for(unsigned int i = 0; i < paletteSize; i++) {
+        const unsigned char* state;
+        unsigned int stateLength;
+        Result result = GetSerializedBlockState(encoder->palette[i], &state, &stateLength);
+        if(BF_FAILED(result)) {
+            fprintf(stderr, "Subchunk references unknown block state %u\n", encoder->palette[i]);
+            return result;
+        }
+        size += 3 + stateLength;
+    }
+
+    if(size > encoder->capacity) {
+        size_t capacity = encoder->capacity != 0 ? encoder->capacity : 4096;
+        while(capacity < size) capacity *= 2;
+
+        unsigned char* buffer = realloc(encoder->buffer, capacity);
+        if(buffer == NULL) {
+            fprintf(stderr, "Failed to allocate %zu bytes to encode a subchunk\n", capacity);
+            return ALLOCATION_FAILED;
+        }
+        encoder->buffer = buffer;
+        encoder->capacity = capacity;
+    }
+
+    ByteStream stream = { 0, (unsigned int)encoder->capacity, encoder->buffer };
+    WriteByte(&stream, subchunk->version == 9 ? 9 : 8);
+    WriteByte(&stream, subchunk->layerCount);
+    if(subchunk->version == 9) WriteByte(&stream, subchunk->position.y);
+
+    WriteByte(&stream, (unsigned char)(bitsPerBlock << 1));
+    PackBlockIndices(encoder->blocks, bitsPerBlock, stream.buffer + stream.position);
+    stream.position += (unsigned int)wordBytes;
+
+    if(bitsPerBlock != 0) WriteInt(&stream, (int)paletteSize);
+    for(unsigned int i = 0; i < paletteSize; i++) {
+        const unsigned char* state;
+        unsigned int stateLength;
+        GetSerializedBlockState(encoder->palette[i], &state, &stateLength);
+
+        // Palette entries are unnamed compound tags
+        WriteByte(&stream, NBT_COMPOUND);
+        WriteShort(&stream, 0);
+        memcpy(stream.buffer + stream.position, state, stateLength);
+        stream.position += stateLength;
+    }
+
+    if(subchunk->layerDataLength != 0) {
+        memcpy(stream.buffer + stream.position, subchunk->layerData, subchunk->layerDataLength);
+        stream.position += subchunk->layerDataLength;
+    }
+
+    encoder->length = stream.position;
+    return SUCCESS;
+}
+
+/// @brief Writes a subchunk back to the database and marks it as clean
+/// @param world World the subchunk is located in
+/// @param subchunk Subchunk to be written
+/// @param encoder Encoder to encode the subchunk with
+/// @returns Result
+Result SaveSubchunk(World* world, Subchunk* subchunk, SubchunkEncoder* encoder) {
+    Result result = EncodeSubchunk(encoder, subchunk);
+    if(BF_FAILED(result)) {
+        return result;
+    }
+
+    unsigned char key[SUBCHUNK_KEY_MAX_LENGTH];
+    unsigned int keyLen = GenerateSubchunkKey(
+            subchunk->position.x, subchunk->position.y, subchunk->position.z, subchunk->position.dimension, key
+    );
+
+    result = StoreEntry(world, key, keyLen, encoder->buffer, (unsigned int)encoder->length);
+    if(BF_FAILED(result)) {
+        return result;
+    }
+
+    subchunk->dirty = 0;
+    return SUCCESS;
+}
+
+/// @brief Repacks the first layer of a subchunk at a width that can index the given amount of palette entries
+/// @internal
+static Result WidenBlockStorage(Subchunk* subchunk, unsigned int paletteSize) {
+    BlockStorage* storage = &subchunk->storage;
+    unsigned char bitsPerBlock = GetMinimalBitsPerBlock(paletteSize);
+
+    unsigned char* words = AllocateFromArena(&subchunk->arena, GetBlockStorageWordCount(bitsPerBlock) * 4);
+    if(words == NULL) {
+        fprintf(stderr, "Failed to allocate block storage with %i bits per block\n", bitsPerBlock);
+        return ALLOCATION_FAILED;
+    }
+
+    unsigned short blocks[SUBCHUNK_BLOCK_COUNT];
+    ExpandBlockStorage(storage, blocks);
+    PackBlockIndices(blocks, bitsPerBlock, words);
+
+    // The old words stay in the arena, widening happens at most once per width
+    storage->words = words;
+    storage->bitsPerBlock = bitsPerBlock;
+    storage->blocksPerWord = (unsigned char)(32 / bitsPerBlock);
+    return SUCCESS;
+}
+
+/// @brief Drops the palette entries of the first layer no block uses anymore
+/// @internal
+static void CompactBlockStorage(BlockStorage* storage) {
+    unsigned short blocks[SUBCHUNK_BLOCK_COUNT];
+    ExpandBlockStorage(storage, blocks);
+
+    storage->paletteSize = (unsigned short)CompactBlockIndices(blocks, storage->palette, storage->paletteSize);
+    PackBlockIndices(blocks, storage->bitsPerBlock, storage->words);
+}
+
+/// @brief Finds the palette index of a runtime ID in the first layer of a subchunk, adding it if it is missing
+/// @param world World whose chunk cache has to account for the memory the palette grows by
+/// @internal
+static Result GetOrAddPaletteIndex(World* world, Subchunk* subchunk, unsigned int runtimeId, unsigned short* index) {
+    BlockStorage* storage = &subchunk->storage;
+    for(unsigned int i = 0; i < storage->paletteSize; i++) {
+        if(storage->palette[i] == runtimeId) {
+            *index = (unsigned short)i;
+            return SUCCESS;
+        }
+    }
+
+    if(storage->paletteSize == SUBCHUNK_BLOCK_COUNT) {
+        // Edits never remove entries, so a full palette usually contains states that are no longer used
+        CompactBlockStorage(storage);
+        if(storage->paletteSize == SUBCHUNK_BLOCK_COUNT) {
+            fprintf(stderr, "Block storage already uses %i different block states\n", SUBCHUNK_BLOCK_COUNT);
+            return INVALID_ARGUMENT;
+        }
+    }
+
+    int grew = 0;
+    if(storage->paletteSize == storage->paletteCapacity) {
+        unsigned int capacity = storage->paletteCapacity < 4 ? 4 : storage->paletteCapacity * 2u;
+        if(capacity > SUBCHUNK_BLOCK_COUNT) capacity = SUBCHUNK_BLOCK_COUNT;
+
+        unsigned int* palette = AllocateFromArena(&subchunk->arena, capacity * sizeof(unsigned int));
+        if(palette == NULL) {
+            fprintf(stderr, "Failed to allocate palette with %u block states\n", capacity);
+            return ALLOCATION_FAILED;
+        }
+
+        memcpy(palette, storage->palette, storage->paletteSize * sizeof(unsigned int));
+        storage->palette = palette;
+        storage->paletteCapacity = (unsigned short)capacity;
+        grew = 1;
+    }
+
+    unsigned int paletteSize = storage->paletteSize + 1u;
+    if(storage->bitsPerBlock == 0 || paletteSize > 1u << storage->bitsPerBlock) {
+        Result result = WidenBlockStorage(subchunk, paletteSize);
+        if(BF_FAILED(result)) {
+            return result;
         }
+        grew = 1;
     }
 
-    return subchunk->palette[subchunk->blocks[16 * 16 * position->x + 16 * position->z + position->y]];
-}
\ No newline at end of file
+    storage->palette[storage->paletteSize] = runtimeId;
+    *index = storage->paletteSize++;
+
+    if(grew) UpdateCachedSubchunkSize(world->chunkCache, subchunk);
+    return SUCCESS;
+}
+
+/// @brief Changes the state of a block in a subchunk
+/// @param world World containing the subchunk
+/// @param subchunk Subchunk containing the block
+/// @param x X-coordinate of the block
+/// @param y Y-coordinate of the block
+/// @param z Z-coordinate of the block
+/// @param runtimeId Runtime ID of the new block state
+/// @returns Result
+/// @attention The subchunk is marked as dirty when the block changes. Dirty subchunks stay in the chunk cache until
+///            they are written back using SaveSubchunk. Only the first block storage layer can be edited.
+Result SetBlockIdAtSubchunkPosition(
+        World* world, Subchunk* subchunk, unsigned char x, unsigned char y, unsigned char z, unsigned int runtimeId
+) {
+    return FillSubchunkBlockRun(world, subchunk, 16 * 16 * x + 16 * z + y, 1, runtimeId);
+}
+
+/// @brief Changes the state of a block in a world
+/// @param world World containing the block
+/// @param position Position of the block
+/// @param runtimeId Runtime ID of the new block state
+/// @returns Result, SUBCHUNK_NOT_FOUND if the subchunk containing the block does not exist
+/// @attention This function will automatically load the subchunk for you if it has not been loaded before
+Result SetBlockIdAtWorldPosition(World* world, Position* position, unsigned int runtimeId) {
+    Subchunk* subchunk;
+    Result result = LoadSubchunk(
+            world, &subchunk, position->x >> 4, position->y >> 4, position->z >> 4, position->dimension
+    );
+    if(BF_FAILED(result)) {
+        return result;
+    }
+
+    return SetBlockIdAtSubchunkPosition(world, subchunk, position->x & 15, position->y & 15, position->z & 15, runtimeId);
+}
+
+/// @brief Changes the state of a block in a world
+/// @param world World containing the block
+/// @param position Position of the block
+/// @param state New block state, it has to be in the block state registry already
+/// @returns Result, INVALID_ARGUMENT if the state has never been seen
+/// @attention States that have not been read from any subchunk yet can be registered using InternBlockState
+Result SetBlockAtWorldPosition(World* world, Position* position, const NbtTag* state) {
+    unsigned int runtimeId = FindBlockStateId(state);
+    if(runtimeId == INVALID_BLOCK_STATE_ID) {
+        fprintf(stderr, "Block state is not in the block state registry\n");
+        return INVALID_ARGUMENT;
+    }
+
+    return SetBlockIdAtWorldPosition(world, position, runtimeId);
+}
+
+/// @brief Changes the state of a run of blocks that follow each other in storage order
+/// @param world World containing the subchunk
+/// @param subchunk Subchunk containing the blocks
+/// @param start Index of the first block in XZY order
+/// @param length Amount of blocks, start + length must not exceed 4096
+/// @param ids Runtime IDs of the new block states, one per block
+/// @returns Result
+/// @attention The palette is searched once per change of state along the run instead of once per block
+Result SetSubchunkBlockRun(
+        World* world, Subchunk* subchunk, unsigned int start, unsigned int length, const unsigned int* ids
+) {
+    if(start + length > SUBCHUNK_BLOCK_COUNT) {
+        return INVALID_ARGUMENT;
+    }
+
+    for(unsigned int i = 0; i < length;) {
+        unsigned int end = i + 1;
+        while(end < length && ids[end] == ids[i]) end++;
+
+        Result result = FillSubchunkBlockRun(world, subchunk, start + i, end - i, ids[i]);
+        if(BF_FAILED(result)) {
+            return result;
+        }
+        i = end;
+    }
+
+    return SUCCESS;
+}
+
+/// @brief Changes a run of blocks that follow each other in storage order to the same state
+/// @param world World containing the subchunk
+/// @param subchunk Subchunk containing the blocks
+/// @param start Index of the first block in XZY order
+/// @param length Amount of blocks, start + length must not exceed 4096
+/// @param runtimeId Runtime ID of the new block state
+/// @returns Result
+/// @attention Filling the whole subchunk resets its palette. Otherwise every word that is covered completely by the
+///            run is written at once.
+Result FillSubchunkBlockRun(
+        World* world, Subchunk* subchunk, unsigned int start, unsigned int length, unsigned int runtimeId
+) {
+    if(start + length > SUBCHUNK_BLOCK_COUNT) {
+        return INVALID_ARGUMENT;
+    }
+    if(length == 0) {
+        return SUCCESS;
+    }
+
+    BlockStorage* storage = &subchunk->storage;
+    if(length == SUBCHUNK_BLOCK_COUNT) {
+        if(storage->paletteSize == 1 && storage->palette[0] == runtimeId) {
+            return SUCCESS;
+        }
+
+        // The width is kept, so the next edit does not have to widen the storage again
+        storage->palette[0] = runtimeId;
+        storage->paletteSize = 1;
+        if(storage->bitsPerBlock != 0) memset(storage->words, 0, GetBlockStorageWordCount(storage->bitsPerBlock) * 4);
+
+        subchunk->dirty = 1;
+        return SUCCESS;
+    }
+
+    unsigned short index;
+    Result result = GetOrAddPaletteIndex(world, subchunk, runtimeId, &index);
+    if(BF_FAILED(result)) {
+        return result;
+    }
+    if(storage->bitsPerBlock == 0) {
+        // The storage is still uniform, so every block already has this state
+        return SUCCESS;
+    }
+
+    unsigned int end = start + length;
+    unsigned int i = start;
+    for(; i < end && i % storage->blocksPerWord != 0; i++) {
+        if(GetBlockStorageIndex(storage, i) == index) continue;
+        SetBlockStorageIndex(storage, i, index);
+        subchunk->dirty = 1;
+    }
+
+    if(end - i >= storage->blocksPerWord) {
+        unsigned int pattern = 0;
+        for(unsigned int j = 0; j < storage->blocksPerWord; j++) {
+            pattern |= (unsigned int)index << (j * storage->bitsPerBlock);
+        }
+
+        // Blocks never span two words, so whole words can be overwritten without touching other blocks
+        for(; end - i >= storage->blocksPerWord; i += storage->blocksPerWord) {
+            unsigned char* word = storage->words + i / storage->blocksPerWord * 4;
+            if(LoadBlockStorageWord(word) == pattern) continue;
+            StoreBlockStorageWord(word, pattern);
+            subchunk->dirty = 1;
+        }
+    }
+
+    for(; i < end; i++) {
+        if(GetBlockStorageIndex(storage, i) == index) continue;
+        SetBlockStorageIndex(storage, i, index);
+        subchunk->dirty = 1;
+    }
+
+    return SUCCESS;
+}
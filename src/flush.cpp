@@ -0,0 +1,165 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "BedrockFormat/format.h"
+
+extern "C" {
+    #include "BedrockFormat/chunk.h"
+    #include "BedrockFormat/cache.h"
+    #include "BedrockFormat/flush.h"
+    #include "BedrockFormat/presence.h"
+};
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+#include <leveldb/db.h>
+#include <leveldb/options.h>
+#include <leveldb/write_batch.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+namespace {
+    /// @brief Dirty subchunk together with the key it is written to
+    /// @internal
+    struct FlushJob {
+        unsigned char key[SUBCHUNK_KEY_MAX_LENGTH];
+        unsigned int keyLength;
+        Subchunk* subchunk;
+    };
+
+    /// @brief Orders jobs the same way LevelDB orders their keys
+    /// @internal
+    bool CompareFlushKeys(const FlushJob& a, const FlushJob& b) {
+        unsigned int length = std::min(a.keyLength, b.keyLength);
+        int result = memcmp(a.key, b.key, length);
+        return result != 0 ? result < 0 : a.keyLength < b.keyLength;
+    }
+}
+
+/// @brief Populates the flush options with the default values
+/// @param options Options to be populated
+void InitFlushOptions(FlushOptions* options) {
+    options->batchSize = DEFAULT_FLUSH_BATCH_SIZE;
+    options->sync = 0;
+}
+
+/// @brief Writes every dirty subchunk of the chunk cache back to the database
+/// @param world World containing the subchunks
+/// @param options Options controlling the write batches, NULL uses the default values
+/// @param stats Struct that will be populated with the amount of written data, can be NULL
+/// @returns Result
+/// @attention The subchunks are encoded in key order and grouped into write batches of about batchSize bytes, so
+///            LevelDB appends to its log and memtable once per batch instead of once per subchunk. A subchunk is only
+///            marked as clean once the batch containing it has been written. If a batch fails, the subchunks of that
+///            batch and of every later batch stay dirty and the error is returned.
+///            Worlds opened with OpenWorldReadOnly cannot be flushed, INVALID_ARGUMENT is returned.
+Result FlushWorld(World* world, const FlushOptions* options, FlushStats* stats) {
+    if(world->readOnly) {
+        std::cerr << "Cannot flush a world opened with OpenWorldReadOnly" << std::endl;
+        return INVALID_ARGUMENT;
+    }
+
+    FlushOptions defaultOptions;
+    if(options == nullptr) {
+        InitFlushOptions(&defaultOptions);
+        options = &defaultOptions;
+    }
+
+    FlushStats flushed = {};
+    if(stats != nullptr) *stats = flushed;
+
+    ChunkCache* cache = world->chunkCache;
+    std::vector<FlushJob> jobs;
+    ChunkCacheEntry* entry = cache->hand;
+    for(unsigned int i = 0; i < cache->entryCount; i++, entry = entry->next) {
+        Subchunk* subchunk = entry->subchunk;
+        if(!subchunk->dirty) continue;
+
+        FlushJob job;
+        job.keyLength = GenerateSubchunkKey(
+                subchunk->position.x, subchunk->position.y, subchunk->position.z, subchunk->position.dimension, job.key
+        );
+        job.subchunk = subchunk;
+        jobs.push_back(job);
+    }
+
+    if(jobs.empty()) {
+        return SUCCESS;
+    }
+    std::sort(jobs.begin(), jobs.end(), CompareFlushKeys);
+
+    auto encoder = std::make_unique<SubchunkEncoder>();
+    InitSubchunkEncoder(encoder.get());
+
+    leveldb::WriteOptions writeOptions;
+    writeOptions.sync = options->sync != 0;
+
+    leveldb::WriteBatch batch;
+    size_t batchBytes = 0;
+    size_t batchStart = 0;
+    Result result = SUCCESS;
+    for(size_t i = 0; i < jobs.size(); i++) {
+        result = EncodeSubchunk(encoder.get(), jobs[i].subchunk);
+        if(BF_FAILED(result)) {
+            break;
+        }
+
+        // The batch copies the key and value, so the encoder can be reused right away
+        batch.Put(
+                leveldb::Slice(reinterpret_cast<const char*>(jobs[i].key), jobs[i].keyLength),
+                leveldb::Slice(reinterpret_cast<const char*>(encoder->buffer), encoder->length)
+        );
+        batchBytes += jobs[i].keyLength + encoder->length;
+
+        if(batchBytes < options->batchSize && i + 1 < jobs.size()) {
+            continue;
+        }
+
+        leveldb::Status status = ((leveldb::DB*)world->db)->Write(writeOptions, &batch);
+        if(!status.ok()) {
+            std::cerr << "Failed to write subchunks with error: " << status.ToString() << std::endl;
+            result = DATABASE_WRITE_ERROR;
+            break;
+        }
+
+        for(size_t j = batchStart; j <= i; j++) {
+            const Position& position = jobs[j].subchunk->position;
+            jobs[j].subchunk->dirty = 0;
+            MarkSubchunkPresent(world, position.x, position.y, position.z, position.dimension);
+        }
+
+        flushed.subchunkCount += (unsigned int)(i + 1 - batchStart);
+        flushed.batchCount++;
+        flushed.bytesWritten += batchBytes;
+
+        batch.Clear();
+        batchBytes = 0;
+        batchStart = i + 1;
+    }
+
+    DestroySubchunkEncoder(encoder.get());
+    if(stats != nullptr) *stats = flushed;
+
+    // Clean subchunks can be evicted again, the cache might have grown past its budget while they were dirty
+    EvictChunkCache(cache, cache->budget);
+    return result;
+}
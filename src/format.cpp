@@ -14,9 +14,23 @@
 
 extern "C" {
     #include "BedrockFormat/chunk.h"
+    #include "BedrockFormat/cache.h"
+    #include "BedrockFormat/async.h"
+    #include "BedrockFormat/pipeline.h"
+    #include "BedrockFormat/presence.h"
 };
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -33,59 +47,374 @@ extern "C" {
 #pragma warning(pop)
 #endif
 
-static leveldb::ReadOptions readOptions;
-static leveldb::Options options;
+namespace {
+    /// @brief LevelDB configuration owned by a single world
+    /// @internal
+    /// @attention The filter policy, block cache, compressors and decompress allocator are created per world,
+    ///            so closing one world never frees objects another world still uses
+    struct WorldSettings {
+        leveldb::Options options;
+        leveldb::ReadOptions readOptions; // Point queries
+        leveldb::ReadOptions scanOptions; // Iterators and bulk loads, they must not push the hot set out of the block cache
+        std::filesystem::path mirror; // Private copy of the database a read-only world is opened from
+
+        explicit WorldSettings(const WorldOptions& worldOptions) {
+            if(worldOptions.bloomFilterBits > 0) {
+                options.filter_policy = leveldb::NewBloomFilterPolicy(worldOptions.bloomFilterBits);
+            }
+            if(worldOptions.blockCacheSize != 0) {
+                options.block_cache = leveldb::NewLRUCache(worldOptions.blockCacheSize);
+            }
+            options.write_buffer_size = worldOptions.writeBufferSize;
+            options.max_open_files = worldOptions.maxOpenFiles;
+            options.paranoid_checks = worldOptions.paranoidChecks != 0;
+            options.compressors[0] = new leveldb::ZlibCompressorRaw(-1);
+            options.compressors[1] = new leveldb::ZlibCompressor();
+
+            readOptions.verify_checksums = worldOptions.paranoidChecks != 0;
+            readOptions.decompress_allocator = new leveldb::DecompressAllocator();
+
+            scanOptions.verify_checksums = worldOptions.paranoidChecks != 0 || worldOptions.verifyScanChecksums != 0;
+            scanOptions.fill_cache = false;
+            scanOptions.decompress_allocator = readOptions.decompress_allocator;
+        }
+
+        ~WorldSettings() {
+            delete options.filter_policy;
+            delete options.block_cache;
+            delete options.compressors[0];
+            delete options.compressors[1];
+            delete readOptions.decompress_allocator;
+        }
+
+        WorldSettings(const WorldSettings&) = delete;
+        WorldSettings& operator=(const WorldSettings&) = delete;
+    };
+
+    /// @internal
+    WorldSettings* GetWorldSettings(World* world) {
+        return static_cast<WorldSettings*>(world->settings);
+    }
+
+    /// @brief Frees a world that has been opened partially or completely
+    /// @internal
+    void FreeWorld(World* world) {
+        StopAsyncLoader(world);
+        StopPipelineWorkers(world);
+        DestroyPresenceIndex(world->presenceIndex);
+        if(world->chunkCache != nullptr) DestroyChunkCache(world->chunkCache);
+
+        // The database uses the cache and filter policy of the settings, so it has to go first
+        delete (leveldb::DB*)world->db;
+
+        WorldSettings* settings = GetWorldSettings(world);
+        if(settings != nullptr && !settings->mirror.empty()) {
+            std::error_code error;
+            std::filesystem::remove_all(settings->mirror, error);
+        }
+
+        delete settings;
+        delete world;
+    }
+
+    /// @brief Number of times a read-only world tries to mirror a database that keeps changing
+    /// @internal
+    constexpr int MIRROR_ATTEMPTS = 4;
+
+    /// @brief Reads the CURRENT file of a database, which names its live manifest
+    /// @internal
+    bool ReadCurrentFile(const std::filesystem::path& directory, std::string* current) {
+        std::ifstream file(directory / "CURRENT", std::ios::binary);
+        if(!file) {
+            return false;
+        }
+
+        current->assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return !file.bad() && current->size() > 1 && current->back() == '\n';
+    }
+
+    /// @brief Lists the names of the table and log files of a database, sorted
+    /// @internal
+    void ListDatabaseFiles(const std::filesystem::path& directory, std::vector<std::string>* names,
+                           std::error_code& error) {
+        names->clear();
+        std::filesystem::directory_iterator end;
+        std::filesystem::directory_iterator file(directory, error);
+        for(; !error && file != end; file.increment(error)) {
+            std::string extension = file->path().extension().string();
+            if(extension == ".ldb" || extension == ".sst" || extension == ".log") {
+                names->push_back(file->path().filename().string());
+            }
+        }
+        std::sort(names->begin(), names->end());
+    }
+
+    /// @brief Removes the mirrors of a database left behind by processes that did not close their worlds
+    /// @internal
+    /// @attention A mirror is stale when nobody holds the LevelDB lock of it. Mirrors are locked from the moment
+    ///            they are created, so ones that are still being copied are never taken for stale.
+    void RemoveStaleMirrors(const std::filesystem::path& directory) {
+        std::string prefix = directory.filename().string() + "-mirror-";
+        leveldb::Env* env = leveldb::Env::Default();
+
+        std::error_code error;
+        std::filesystem::directory_iterator end;
+        std::filesystem::directory_iterator entry(directory.parent_path(), error);
+        for(; !error && entry != end; entry.increment(error)) {
+            std::string name = entry->path().filename().string();
+            if(name.compare(0, prefix.size(), prefix) != 0) continue;
+
+            std::error_code entryError;
+            std::filesystem::path lockPath = entry->path() / "LOCK";
+            if(!std::filesystem::is_regular_file(lockPath, entryError)) continue;
+
+            leveldb::FileLock* lock;
+            if(!env->LockFile(lockPath.string(), &lock).ok()) continue;
+            env->UnlockFile(lock);
+            std::filesystem::remove_all(entry->path(), entryError);
+        }
+    }
+
+    /// @brief Copies one consistent state of a database into an empty mirror
+    /// @internal
+    /// @attention The manifest named by CURRENT is copied first. Every table and log it can refer to existed
+    ///            before, so they are linked or copied afterwards from a listing taken before the manifest.
+    ///            If CURRENT or the listing changed meanwhile, or a file went missing because LevelDB compacted,
+    ///            changed is set and the mirror has to be cleared and copied again.
+    Result CopyDatabase(const std::filesystem::path& directory, const std::filesystem::path& mirror,
+                        bool* changed, std::error_code& error) {
+        *changed = false;
+
+        std::string current;
+        if(!ReadCurrentFile(directory, &current)) {
+            std::cerr << "Failed to read " << (directory / "CURRENT").string() << std::endl;
+            return DATABASE_OPEN_ERROR;
+        }
+
+        std::vector<std::string> files;
+        ListDatabaseFiles(directory, &files, error);
+        if(error) {
+            return DATABASE_OPEN_ERROR;
+        }
+
+        std::string manifest = current.substr(0, current.size() - 1);
+        std::filesystem::copy_file(directory / manifest, mirror / manifest, error);
+
+        for(size_t i = 0; !error && i < files.size(); i++) {
+            std::filesystem::path source = directory / files[i];
+            std::filesystem::path target = mirror / files[i];
+            if(source.extension() != ".log") {
+                // Tables never change once they are written
+                std::filesystem::create_hard_link(source, target, error);
+                if(!error) continue;
+                error.clear();
+            }
+            std::filesystem::copy_file(source, target, error);
+        }
+
+        if(error) {
+            *changed = error == std::errc::no_such_file_or_directory;
+            return DATABASE_OPEN_ERROR;
+        }
+
+        std::ofstream currentFile(mirror / "CURRENT", std::ios::binary);
+        if(!(currentFile << current).flush()) {
+            std::cerr << "Failed to write " << (mirror / "CURRENT").string() << std::endl;
+            return DATABASE_OPEN_ERROR;
+        }
+
+        std::string currentAfter;
+        std::vector<std::string> filesAfter;
+        ListDatabaseFiles(directory, &filesAfter, error);
+        if(error) {
+            return DATABASE_OPEN_ERROR;
+        }
+        *changed = !ReadCurrentFile(directory, &currentAfter) || currentAfter != current || filesAfter != files;
+        return *changed ? DATABASE_OPEN_ERROR : SUCCESS;
+    }
+
+    /// @brief Mirrors a database directory into a new directory next to it
+    /// @internal
+    /// @attention Table files are hard linked when the file system allows it and copied otherwise, the manifest
+    ///            and logs are always copied. The lock and info log are left out, so the mirror can be opened while
+    ///            another process holds the lock of the original. The copy is retried when the original changed
+    ///            while it was taken. The mirror is created next to the source so both are on the same file
+    ///            system, which hard links need, and mirrors of earlier processes that crashed are removed first.
+    ///            Only the std::error_code overloads of std::filesystem are used, nothing may throw through the
+    ///            C interface.
+    Result MirrorDatabase(const std::filesystem::path& source, std::filesystem::path* mirror) {
+        static std::atomic<unsigned int> mirrorCount{0};
+
+        std::error_code error;
+        std::filesystem::path directory = std::filesystem::absolute(source, error);
+        if(error) {
+            std::cerr << "Failed to resolve " << source.string() << ": " << error.message() << std::endl;
+            return DATABASE_OPEN_ERROR;
+        }
+        if(!directory.has_filename()) directory = directory.parent_path();
+
+        RemoveStaleMirrors(directory);
+
+        leveldb::Env* env = leveldb::Env::Default();
+        for(int attempt = 0; attempt < MIRROR_ATTEMPTS; attempt++) {
+            *mirror = directory.parent_path() / (directory.filename().string() + "-mirror-"
+                    + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count())
+                    + "-" + std::to_string(mirrorCount.fetch_add(1)));
+            if(!std::filesystem::create_directory(*mirror, error)) {
+                std::cerr << "Failed to create " << mirror->string() << ": " << error.message() << std::endl;
+                mirror->clear();
+                return DATABASE_OPEN_ERROR;
+            }
+
+            // Held until LevelDB takes the lock over, so other processes do not remove the mirror as stale
+            leveldb::FileLock* lock;
+            if(!env->LockFile((*mirror / "LOCK").string(), &lock).ok()) {
+                std::cerr << "Failed to lock " << mirror->string() << std::endl;
+                std::filesystem::remove_all(*mirror, error);
+                mirror->clear();
+                return DATABASE_OPEN_ERROR;
+            }
+
+            bool changed;
+            Result result = CopyDatabase(directory, *mirror, &changed, error);
+            env->UnlockFile(lock);
+            if(result == SUCCESS) {
+                return SUCCESS;
+            }
+
+            if(error) {
+                std::cerr << "Failed to mirror " << source.string() << ": " << error.message() << std::endl;
+            }
+            std::filesystem::remove_all(*mirror, error);
+            mirror->clear();
+            if(!changed) {
+                return DATABASE_OPEN_ERROR;
+            }
+        }
+
+        std::cerr << "Failed to mirror " << source.string() << ": it kept changing" << std::endl;
+        return DATABASE_OPEN_ERROR;
+    }
+
+    /// @brief Opens the database of a world that has been allocated already
+    /// @internal
+    Result OpenDatabase(World* world, const char* path, const WorldOptions& options, bool readOnly) {
+        world->chunkCache = CreateChunkCache(options.chunkCacheBudget);
+        if(world->chunkCache == nullptr) {
+            return ALLOCATION_FAILED;
+        }
+
+        auto settings = new WorldSettings(options);
+        world->settings = settings;
+        world->leveldbCache = settings->options.block_cache;
+        world->readOnly = readOnly;
+
+        std::string databasePath = path;
+        leveldb::Status status;
+        for(int attempt = 0; attempt < MIRROR_ATTEMPTS; attempt++) {
+            if(readOnly) {
+                Result result = MirrorDatabase(path, &settings->mirror);
+                if(BF_FAILED(result)) {
+                    return result;
+                }
+                databasePath = settings->mirror.string();
+            }
+
+            // Open database
+            status = leveldb::DB::Open(settings->options, databasePath, (leveldb::DB**)&world->db);
+
+            // Another process can take a mirror for stale in the moment it is unlocked, it is mirrored again then
+            std::error_code error;
+            if(status.ok() || !readOnly || std::filesystem::exists(settings->mirror, error)) break;
+        }
+        if(!status.ok()) {
+            std::cerr << "Failed to open database with error: " << status.ToString() << std::endl;
+            world->db = nullptr;
+            return DATABASE_OPEN_ERROR;
+        }
+
+        if(options.buildPresenceIndex) {
+            return BuildPresenceIndex(world);
+        }
+        return SUCCESS;
+    }
+}
+
+/// @brief Populates the world options with the default values
+/// @param options Options to be populated
+void InitWorldOptions(WorldOptions* options) {
+    options->blockCacheSize = DEFAULT_BLOCK_CACHE_SIZE;
+    options->bloomFilterBits = DEFAULT_BLOOM_FILTER_BITS;
+    options->writeBufferSize = DEFAULT_WRITE_BUFFER_SIZE;
+    options->maxOpenFiles = DEFAULT_MAX_OPEN_FILES;
+    options->paranoidChecks = 0;
+    options->verifyScanChecksums = 0;
+    options->buildPresenceIndex = 0;
+    options->chunkCacheBudget = DEFAULT_CHUNK_CACHE_BUDGET;
+}
 
 /// @brief Opens a new world
 /// @param path Path to the world
+/// @param options Options used for this world only, NULL uses the default values
 /// @param world Double pointer to a world struct that will be populated with data
 /// @returns Result
-Result OpenWorld(const char* path, World** world) {
-    *world = new World();
-    World* pWorld = *world;
-
-    if(hashmap_create(1, &pWorld->chunkCache) != 0) {
-        std::cerr << "Failed to create chunk cache hashmap" << std::endl;
-        return ALLOCATION_FAILED;
+/// @attention Every world owns its LevelDB caches, so any number of worlds can be open at the same time
+Result OpenWorld(const char* path, const WorldOptions* options, World** world) {
+    WorldOptions defaultOptions;
+    if(options == nullptr) {
+        InitWorldOptions(&defaultOptions);
+        options = &defaultOptions;
     }
 
-    // Configuration
-    if(options.filter_policy == nullptr) {
-        options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-        options.block_cache = leveldb::NewLRUCache(40 * 1024 * 1024);
-        options.write_buffer_size = 4 * 1024 * 1024;
-        options.compressors[0] = new leveldb::ZlibCompressorRaw(-1);
-        options.compressors[1] = new leveldb::ZlibCompressor();
-    }
-    if(readOptions.decompress_allocator == nullptr) {
-        readOptions.decompress_allocator = new leveldb::DecompressAllocator();
+    World* pWorld = new World();
+    Result result = OpenDatabase(pWorld, path, *options, false);
+    if(BF_FAILED(result)) {
+        FreeWorld(pWorld);
+        return result;
     }
 
-    pWorld->leveldbCache = options.block_cache;
+    *world = pWorld;
+    return SUCCESS;
+}
 
-    // Open database
-    leveldb::Status status = leveldb::DB::Open(options, path, (leveldb::DB**)&pWorld->db);
-    if(!status.ok()) {
-        std::cerr << "Failed to open database with error: " << status.ToString() << std::endl;
-        return DATABASE_OPEN_ERROR;
+/// @brief Opens a world for reading only, without ever writing to its directory
+/// @param path Path to the world, it can be in use by another process
+/// @param options Options used for this world only, NULL uses the default values
+/// @param world Double pointer to a world struct that will be populated with data
+/// @returns Result
+/// @attention LevelDB always locks the directory it opens and may write to it while recovering its log or
+///            compacting, so the world is opened from a private mirror instead. The mirror is created next to the
+///            directory of the world, named after it with a "-mirror-" suffix, and removed when the world is closed.
+///            Table files are hard linked into the mirror, so it costs little more than the log. The directory
+///            containing the world has to be writable, DATABASE_OPEN_ERROR is returned otherwise. Mirrors left
+///            behind by a process that crashed are removed the next time the world is opened read-only.
+///            The mirror is a consistent snapshot, taken again if the game changed the world while it was copied.
+///            Later changes to the original are not visible. Subchunks can still be
+///            edited in memory, but FlushWorld and SaveSubchunk fail with INVALID_ARGUMENT.
+Result OpenWorldReadOnly(const char* path, const WorldOptions* options, World** world) {
+    WorldOptions defaultOptions;
+    if(options == nullptr) {
+        InitWorldOptions(&defaultOptions);
+        options = &defaultOptions;
+    }
+
+    World* pWorld = new World();
+    Result result = OpenDatabase(pWorld, path, *options, true);
+    if(BF_FAILED(result)) {
+        FreeWorld(pWorld);
+        return result;
     }
 
+    *world = pWorld;
     return SUCCESS;
 }
 
 /// @brief Closes the LevelDB database and frees the world
 /// @param world World to be freed
 /// @returns Result
+/// @attention Subchunks that are still dirty are discarded, call FlushWorld first to keep them
 Result CloseWorld(World* world) {
-    ClearChunkCache(world);
-    hashmap_destroy(&world->chunkCache);
-    delete (leveldb::DB*)world->db;
-    delete options.filter_policy;
-    delete options.block_cache;
-    delete options.compressors[0];
-    delete options.compressors[1];
-    delete world;
-
+    FreeWorld(world);
     return SUCCESS;
 }
 
@@ -96,46 +425,234 @@ Result CloseWorld(World* world) {
 /// @param buffer Buffer to put the data into
 /// @param bufferLen Pointer to an integer containing the length of the data
 /// @returns Result
+/// @attention The buffer is allocated using malloc and has to be freed by the caller.
+///            Use AcquireEntry instead if the data is only needed temporarily.
 /// @internal
 Result LoadEntry(
     World* world, const unsigned char* key, unsigned int keyLen, unsigned char** buffer, unsigned int* bufferLen
+) {
+    Entry entry;
+    Result result = AcquireEntry(world, key, keyLen, &entry);
+    if(BF_FAILED(result)) {
+        return result;
+    }
+
+    // Copy the value into a char array to be able to use it in C
+    auto tempBuffer = (unsigned char*)malloc(entry.length + 1);
+    if(tempBuffer == nullptr) {
+        ReleaseEntry(&entry);
+        return ALLOCATION_FAILED;
+    }
+
+    memcpy(tempBuffer, entry.data, entry.length);
+    *buffer = tempBuffer;
+    *bufferLen = entry.length;
+
+    ReleaseEntry(&entry);
+    return SUCCESS;
+}
+
+/// @brief Value buffers that have been released by ReleaseEntry and can be reused by this thread
+/// @internal
+static thread_local std::vector<std::unique_ptr<std::string>> entryBufferPool;
+
+/// @brief Maximum amount of released value buffers kept around per thread
+/// @internal
+static constexpr size_t maxPooledEntryBuffers = 8;
+
+/// @brief Loads a database entry into a recycled value buffer
+/// @internal
+static Result AcquireEntryWithOptions(
+    World* world, const leveldb::ReadOptions& options, const unsigned char* key, unsigned int keyLen, Entry* entry
 ) {
     leveldb::Slice slice = leveldb::Slice(reinterpret_cast<const char*>(key), keyLen);
-    std::string cppValue;
+
+    std::unique_ptr<std::string> value;
+    if(entryBufferPool.empty()) {
+        value = std::make_unique<std::string>();
+    } else {
+        value = std::move(entryBufferPool.back());
+        entryBufferPool.pop_back();
+    }
 
     // Load from database
-    leveldb::Status status = ((leveldb::DB*)world->db)->Get(readOptions, slice, &cppValue);
+    leveldb::Status status = ((leveldb::DB*)world->db)->Get(options, slice, value.get());
     if(!status.ok()) {
+        entry->handle = value.release();
+        ReleaseEntry(entry);
+
         if(status.IsNotFound()) {
             return SUBCHUNK_NOT_FOUND;
         }
         return DATABASE_READ_ERROR;
     }
 
-    // Copy the string content into a char array to be able to use it in C
-    *bufferLen = cppValue.length();
-    auto tempBuffer = new unsigned char[cppValue.length() + 1];
+    entry->data = reinterpret_cast<const unsigned char*>(value->data());
+    entry->length = (unsigned int)value->length();
+    entry->handle = value.release();
 
-    memcpy(tempBuffer, cppValue.c_str(), cppValue.length());
-    *buffer = tempBuffer;
+    return SUCCESS;
+}
+
+/// @brief Loads a database entry without copying it into a C buffer
+/// @param world World containing the database
+/// @param key Key used to load the entry
+/// @param keyLen Length of the key
+/// @param entry Entry that will point at the loaded data
+/// @returns Result
+/// @attention The data is owned by the entry and stays valid until ReleaseEntry is called.
+///            The value buffers are recycled, so in the steady state loading an entry does not allocate.
+/// @internal
+Result AcquireEntry(World* world, const unsigned char* key, unsigned int keyLen, Entry* entry) {
+    return AcquireEntryWithOptions(world, GetWorldSettings(world)->readOptions, key, keyLen, entry);
+}
+
+/// @brief Loads a database entry as part of a bulk load
+/// @param world World containing the database
+/// @param key Key used to load the entry
+/// @param keyLen Length of the key
+/// @param entry Entry that will point at the loaded data
+/// @returns Result
+/// @attention Works like AcquireEntry, but the blocks read from disk are not added to the LevelDB block cache,
+///            so a bulk load does not evict the blocks point queries keep hitting
+/// @internal
+Result AcquireScanEntry(World* world, const unsigned char* key, unsigned int keyLen, Entry* entry) {
+    return AcquireEntryWithOptions(world, GetWorldSettings(world)->scanOptions, key, keyLen, entry);
+}
 
+/// @brief Releases an entry loaded by AcquireEntry
+/// @param entry Entry to be released
+/// @internal
+void ReleaseEntry(Entry* entry) {
+    std::unique_ptr<std::string> value((std::string*)entry->handle);
+    if(entryBufferPool.size() < maxPooledEntryBuffers) {
+        entryBufferPool.push_back(std::move(value));
+    }
+
+    entry->data = nullptr;
+    entry->length = 0;
+    entry->handle = nullptr;
+}
+
+/// @brief Writes a database entry
+/// @param world World containing the database
+/// @param key Key of the entry
+/// @param keyLen Length of the key
+/// @param data Value to be written
+/// @param length Length of the value
+/// @returns Result
+/// @internal
+Result StoreEntry(
+    World* world, const unsigned char* key, unsigned int keyLen, const unsigned char* data, unsigned int length
+) {
+    if(world->readOnly) {
+        std::cerr << "Cannot write to a world opened with OpenWorldReadOnly" << std::endl;
+        return INVALID_ARGUMENT;
+    }
+
+    leveldb::Slice keySlice(reinterpret_cast<const char*>(key), keyLen);
+    leveldb::Slice valueSlice(reinterpret_cast<const char*>(data), length);
+
+    leveldb::Status status = ((leveldb::DB*)world->db)->Put(leveldb::WriteOptions(), keySlice, valueSlice);
+    if(!status.ok()) {
+        std::cerr << "Failed to write database entry with error: " << status.ToString() << std::endl;
+        return DATABASE_WRITE_ERROR;
+    }
+
+    int x, z;
+    unsigned char y;
+    Dimension dimension;
+    if(ParseSubchunkKey(key, keyLen, &x, &y, &z, &dimension)) {
+        MarkSubchunkPresent(world, x, y, z, dimension);
+    }
+    return SUCCESS;
+}
+
+/// @brief Points the iterator at the entry the LevelDB iterator is positioned at
+/// @returns 1 if the iterator points at an entry, 0 if it reached the end of the database
+/// @internal
+static int UpdateEntryIterator(EntryIterator* iterator) {
+    auto dbIterator = (leveldb::Iterator*)iterator->handle;
+    if(!dbIterator->Valid()) {
+        iterator->key = nullptr;
+        iterator->keyLength = 0;
+        iterator->data = nullptr;
+        iterator->length = 0;
+        return 0;
+    }
+
+    leveldb::Slice key = dbIterator->key();
+    leveldb::Slice value = dbIterator->value();
+    iterator->key = reinterpret_cast<const unsigned char*>(key.data());
+    iterator->keyLength = (unsigned int)key.size();
+    iterator->data = reinterpret_cast<const unsigned char*>(value.data());
+    iterator->length = (unsigned int)value.size();
+    return 1;
+}
+
+/// @brief Opens an iterator that walks over the database entries in key order
+/// @param world World containing the database
+/// @param iterator Iterator to be opened, it does not point at an entry until SeekEntryIterator is called
+/// @returns Result
+/// @attention The key and data of the current entry are borrowed from LevelDB and stay valid until the iterator
+///            is moved or closed. Decode them in place instead of copying them.
+///            Iterators use the scan read options, the blocks they read are not added to the LevelDB block cache.
+/// @internal
+Result OpenEntryIterator(World* world, EntryIterator* iterator) {
+    iterator->handle = ((leveldb::DB*)world->db)->NewIterator(GetWorldSettings(world)->scanOptions);
+    if(iterator->handle == nullptr) {
+        return ALLOCATION_FAILED;
+    }
+
+    iterator->key = nullptr;
+    iterator->keyLength = 0;
+    iterator->data = nullptr;
+    iterator->length = 0;
     return SUCCESS;
 }
 
-/// @brief Runs for every hashmap entry and frees it
+/// @brief Moves the iterator to the first entry with a key that is equal to or greater than the given key
+/// @param iterator Iterator to be moved
+/// @param key Key to seek to
+/// @param keyLen Length of the key
+/// @returns 1 if the iterator points at an entry, 0 if it reached the end of the database
+/// @internal
+int SeekEntryIterator(EntryIterator* iterator, const unsigned char* key, unsigned int keyLen) {
+    ((leveldb::Iterator*)iterator->handle)->Seek(leveldb::Slice(reinterpret_cast<const char*>(key), keyLen));
+    return UpdateEntryIterator(iterator);
+}
+
+/// @brief Moves the iterator to the next entry
+/// @param iterator Iterator to be moved, it has to point at an entry
+/// @returns 1 if the iterator points at an entry, 0 if it reached the end of the database
 /// @internal
-int ClearChunkCacheEntry(void* const context, struct hashmap_element_s* const e) {
-    FreeSubchunk((World*)context, (Subchunk*)e->data);
-    return -1;
+int NextEntryIterator(EntryIterator* iterator) {
+    ((leveldb::Iterator*)iterator->handle)->Next();
+    return UpdateEntryIterator(iterator);
+}
+
+/// @brief Closes an iterator
+/// @param iterator Iterator to be closed
+/// @returns DATABASE_READ_ERROR if the iterator stopped early because of a read error, SUCCESS otherwise
+/// @internal
+Result CloseEntryIterator(EntryIterator* iterator) {
+    auto dbIterator = (leveldb::Iterator*)iterator->handle;
+    leveldb::Status status = dbIterator->status();
+    delete dbIterator;
+    iterator->handle = nullptr;
+
+    if(!status.ok()) {
+        std::cerr << "Iterating the database failed with error: " << status.ToString() << std::endl;
+        return DATABASE_READ_ERROR;
+    }
+    return SUCCESS;
 }
 
-/// @brief Clears the chunk cache and frees all the loaded subchunks from memory
+/// @brief Evicts all subchunks that are neither pinned nor dirty from the chunk cache
 /// @param world World containing the chunk cache
 void ClearChunkCache(World* world) {
-    if(hashmap_iterate_pairs(&world->chunkCache, ClearChunkCacheEntry, world)) {
-        std::cerr << "Failed to free all subchunks in chunk cache" << std::endl;
-    }
-    ((leveldb::Cache*)world->leveldbCache)->Prune();
+    EvictChunkCache(world->chunkCache, 0);
+    if(world->leveldbCache != nullptr) ((leveldb::Cache*)world->leveldbCache)->Prune();
 }
 
 /// @brief Converts a result to a readable string
@@ -159,6 +676,12 @@ const char* TranslateErrorString(Result error) {
             return "DESERIALIZATION_FAILED";
         case HASHMAP_INSERTION_FAILED:
             return "HASHMAP_INSERTION_FAILED";
+        case LOAD_CANCELLED:
+            return "LOAD_CANCELLED";
+        case INVALID_ARGUMENT:
+            return "INVALID_ARGUMENT";
+        case DATABASE_WRITE_ERROR:
+            return "DATABASE_WRITE_ERROR";
         default:
             return "UNKNOWN";
     }
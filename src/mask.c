@@ -0,0 +1,117 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "BedrockFormat/mask.h"
+#include "BedrockFormat/storage.h"
+
+#include <string.h>
+
+#define BLOCK_MASK_WORDS (SUBCHUNK_BLOCK_COUNT / 64)
+
+/// @brief Counts the set bits of a word
+/// @internal
+static unsigned int CountWordBits(unsigned long long value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned int)__builtin_popcountll(value);
+#else
+    value = value - ((value >> 1) & 0x5555555555555555ull);
+    value = (value & 0x3333333333333333ull) + ((value >> 2) & 0x3333333333333333ull);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (unsigned int)((value * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+/// @brief Builds a mask of every block in a subchunk layer that matches a predicate
+/// @param subchunk Subchunk containing the blocks
+/// @param layer Block storage layer to build the mask from, 0 for the main layer and 1 for water
+/// @param predicate Function deciding which block states are set in the mask
+/// @param predicateData Pointer passed to the predicate
+/// @param mask Mask to write into, every bit is overwritten
+/// @returns Result, INVALID_ARGUMENT if the subchunk does not have the layer
+/// @attention The predicate is called once per palette entry and not per block, afterwards the palette
+///            indices are turned into bits by BuildBlockIndexMask. A uniform layer never gets unpacked.
+Result ExtractBlockMask(Subchunk* subchunk, unsigned char layer, BlockStatePredicate predicate, void* predicateData, BlockMask* mask) {
+    BlockStorage* storage;
+    Result result = GetSubchunkLayer(subchunk, layer, &storage);
+    if(BF_FAILED(result)) {
+        return result;
+    }
+
+    unsigned char table[SUBCHUNK_BLOCK_COUNT];
+    for(unsigned int i = 0; i < storage->paletteSize; i++) {
+        unsigned int runtimeId = storage->palette[i];
+        table[i] = (unsigned char)(predicate(predicateData, runtimeId, GetBlockState(runtimeId)) ? 1 : 0);
+    }
+
+    if(storage->bitsPerBlock == 0) {
+        memset(mask->bits, table[0] ? 0xFF : 0, sizeof(mask->bits));
+        return SUCCESS;
+    }
+
+    unsigned short blocks[SUBCHUNK_BLOCK_COUNT];
+    ExpandBlockStorage(storage, blocks);
+    BuildBlockIndexMask(blocks, table, storage->paletteSize, mask->bits);
+    return SUCCESS;
+}
+
+/// @brief Intersects two arrays of masks
+/// @param destination Array of masks to write the result into, may be the same array as a or b
+/// @param a First array of masks
+/// @param b Second array of masks
+/// @param count Amount of masks in every array
+void AndBlockMasks(BlockMask* destination, const BlockMask* a, const BlockMask* b, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        for(unsigned int word = 0; word < BLOCK_MASK_WORDS; word++) {
+            destination[i].bits[word] = a[i].bits[word] & b[i].bits[word];
+        }
+    }
+}
+
+/// @brief Unites two arrays of masks
+/// @param destination Array of masks to write the result into, may be the same array as a or b
+/// @param a First array of masks
+/// @param b Second array of masks
+/// @param count Amount of masks in every array
+void OrBlockMasks(BlockMask* destination, const BlockMask* a, const BlockMask* b, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        for(unsigned int word = 0; word < BLOCK_MASK_WORDS; word++) {
+            destination[i].bits[word] = a[i].bits[word] | b[i].bits[word];
+        }
+    }
+}
+
+/// @brief Inverts an array of masks
+/// @param destination Array of masks to write the result into, may be the same array as source
+/// @param source Array of masks to invert
+/// @param count Amount of masks in every array
+void NotBlockMasks(BlockMask* destination, const BlockMask* source, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        for(unsigned int word = 0; word < BLOCK_MASK_WORDS; word++) {
+            destination[i].bits[word] = ~source[i].bits[word];
+        }
+    }
+}
+
+/// @brief Counts the blocks set in an array of masks
+/// @param masks Array of masks, for example one per subchunk of a region
+/// @param count Amount of masks in the array
+/// @returns Amount of set blocks over all masks
+size_t CountBlockMasks(const BlockMask* masks, size_t count) {
+    size_t total = 0;
+    for(size_t i = 0; i < count; i++) {
+        for(unsigned int word = 0; word < BLOCK_MASK_WORDS; word++) {
+            total += CountWordBits(masks[i].bits[word]);
+        }
+    }
+    return total;
+}
@@ -10,6 +10,7 @@
 //
 // THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+
 #include "BedrockFormat/nbt.h"
 #include "BedrockFormat/format.h"
 
@@ -17,237 +18,1108 @@
 #include <stdlib.h>
 #include <string.h>
 
-char* DecodeRawNbtString(ByteStream* stream) {
+/// @brief Amount of compound entries that can be buffered before the decoder needs heap memory
+/// @internal
+#define NBT_INLINE_SCRATCH_SIZE 32
+
+/// @brief Names that are shared by almost every block state, they are pointed to instead of being copied
+/// @internal
+static const char knownNbtNames[] = "name\0states\0version\0val";
+
+/// @internal
+static const struct {
+    unsigned short offset;
+    unsigned short length;
+} knownNbtNameTable[] = {
+    { 0, 4 },
+    { 5, 6 },
+    { 12, 7 },
+    { 20, 3 },
+    { 23, 0 } // Empty string, which is the terminator of "val"
+};
+
+/// @brief Shared storage of empty strings, so they do not need an allocation
+/// @internal
+static const char emptyString[] = "";
+
+/// @brief State of a single decode call
+/// @internal
+/// @attention Compounds are decoded into the scratch buffer first, because the amount of entries is only known
+///            once their END tag has been found. Nested compounds use the space behind the entries of their parent.
+typedef struct NbtDecoder_T {
+    ByteStream* stream;
+    Arena* arena;
+    NbtCompoundEntry* scratch;
+    size_t scratchCount;
+    size_t scratchCapacity;
+    NbtCompoundEntry inlineScratch[NBT_INLINE_SCRATCH_SIZE];
+} NbtDecoder;
+
+static int DecodeNbtPayload(NbtDecoder* decoder, enum NbtTagType type, NbtTag* tag, unsigned int depth);
+static void FreeNbtPayload(NbtTag* tag, Arena* arena);
+
+/// @brief Allocates memory for a decoded tag from the arena, or from the heap when no arena is used
+/// @internal
+static void* AllocateNbtMemory(Arena* arena, size_t size) {
+    return arena != NULL ? AllocateFromArena(arena, size) : malloc(size);
+}
+
+/// @brief Frees memory allocated by AllocateNbtMemory, memory from an arena is left to the arena
+/// @internal
+static void FreeNbtMemory(Arena* arena, void* memory) {
+    if(arena == NULL) free(memory);
+}
+
+/// @brief Checks if the stream has at least count bytes left
+/// @internal
+static int HasNbtBytes(ByteStream* stream, unsigned long long count) {
+    return stream->position <= stream->length && stream->length - stream->position >= count;
+}
+
+/// @brief Retrieves the size of payloads that do not depend on the data
+/// @internal
+/// @returns Size in bytes, 0 for strings, arrays, lists and compounds
+static unsigned int GetNbtFixedPayloadSize(enum NbtTagType type) {
+    switch(type) {
+        case NBT_BYTE:
+            return 1;
+        case NBT_SHORT:
+            return 2;
+        case NBT_INT:
+        case NBT_FLOAT:
+            return 4;
+        case NBT_LONG:
+        case NBT_DOUBLE:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+/// @brief Retrieves the size of a single value of a byte, int or long array
+/// @internal
+static unsigned int GetNbtArrayValueSize(enum NbtTagType type) {
+    return type == NBT_BYTE_ARRAY ? 1 : (type == NBT_INT_ARRAY ? 4 : 8);
+}
+
+/// @brief Advances the stream by count bytes if they are available
+/// @internal
+static int AdvanceNbtStream(ByteStream* stream, unsigned long long count) {
+    if(!HasNbtBytes(stream, count)) return 0;
+
+    stream->position += (unsigned int)count;
+    return 1;
+}
+
+/// @brief Reads a byte, short, int, long, float or double payload
+/// @param stream Bytestream positioned at the payload
+/// @param type Type of the payload
+/// @param tag Tag the value is stored in
+/// @returns 1 on success, 0 if the type is not a scalar or the stream is truncated
+int ReadNbtScalar(ByteStream* stream, enum NbtTagType type, NbtTag* tag) {
+    if(!HasNbtBytes(stream, GetNbtFixedPayloadSize(type))) return 0;
+
+    tag->type = type;
+    tag->length = 0;
+
+    switch(type) {
+        case NBT_BYTE:
+            tag->payload.byteValue = ReadByte(stream);
+            return 1;
+        case NBT_SHORT:
+            tag->payload.shortValue = ReadShort(stream);
+            return 1;
+        case NBT_INT:
+            tag->payload.intValue = ReadInt(stream);
+            return 1;
+        case NBT_LONG:
+            tag->payload.longValue = ReadLong(stream);
+            return 1;
+        case NBT_FLOAT:
+            tag->payload.floatValue = ReadFloat(stream);
+            return 1;
+        case NBT_DOUBLE:
+            tag->payload.doubleValue = ReadDouble(stream);
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/// @brief Checks if a name points into static storage instead of being allocated
+/// @internal
+static int IsSharedNbtName(const char* name) {
+    return name == emptyString || (name >= knownNbtNames && name < knownNbtNames + sizeof(knownNbtNames));
+}
+
+/// @brief Calculates the hash of a compound entry name (32-bit FNV-1a)
+/// @param name Name to be hashed, does not have to be NUL terminated
+/// @param length Length of the name
+/// @returns Hash of the name
+unsigned int HashNbtName(const char* name, unsigned int length) {
+    unsigned int hash = 2166136261u;
+    for(unsigned int i = 0; i < length; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/// @brief Calculates the amount of slots in the index behind the entries of a large compound
+/// @internal
+static unsigned int GetNbtCompoundIndexSize(unsigned int count) {
+    if(count < NBT_COMPOUND_INDEX_THRESHOLD) return 0;
+
+    unsigned int size = NBT_COMPOUND_INDEX_THRESHOLD * 2;
+    while(size < count * 2) size *= 2;
+    return size;
+}
+
+/// @brief Decodes a length-prefixed string into a null-terminated copy
+/// @param stream Bytestream positioned at the length of the string, it is left behind the last character
+/// @param arena Arena to allocate the copy from, NULL allocates it from the heap
+/// @returns Pointer to the null-terminated string, NULL if the string is empty, truncated or cannot be allocated
+/// @internal
+char* DecodeRawNbtString(ByteStream* stream, Arena* arena) {
+    if(!HasNbtBytes(stream, 2)) return NULL;
+
     unsigned short length = ReadShort(stream);
-    if(length == 0) return NULL;
+    if(length == 0 || !HasNbtBytes(stream, length)) return NULL;
 
-    char* string = calloc(length + 1, 1);
+    char* string = AllocateNbtMemory(arena, length + 1);
     if(string == NULL) {
         fprintf(stderr, "Failed to allocate buffer for NBT string\n");
         return NULL;
     }
 
     memcpy(string, stream->buffer + stream->position, length);
+    string[length] = '\0';
     stream->position += length;
 
     return string;
 }
 
-int DecodeNbtTagWithParent(ByteStream* stream, struct hashmap_s* parent) {
+/// @brief Decodes the name of a compound entry and calculates its hash
+/// @internal
+static int DecodeNbtName(NbtDecoder* decoder, NbtCompoundEntry* entry) {
+    ByteStream* stream = decoder->stream;
+    if(!HasNbtBytes(stream, 2)) return 0;
+
+    unsigned short length = ReadShort(stream);
+    if(!HasNbtBytes(stream, length)) return 0;
+
+    const char* data = (const char*)stream->buffer + stream->position;
+    entry->nameLength = length;
+    entry->hash = HashNbtName(data, length);
+    entry->name = NULL;
+
+    for(size_t i = 0; i < sizeof(knownNbtNameTable) / sizeof(knownNbtNameTable[0]); i++) {
+        if(knownNbtNameTable[i].length == length && memcmp(knownNbtNames + knownNbtNameTable[i].offset, data, length) == 0) {
+            entry->name = knownNbtNames + knownNbtNameTable[i].offset;
+            break;
+        }
+    }
+
+    if(entry->name == NULL) {
+        char* name = AllocateNbtMemory(decoder->arena, length + 1);
+        if(name == NULL) {
+            fprintf(stderr, "Failed to allocate buffer for NBT name\n");
+            return 0;
+        }
+
+        memcpy(name, data, length);
+        name[length] = '\0';
+        entry->name = name;
+    }
+
+    stream->position += length;
+    return 1;
+}
+
+/// @brief Decodes a string payload into a length-prefixed view
+/// @internal
+static int DecodeNbtString(NbtDecoder* decoder, NbtTag* tag) {
+    ByteStream* stream = decoder->stream;
+    if(!HasNbtBytes(stream, 2)) return 0;
+
+    unsigned short length = ReadShort(stream);
+    if(!HasNbtBytes(stream, length)) return 0;
+
+    tag->length = length;
+    if(length == 0) {
+        tag->payload.stringValue = emptyString;
+        return 1;
+    }
+
+    char* data = AllocateNbtMemory(decoder->arena, length + 1);
+    if(data == NULL) {
+        fprintf(stderr, "Failed to allocate buffer for NBT string\n");
+        return 0;
+    }
+
+    memcpy(data, stream->buffer + stream->position, length);
+    data[length] = '\0';
+    stream->position += length;
+
+    tag->payload.stringValue = data;
+    return 1;
+}
+
+/// @brief Decodes a byte, int or long array payload into a contiguous array of native values
+/// @internal
+static int DecodeNbtArray(NbtDecoder* decoder, enum NbtTagType type, NbtTag* tag) {
+    ByteStream* stream = decoder->stream;
+    if(!HasNbtBytes(stream, 4)) return 0;
+
+    int count = ReadInt(stream);
+    size_t valueSize = GetNbtArrayValueSize(type);
+    if(count < 0 || !HasNbtBytes(stream, (unsigned long long)count * valueSize)) {
+        fprintf(stderr, "%s is truncated\n", TranslateNbtType(type));
+        return 0;
+    }
+
+    tag->length = (unsigned int)count;
+    tag->payload.arrayValues = NULL;
+    if(count == 0) return 1;
+
+    void* values = AllocateNbtMemory(decoder->arena, count * valueSize);
+    if(values == NULL) {
+        fprintf(stderr, "Failed to allocate %i values of %s\n", count, TranslateNbtType(type));
+        return 0;
+    }
+
+    switch(type) {
+        case NBT_BYTE_ARRAY:
+            memcpy(values, stream->buffer + stream->position, count);
+            stream->position += count;
+            break;
+        case NBT_INT_ARRAY:
+            for(int i = 0; i < count; i++) {
+                ((int*)values)[i] = ReadInt(stream);
+            }
+            break;
+        default:
+            for(int i = 0; i < count; i++) {
+                ((long long*)values)[i] = ReadLong(stream);
+            }
+            break;
+    }
+
+    tag->payload.arrayValues = values;
+    return 1;
+}
+
+/// @brief Decodes a list payload into a contiguous array of unnamed tags
+/// @internal
+static int DecodeNbtList(NbtDecoder* decoder, NbtTag* tag, unsigned int depth) {
+    ByteStream* stream = decoder->stream;
+    if(!HasNbtBytes(stream, 5)) return 0;
+
+    tag->elementType = ReadByte(stream);
+    int count = ReadInt(stream);
+
+    // Every element takes at least one byte, which bounds the allocation by the size of the data
+    if(count < 0 || (count > 0 && tag->elementType == NBT_END) || !HasNbtBytes(stream, (unsigned int)count)) {
+        fprintf(stderr, "TAG_List is invalid or truncated\n");
+        return 0;
+    }
+
+    tag->length = 0;
+    tag->payload.listElements = NULL;
+    if(count == 0) return 1;
+
+    NbtTag* elements = AllocateNbtMemory(decoder->arena, sizeof(NbtTag) * count);
+    if(elements == NULL) {
+        fprintf(stderr, "Failed to allocate %i list elements\n", count);
+        return 0;
+    }
+
+    for(int i = 0; i < count; i++) {
+        if(!DecodeNbtPayload(decoder, tag->elementType, &elements[i], depth + 1)) {
+            for(int j = 0; j < i; j++) {
+                FreeNbtPayload(&elements[j], decoder->arena);
+            }
+            FreeNbtMemory(decoder->arena, elements);
+            return 0;
+        }
+    }
+
+    tag->length = (unsigned int)count;
+    tag->payload.listElements = elements;
+    return 1;
+}
+
+/// @brief Appends a decoded compound entry to the scratch buffer
+/// @internal
+static int PushNbtScratchEntry(NbtDecoder* decoder, const NbtCompoundEntry* entry) {
+    if(decoder->scratchCount == decoder->scratchCapacity) {
+        size_t capacity = decoder->scratchCapacity * 2;
+        NbtCompoundEntry* scratch;
+
+        if(decoder->scratch == decoder->inlineScratch) {
+            scratch = malloc(capacity * sizeof(NbtCompoundEntry));
+            if(scratch != NULL) memcpy(scratch, decoder->scratch, decoder->scratchCount * sizeof(NbtCompoundEntry));
+        } else {
+            scratch = realloc(decoder->scratch, capacity * sizeof(NbtCompoundEntry));
+        }
+
+        if(scratch == NULL) {
+            fprintf(stderr, "Failed to grow NBT compound buffer to %zu entries\n", capacity);
+            return 0;
+        }
+
+        decoder->scratch = scratch;
+        decoder->scratchCapacity = capacity;
+    }
+
+    decoder->scratch[decoder->scratchCount++] = *entry;
+    return 1;
+}
+
+/// @brief Frees the names and payloads of entries that have not been moved out of the scratch buffer yet
+/// @internal
+static void DropNbtScratchEntries(NbtDecoder* decoder, size_t start) {
+    for(size_t i = start; i < decoder->scratchCount; i++) {
+        NbtCompoundEntry* entry = &decoder->scratch[i];
+
+        if(!IsSharedNbtName(entry->name)) FreeNbtMemory(decoder->arena, (char*)entry->name);
+        FreeNbtPayload(&entry->tag, decoder->arena);
+    }
+
+    decoder->scratchCount = start;
+}
+
+/// @brief Decodes a compound payload into a contiguous array of entries
+/// @internal
+/// @attention Compounds with at least NBT_COMPOUND_INDEX_THRESHOLD entries get a hash index behind their entries
+static int DecodeNbtCompoundPayload(NbtDecoder* decoder, NbtTag* tag, unsigned int depth) {
+    ByteStream* stream = decoder->stream;
+    size_t start = decoder->scratchCount;
+
     for(;;) {
+        if(!HasNbtBytes(stream, 1)) {
+            fprintf(stderr, "TAG_Compound is truncated\n");
+            DropNbtScratchEntries(decoder, start);
+            return 0;
+        }
+
+        enum NbtTagType type = ReadByte(stream);
+        if(type == NBT_END) break;
+
+        // Decoded outside of the scratch buffer, nested compounds might move it
+        NbtCompoundEntry entry;
+        if(!DecodeNbtName(decoder, &entry)) {
+            DropNbtScratchEntries(decoder, start);
+            return 0;
+        }
+
+        if(!DecodeNbtPayload(decoder, type, &entry.tag, depth + 1)) {
+            if(!IsSharedNbtName(entry.name)) FreeNbtMemory(decoder->arena, (char*)entry.name);
+            DropNbtScratchEntries(decoder, start);
+            return 0;
+        }
+
+        if(!PushNbtScratchEntry(decoder, &entry)) {
+            if(!IsSharedNbtName(entry.name)) FreeNbtMemory(decoder->arena, (char*)entry.name);
+            FreeNbtPayload(&entry.tag, decoder->arena);
+            DropNbtScratchEntries(decoder, start);
+            return 0;
+        }
+    }
+
+    unsigned int count = (unsigned int)(decoder->scratchCount - start);
+    tag->length = count;
+    tag->payload.compoundEntries = NULL;
+    if(count == 0) return 1;
+
+    unsigned int indexSize = GetNbtCompoundIndexSize(count);
+    NbtCompoundEntry* entries = AllocateNbtMemory(
+            decoder->arena, count * sizeof(NbtCompoundEntry) + indexSize * sizeof(unsigned int)
+    );
+    if(entries == NULL) {
+        fprintf(stderr, "Failed to allocate %u compound entries\n", count);
+        DropNbtScratchEntries(decoder, start);
+        return 0;
+    }
+
+    memcpy(entries, decoder->scratch + start, count * sizeof(NbtCompoundEntry));
+    decoder->scratchCount = start;
+
+    if(indexSize != 0) {
+        // Slots contain the entry index + 1, so 0 marks an empty slot
+        unsigned int* index = (unsigned int*)(entries + count);
+        memset(index, 0, indexSize * sizeof(unsigned int));
+
+        for(unsigned int i = 0; i < count; i++) {
+            unsigned int slot = entries[i].hash & (indexSize - 1);
+            while(index[slot] != 0) slot = (slot + 1) & (indexSize - 1);
+            index[slot] = i + 1;
+        }
+    }
+
+    tag->payload.compoundEntries = entries;
+    return 1;
+}
+
+/// @brief Decodes the payload of a tag of the given type
+/// @internal
+/// @attention Nothing has to be freed when decoding fails
+static int DecodeNbtPayload(NbtDecoder* decoder, enum NbtTagType type, NbtTag* tag, unsigned int depth) {
+    if(depth > MAX_NBT_DEPTH) {
+        fprintf(stderr, "NBT data is nested deeper than %i levels\n", MAX_NBT_DEPTH);
+        return 0;
+    }
+
+    tag->type = type;
+    tag->length = 0;
+
+    switch(type) {
+        case NBT_BYTE:
+        case NBT_SHORT:
+        case NBT_INT:
+        case NBT_LONG:
+        case NBT_FLOAT:
+        case NBT_DOUBLE:
+            return ReadNbtScalar(decoder->stream, type, tag);
+        case NBT_STRING:
+            return DecodeNbtString(decoder, tag);
+        case NBT_BYTE_ARRAY:
+        case NBT_INT_ARRAY:
+        case NBT_LONG_ARRAY:
+            return DecodeNbtArray(decoder, type, tag);
+        case NBT_LIST:
+            return DecodeNbtList(decoder, tag, depth);
+        case NBT_COMPOUND:
+            return DecodeNbtCompoundPayload(decoder, tag, depth);
+        default:
+            fprintf(stderr, "Tag type invalid: %i\n", type);
+            return 0;
+    }
+}
+
+/// @brief Decodes the payload of a compound into a new tag
+/// @param stream Bytestream positioned behind the type and name of the compound
+/// @param arena Arena the tree is allocated from, NULL to allocate it on the heap
+/// @returns Pointer to the decoded tag, NULL on failure
+NbtTag* DecodeNbtCompound(ByteStream* stream, Arena* arena) {
+    NbtTag* tag = AllocateNbtMemory(arena, sizeof(NbtTag));
+    if(tag == NULL) {
+        fprintf(stderr, "Failed to allocate NBT tag\n");
+        return NULL;
+    }
+
+    NbtDecoder decoder;
+    decoder.stream = stream;
+    decoder.arena = arena;
+    decoder.scratch = decoder.inlineScratch;
+    decoder.scratchCount = 0;
+    decoder.scratchCapacity = NBT_INLINE_SCRATCH_SIZE;
+
+    int decoded = DecodeNbtPayload(&decoder, NBT_COMPOUND, tag, 0);
+    if(decoder.scratch != decoder.inlineScratch) free(decoder.scratch);
+
+    if(!decoded) {
+        FreeNbtMemory(arena, tag);
+        return NULL;
+    }
+
+    return tag;
+}
+
+static int SkipNbtPayloadInner(ByteStream* stream, enum NbtTagType type, unsigned int depth);
+
+/// @brief Skips count list elements of the given type
+/// @internal
+static int SkipNbtListElements(ByteStream* stream, enum NbtTagType elementType, unsigned int count, unsigned int depth) {
+    unsigned int fixedSize = GetNbtFixedPayloadSize(elementType);
+    if(fixedSize != 0) {
+        return AdvanceNbtStream(stream, (unsigned long long)count * fixedSize);
+    }
+
+    for(unsigned int i = 0; i < count; i++) {
+        if(!SkipNbtPayloadInner(stream, elementType, depth + 1)) return 0;
+    }
+    return 1;
+}
+
+/// @brief Skips the remaining entries of a compound including its END tag
+/// @internal
+static int SkipNbtCompoundEntries(ByteStream* stream, unsigned int depth) {
+    for(;;) {
+        if(!HasNbtBytes(stream, 1)) return 0;
+
         enum NbtTagType type = ReadByte(stream);
         if(type == NBT_END) return 1;
 
-        NbtTag* tag = malloc(sizeof(NbtTag));
-        if(tag == NULL) {
-            fprintf(stderr, "Failed to allocate NBT tag\n");
+        if(!HasNbtBytes(stream, 2)) return 0;
+        if(!AdvanceNbtStream(stream, (unsigned short)ReadShort(stream))) return 0;
+        if(!SkipNbtPayloadInner(stream, type, depth + 1)) return 0;
+    }
+}
+
+/// @internal
+static int SkipNbtPayloadInner(ByteStream* stream, enum NbtTagType type, unsigned int depth) {
+    if(depth > MAX_NBT_DEPTH) return 0;
+
+    unsigned int fixedSize = GetNbtFixedPayloadSize(type);
+    if(fixedSize != 0) {
+        return AdvanceNbtStream(stream, fixedSize);
+    }
+
+    switch(type) {
+        case NBT_STRING:
+            if(!HasNbtBytes(stream, 2)) return 0;
+            return AdvanceNbtStream(stream, (unsigned short)ReadShort(stream));
+        case NBT_BYTE_ARRAY:
+        case NBT_INT_ARRAY:
+        case NBT_LONG_ARRAY: {
+            if(!HasNbtBytes(stream, 4)) return 0;
+
+            int count = ReadInt(stream);
+            if(count < 0) return 0;
+            return AdvanceNbtStream(stream, (unsigned long long)count * GetNbtArrayValueSize(type));
+        }
+        case NBT_LIST: {
+            if(!HasNbtBytes(stream, 5)) return 0;
+
+            enum NbtTagType elementType = ReadByte(stream);
+            int count = ReadInt(stream);
+            if(count < 0 || (count > 0 && elementType == NBT_END)) return 0;
+            return SkipNbtListElements(stream, elementType, (unsigned int)count, depth);
+        }
+        case NBT_COMPOUND:
+            return SkipNbtCompoundEntries(stream, depth);
+        default:
             return 0;
+    }
+}
+
+/// @brief Jumps over the payload of a tag without decoding it
+/// @param stream Bytestream positioned at the payload
+/// @param type Type of the tag
+/// @returns 1 on success, 0 if the data is invalid or truncated
+/// @attention Fixed-size payloads and lists of them are skipped by length arithmetic alone
+int SkipNbtPayload(ByteStream* stream, enum NbtTagType type) {
+    return SkipNbtPayloadInner(stream, type, 0);
+}
+
+/// @brief Traversal state of VisitNbt
+/// @internal
+typedef struct NbtVisit_T {
+    ByteStream* stream;
+    const NbtVisitor* visitor;
+    void* userData;
+    int stopped;
+} NbtVisit;
+
+static int VisitNbtPayloadInner(NbtVisit* visit, enum NbtTagType type, unsigned int depth);
+
+/// @brief Reports the elements of a list
+/// @internal
+static int VisitNbtList(NbtVisit* visit, unsigned int depth) {
+    ByteStream* stream = visit->stream;
+    const NbtVisitor* visitor = visit->visitor;
+    if(!HasNbtBytes(stream, 5)) return 0;
+
+    enum NbtTagType elementType = ReadByte(stream);
+    int count = ReadInt(stream);
+    if(count < 0 || (count > 0 && elementType == NBT_END)) return 0;
+
+    NbtVisitResult result = visitor->beginList != NULL
+            ? visitor->beginList(visit->userData, elementType, (unsigned int)count) : NBT_VISIT_CONTINUE;
+    if(result == NBT_VISIT_STOP) {
+        visit->stopped = 1;
+        return 1;
+    }
+    if(result == NBT_VISIT_SKIP) {
+        return SkipNbtListElements(stream, elementType, (unsigned int)count, depth);
+    }
+
+    for(int i = 0; i < count; i++) {
+        if(!VisitNbtPayloadInner(visit, elementType, depth + 1)) return 0;
+        if(visit->stopped) return 1;
+    }
+
+    if(visitor->endList != NULL && visitor->endList(visit->userData) == NBT_VISIT_STOP) {
+        visit->stopped = 1;
+    }
+    return 1;
+}
+
+/// @brief Reports the entries of a compound
+/// @internal
+static int VisitNbtCompound(NbtVisit* visit, unsigned int depth) {
+    ByteStream* stream = visit->stream;
+    const NbtVisitor* visitor = visit->visitor;
+
+    NbtVisitResult result = visitor->beginCompound != NULL ? visitor->beginCompound(visit->userData) : NBT_VISIT_CONTINUE;
+    if(result == NBT_VISIT_STOP) {
+        visit->stopped = 1;
+        return 1;
+    }
+    if(result == NBT_VISIT_SKIP) {
+        return SkipNbtCompoundEntries(stream, depth);
+    }
+
+    for(;;) {
+        if(!HasNbtBytes(stream, 1)) return 0;
+
+        enum NbtTagType type = ReadByte(stream);
+        if(type == NBT_END) break;
+
+        if(!HasNbtBytes(stream, 2)) return 0;
+        unsigned short nameLength = ReadShort(stream);
+        if(!HasNbtBytes(stream, nameLength)) return 0;
+
+        const char* name = (const char*)stream->buffer + stream->position;
+        stream->position += nameLength;
+
+        result = visitor->key != NULL
+                ? visitor->key(visit->userData, type, name, nameLength) : NBT_VISIT_CONTINUE;
+        if(result == NBT_VISIT_STOP) {
+            visit->stopped = 1;
+            return 1;
         }
 
-        tag->type = type;
-        char* name = DecodeRawNbtString(stream);
+        if(result == NBT_VISIT_SKIP) {
+            if(!SkipNbtPayloadInner(stream, type, depth + 1)) return 0;
+            continue;
+        }
 
-        switch(tag->type) {
-            case NBT_BYTE:
-                tag->payload = malloc(sizeof(unsigned char));
-                if(tag->payload == NULL) {
-                    free(tag);
-                    fprintf(stderr, "Failed to allocate byte on heap\n");
-                    return 0;
-                }
-
-                unsigned char byteValue = ReadByte(stream);
-                memcpy(tag->payload, &byteValue, sizeof(unsigned char));
-                break;
-            case NBT_SHORT:
-                tag->payload = malloc(sizeof(short));
-                if(tag->payload == NULL) {
-                    free(tag);
-                    fprintf(stderr, "Failed to allocate short on heap\n");
-                    return 0;
-                }
-
-                short shortValue = ReadShort(stream);
-                memcpy(tag->payload, &shortValue, sizeof(short));
-                break;
-            case NBT_INT:
-                tag->payload = malloc(sizeof(int));
-                if(tag->payload == NULL) {
-                    free(tag);
-                    fprintf(stderr, "Failed to allocate int on heap\n");
-                    return 0;
-                }
-
-                int intValue = ReadInt(stream);
-                memcpy(tag->payload, &intValue, sizeof(int));
-                break;
-            case NBT_LONG:
-                tag->payload = malloc(sizeof(long));
-                if(tag->payload == NULL) {
-                    free(tag);
-                    fprintf(stderr, "Failed to allocate long on heap\n");
-                    return 0;
-                }
-
-                long longValue = ReadLong(stream);
-                memcpy(tag->payload, &longValue, sizeof(long));
-                break;
-            case NBT_FLOAT:
-                tag->payload = malloc(sizeof(float));
-                if(tag->payload == NULL) {
-                    free(tag);
-                    fprintf(stderr, "Failed to allocate float on heap\n");
-                    return 0;
-                }
-
-                float floatValue = ReadFloat(stream);
-                memcpy(tag->payload, &floatValue, sizeof(float));
-                break;
-            case NBT_DOUBLE:
-                tag->payload = malloc(sizeof(double));
-                if(tag->payload == NULL) {
-                    free(tag);
-                    fprintf(stderr, "Failed to allocate double on heap\n");
-                    return 0;
-                }
-
-                double doubleValue = ReadDouble(stream);
-                memcpy(tag->payload, &doubleValue, sizeof(double));
-                break;
-            case NBT_STRING:
-                tag->payload = DecodeRawNbtString(stream);
-                break;
-            case NBT_COMPOUND:
-                struct hashmap_s hashmap;
-                if(hashmap_create(1, &hashmap) != 0) {
-                    free(tag);
-                    fprintf(stderr, "Failed to create hashmap\n");
-                    return 0;
-                }
-
-                tag->payload = malloc(sizeof(struct hashmap_s));
-                if(tag->payload == NULL) {
-                    free(tag);
-                    hashmap_destroy(&hashmap);
-                    fprintf(stderr,"Failed to allocate memory for hashmap\n");
-                    return 0;
-                }
-
-                memcpy(tag->payload, &hashmap, sizeof(struct hashmap_s));
-                if(!DecodeNbtTagWithParent(stream, tag->payload)) {
-                    free(tag);
-                    hashmap_destroy(&hashmap);
-                    fprintf(stderr,"Failed to allocate memory for hashmap\n");
-                    return 0;
-                }
+        if(!VisitNbtPayloadInner(visit, type, depth + 1)) return 0;
+        if(visit->stopped) return 1;
+    }
 
-                break;
-            default:
-                fprintf(stderr, "Tag type unimplemented or invalid: %i\n", tag->type);
-                break;
+    if(visitor->endCompound != NULL && visitor->endCompound(visit->userData) == NBT_VISIT_STOP) {
+        visit->stopped = 1;
+    }
+    return 1;
+}
+
+/// @internal
+static int VisitNbtPayloadInner(NbtVisit* visit, enum NbtTagType type, unsigned int depth) {
+    ByteStream* stream = visit->stream;
+    const NbtVisitor* visitor = visit->visitor;
+    NbtVisitResult result = NBT_VISIT_CONTINUE;
+
+    if(depth > MAX_NBT_DEPTH) {
+        fprintf(stderr, "NBT data is nested deeper than %i levels\n", MAX_NBT_DEPTH);
+        return 0;
+    }
+
+    switch(type) {
+        case NBT_BYTE:
+        case NBT_SHORT:
+        case NBT_INT:
+        case NBT_LONG:
+        case NBT_FLOAT:
+        case NBT_DOUBLE: {
+            if(visitor->scalar == NULL) {
+                return AdvanceNbtStream(stream, GetNbtFixedPayloadSize(type));
+            }
+
+            NbtTag value;
+            if(!ReadNbtScalar(stream, type, &value)) return 0;
+
+            result = visitor->scalar(visit->userData, &value);
+            break;
+        }
+        case NBT_STRING: {
+            if(!HasNbtBytes(stream, 2)) return 0;
+            unsigned short length = ReadShort(stream);
+            if(!HasNbtBytes(stream, length)) return 0;
+
+            const char* data = (const char*)stream->buffer + stream->position;
+            stream->position += length;
+
+            if(visitor->string != NULL) result = visitor->string(visit->userData, data, length);
+            break;
         }
+        case NBT_BYTE_ARRAY:
+        case NBT_INT_ARRAY:
+        case NBT_LONG_ARRAY: {
+            if(!HasNbtBytes(stream, 4)) return 0;
+            int count = ReadInt(stream);
+            if(count < 0 || !HasNbtBytes(stream, (unsigned long long)count * GetNbtArrayValueSize(type))) return 0;
+
+            const unsigned char* values = stream->buffer + stream->position;
+            stream->position += count * GetNbtArrayValueSize(type);
+
+            if(visitor->array != NULL) result = visitor->array(visit->userData, type, values, (unsigned int)count);
+            break;
+        }
+        case NBT_LIST:
+            return VisitNbtList(visit, depth);
+        case NBT_COMPOUND:
+            return VisitNbtCompound(visit, depth);
+        default:
+            fprintf(stderr, "Tag type invalid: %i\n", type);
+            return 0;
+    }
+
+    if(result == NBT_VISIT_STOP) visit->stopped = 1;
+    return 1;
+}
+
+/// @brief Reports the payload of a tag to a visitor without building a tree
+/// @param stream Bytestream positioned at the payload
+/// @param type Type of the tag
+/// @param visitor Handlers to be called, handlers that are NULL are treated as returning NBT_VISIT_CONTINUE
+/// @param userData Pointer that is passed to the handlers
+/// @returns 1 on success or when a handler stopped the traversal, 0 if the data is invalid or truncated
+/// @attention Names, strings and array values point into the buffer of the stream and are not NUL terminated.
+///            Array values are passed as raw little-endian bytes.
+///            Returning NBT_VISIT_SKIP from key, beginCompound or beginList jumps over the payload
+///            or the rest of the container, the matching end handler is not called in that case.
+int VisitNbtPayload(ByteStream* stream, enum NbtTagType type, const NbtVisitor* visitor, void* userData) {
+    NbtVisit visit = { stream, visitor, userData, 0 };
+    return VisitNbtPayloadInner(&visit, type, 0);
+}
+
+/// @brief Reports a named tag to a visitor without building a tree
+/// @param stream Bytestream positioned at the type of the tag
+/// @param visitor Handlers to be called, the name of the tag is reported through the key handler
+/// @param userData Pointer that is passed to the handlers
+/// @returns 1 on success or when a handler stopped the traversal, 0 if the data is invalid or truncated
+int VisitNbt(ByteStream* stream, const NbtVisitor* visitor, void* userData) {
+    if(!HasNbtBytes(stream, 3)) return 0;
+
+    enum NbtTagType type = ReadByte(stream);
+    unsigned short nameLength = ReadShort(stream);
+    if(!HasNbtBytes(stream, nameLength)) return 0;
+
+    const char* name = (const char*)stream->buffer + stream->position;
+    stream->position += nameLength;
+
+    NbtVisitResult result = visitor->key != NULL
+            ? visitor->key(userData, type, name, nameLength) : NBT_VISIT_CONTINUE;
+    if(result == NBT_VISIT_STOP) return 1;
+    if(result == NBT_VISIT_SKIP) return SkipNbtPayload(stream, type);
+
+    return VisitNbtPayload(stream, type, visitor, userData);
+}
 
-        // Skip insertion when END tag was found
-        if(name == NULL) name = "compound";
-        if(tag != NULL) {
-            if(hashmap_put(parent, name, strlen(name), tag) != 0) {
-                free(tag);
-                fprintf(stderr, "Failed to insert NBT tag into hashmap\n");
-                return 0;
+/// @brief Looks up an entry of a compound tag by name
+/// @param tag Compound tag to search
+/// @param name Name of the entry
+/// @returns Pointer to the entry, NULL if it does not exist or the tag is not a compound
+NbtTag* GetNbtCompoundEntry(const NbtTag* tag, const char* name) {
+    unsigned int length = (unsigned int)strlen(name);
+    return FindNbtCompoundEntry(tag, name, length, HashNbtName(name, length));
+}
+
+/// @brief Looks up an entry of a compound tag by a name of which the hash is already known
+/// @param tag Compound tag to search
+/// @param name Name of the entry, does not have to be NUL terminated
+/// @param nameLength Length of the name
+/// @param hash Hash of the name as calculated by HashNbtName
+/// @returns Pointer to the entry, NULL if it does not exist or the tag is not a compound
+/// @attention Small compounds are searched linearly, large ones through their hash index
+NbtTag* FindNbtCompoundEntry(const NbtTag* tag, const char* name, unsigned int nameLength, unsigned int hash) {
+    if(tag->type != NBT_COMPOUND) return NULL;
+
+    NbtCompoundEntry* entries = tag->payload.compoundEntries;
+    unsigned int indexSize = GetNbtCompoundIndexSize(tag->length);
+    if(indexSize == 0) {
+        for(unsigned int i = 0; i < tag->length; i++) {
+            if(entries[i].nameLength == nameLength && memcmp(entries[i].name, name, nameLength) == 0) {
+                return &entries[i].tag;
             }
         }
+        return NULL;
+    }
+
+    const unsigned int* index = (const unsigned int*)(entries + tag->length);
+    for(unsigned int slot = hash & (indexSize - 1);; slot = (slot + 1) & (indexSize - 1)) {
+        if(index[slot] == 0) return NULL;
+
+        NbtCompoundEntry* entry = &entries[index[slot] - 1];
+        if(entry->hash == hash && entry->nameLength == nameLength && memcmp(entry->name, name, nameLength) == 0) {
+            return &entry->tag;
+        }
     }
 }
 
-int FreeHashmapEntries(void* const context, void* const value) {
-    BF_UNUSED(context);
+/// @brief Continues an FNV-1a hash with a block of bytes
+/// @internal
+static unsigned int MixNbtHash(unsigned int hash, const void* data, size_t length) {
+    const unsigned char* bytes = data;
+    for(size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
 
-    FreeNbtTag(value);
-    return 1;
+    return hash;
+}
+
+/// @brief Calculates a structural hash of a tag and all of its children
+/// @param tag Tag to be hashed
+/// @returns Hash of the tag
+/// @attention The order of compound entries does not change the hash, so two tags that CompareNbtTags considers
+///            equal always have the same hash
+unsigned int HashNbtTag(const NbtTag* tag) {
+    unsigned int hash = MixNbtHash(2166136261u, &tag->type, 1);
+
+    switch(tag->type) {
+        case NBT_STRING:
+            return MixNbtHash(hash, tag->payload.stringValue, tag->length);
+        case NBT_BYTE_ARRAY:
+        case NBT_INT_ARRAY:
+        case NBT_LONG_ARRAY:
+            return MixNbtHash(hash, tag->payload.arrayValues, (size_t)tag->length * GetNbtArrayValueSize(tag->type));
+        case NBT_LIST:
+            hash = MixNbtHash(hash, &tag->elementType, 1);
+            for(unsigned int i = 0; i < tag->length; i++) {
+                unsigned int elementHash = HashNbtTag(&tag->payload.listElements[i]);
+                hash = MixNbtHash(hash, &elementHash, sizeof(elementHash));
+            }
+            return hash;
+        case NBT_COMPOUND: {
+            // Entries are combined with a sum, which does not depend on their order
+            unsigned int sum = 0;
+            for(unsigned int i = 0; i < tag->length; i++) {
+                const NbtCompoundEntry* entry = &tag->payload.compoundEntries[i];
+
+                unsigned int valueHash = HashNbtTag(&entry->tag);
+                sum += MixNbtHash(entry->hash, &valueHash, sizeof(valueHash));
+            }
+            return MixNbtHash(hash, &sum, sizeof(sum));
+        }
+        default:
+            return MixNbtHash(hash, &tag->payload, GetNbtFixedPayloadSize(tag->type));
+    }
+}
+
+/// @brief Checks if two tags and all of their children are equal
+/// @param a First tag
+/// @param b Second tag
+/// @returns 1 if the tags are equal, 0 otherwise
+/// @attention Compounds are equal when they have the same entries, regardless of the order they were stored in.
+///            Floating point values are compared bit by bit.
+int CompareNbtTags(const NbtTag* a, const NbtTag* b) {
+    if(a->type != b->type || a->length != b->length) return 0;
+
+    switch(a->type) {
+        case NBT_STRING:
+            return memcmp(a->payload.stringValue, b->payload.stringValue, a->length) == 0;
+        case NBT_BYTE_ARRAY:
+        case NBT_INT_ARRAY:
+        case NBT_LONG_ARRAY:
+            return memcmp(
+                    a->payload.arrayValues, b->payload.arrayValues, (size_t)a->length * GetNbtArrayValueSize(a->type)
+            ) == 0;
+        case NBT_LIST:
+            if(a->length != 0 && a->elementType != b->elementType) return 0;
+
+            for(unsigned int i = 0; i < a->length; i++) {
+                if(!CompareNbtTags(&a->payload.listElements[i], &b->payload.listElements[i])) return 0;
+            }
+            return 1;
+        case NBT_COMPOUND:
+            for(unsigned int i = 0; i < a->length; i++) {
+                const NbtCompoundEntry* entry = &a->payload.compoundEntries[i];
+
+                // Entries usually are in the same order, so the entry at the same index is tried first
+                const NbtCompoundEntry* candidate = &b->payload.compoundEntries[i];
+                const NbtTag* other = candidate->nameLength == entry->nameLength
+                        && memcmp(candidate->name, entry->name, entry->nameLength) == 0
+                        ? &candidate->tag
+                        : FindNbtCompoundEntry(b, entry->name, entry->nameLength, entry->hash);
+                if(other == NULL || !CompareNbtTags(&entry->tag, other)) return 0;
+            }
+            return 1;
+        default:
+            return memcmp(&a->payload, &b->payload, GetNbtFixedPayloadSize(a->type)) == 0;
+    }
+}
+
+/// @brief Frees everything a payload points to, but not the tag itself
+/// @internal
+static void FreeNbtPayload(NbtTag* tag, Arena* arena) {
+    // Arena trees do not own anything outside of the arena
+    if(arena != NULL) return;
+
+    switch(tag->type) {
+        case NBT_STRING:
+            if(tag->payload.stringValue != emptyString) free((char*)tag->payload.stringValue);
+            break;
+        case NBT_BYTE_ARRAY:
+        case NBT_INT_ARRAY:
+        case NBT_LONG_ARRAY:
+            free(tag->payload.arrayValues);
+            break;
+        case NBT_LIST:
+            for(unsigned int i = 0; i < tag->length; i++) {
+                FreeNbtPayload(&tag->payload.listElements[i], NULL);
+            }
+            free(tag->payload.listElements);
+            break;
+        case NBT_COMPOUND:
+            for(unsigned int i = 0; i < tag->length; i++) {
+                NbtCompoundEntry* entry = &tag->payload.compoundEntries[i];
+
+                if(!IsSharedNbtName(entry->name)) free((char*)entry->name);
+                FreeNbtPayload(&entry->tag, NULL);
+            }
+            free(tag->payload.compoundEntries);
+            break;
+        default:
+            break;
+    }
 }
 
-void FreeNbtTag(NbtTag* tag) {
+/// @brief Frees a tag and all of its children
+/// @param tag Tag to be freed
+/// @param arena Arena the tag was decoded into, NULL if it was decoded onto the heap
+/// @attention Arena trees are released with their arena, so this function does nothing for them
+void FreeNbtTag(NbtTag* tag, Arena* arena) {
+    FreeNbtPayload(tag, arena);
+    FreeNbtMemory(arena, tag);
+}
+
+/// @brief Calculates how much memory everything a payload points to occupies
+/// @internal
+static size_t GetNbtPayloadMemorySize(const NbtTag* tag) {
+    size_t size = 0;
+
     switch(tag->type) {
-        // These type values are stored in the pointer, they do not have to be freed
+        case NBT_STRING:
+            if(tag->length != 0) size += tag->length + 1;
+            break;
+        case NBT_BYTE_ARRAY:
+            size += tag->length;
+            break;
+        case NBT_INT_ARRAY:
+            size += tag->length * sizeof(int);
+            break;
+        case NBT_LONG_ARRAY:
+            size += tag->length * sizeof(long long);
+            break;
+        case NBT_LIST:
+            size += tag->length * sizeof(NbtTag);
+            for(unsigned int i = 0; i < tag->length; i++) {
+                size += GetNbtPayloadMemorySize(&tag->payload.listElements[i]);
+            }
+            break;
         case NBT_COMPOUND:
-            hashmap_iterate(tag->payload, FreeHashmapEntries, NULL);
-            hashmap_destroy(tag->payload);
+            size += tag->length * sizeof(NbtCompoundEntry) + GetNbtCompoundIndexSize(tag->length) * sizeof(unsigned int);
+            for(unsigned int i = 0; i < tag->length; i++) {
+                NbtCompoundEntry* entry = &tag->payload.compoundEntries[i];
+
+                if(!IsSharedNbtName(entry->name)) size += entry->nameLength + 1;
+                size += GetNbtPayloadMemorySize(&entry->tag);
+            }
             break;
         default:
-            free(tag->payload);
             break;
     }
 
-    free(tag);
+    return size;
+}
+
+/// @brief Calculates how much heap memory a tag and all of its children occupy
+/// @param tag Tag to be measured
+/// @param arena Arena the tag was decoded into, NULL if it was decoded onto the heap
+/// @returns Size in bytes, 0 for arena trees since all of their memory is accounted to the arena
+size_t GetNbtTagMemorySize(NbtTag* tag, Arena* arena) {
+    if(arena != NULL) return 0;
+    return sizeof(NbtTag) + GetNbtPayloadMemorySize(tag);
 }
 
-int PrintNbtTagHashmapInner(void* const context, struct hashmap_element_s* const e) {
-    NbtTag* tag = e->data;
+/// @brief Prints the values of an array tag on a single line
+/// @internal
+static void PrintNbtArray(const NbtTag* tag) {
+    printf("): %u entries [", GetNbtArraySize(tag));
+    for(unsigned int i = 0; i < GetNbtArraySize(tag); i++) {
+        if(i != 0) printf(", ");
 
-    PrintNbtTagInner(tag->type, tag->payload, e->key, (int)context);
-    return 0;
+        switch(tag->type) {
+            case NBT_BYTE_ARRAY:
+                printf("%i", GetNbtByteArray(tag)[i]);
+                break;
+            case NBT_INT_ARRAY:
+                printf("%i", GetNbtIntArray(tag)[i]);
+                break;
+            default:
+                printf("%lld", GetNbtLongArray(tag)[i]);
+                break;
+        }
+    }
+    printf("]\n");
 }
 
-void PrintNbtTagInner(enum NbtTagType type, void* const payload, const char* name, int indentation) {
+void PrintNbtTagInner(const NbtTag* tag, const char* name, int indentation) {
     for(int i = 0; i < indentation; i++) {
         printf("\t");
     }
 
-    printf("%s(", TranslateNbtType(type));
+    printf("%s(", TranslateNbtType(tag->type));
     if(strcmp(name, "") == 0) {
         printf("None");
     } else {
         printf("'%s'", name);
     }
-    switch(type) {
+    switch(tag->type) {
         case NBT_COMPOUND:
-            printf("): %i entries {\n", hashmap_num_entries(payload));
-
-            indentation++;
-            int hashmapResult = hashmap_iterate_pairs(payload, PrintNbtTagHashmapInner, (void*)indentation);
-            if(hashmapResult != 0) {
-                for(int i = 0; i < indentation; i++) {
-                    printf("\t");
-                }
-                printf("Error loading rest of data... \n}\n");
-                return;
+            printf("): %u entries {\n", GetNbtCompoundSize(tag));
+
+            for(unsigned int i = 0; i < GetNbtCompoundSize(tag); i++) {
+                NbtCompoundEntry* entry = GetNbtCompoundEntryAt(tag, i);
+                PrintNbtTagInner(&entry->tag, entry->name, indentation + 1);
             }
 
-            indentation--;
             for(int i = 0; i < indentation; i++) {
                 printf("\t");
             }
             printf("}\n");
             break;
+        case NBT_LIST:
+            printf("): %u entries [\n", GetNbtListSize(tag));
+
+            for(unsigned int i = 0; i < GetNbtListSize(tag); i++) {
+                PrintNbtTagInner(GetNbtListElement(tag, i), "", indentation + 1);
+            }
+
+            for(int i = 0; i < indentation; i++) {
+                printf("\t");
+            }
+            printf("]\n");
+            break;
         case NBT_BYTE:
-            printf("): %i\n", *(unsigned char*)payload);
+            printf("): %i\n", GetNbtByte(tag));
             break;
         case NBT_SHORT:
-            printf("): %i\n", *(short*)payload);
+            printf("): %i\n", GetNbtShort(tag));
             break;
         case NBT_INT:
-            printf("): %i\n", *(int*)payload);
+            printf("): %i\n", GetNbtInt(tag));
             break;
         case NBT_LONG:
-            printf("): %lu\n", *(long*)payload);
+            printf("): %lld\n", GetNbtLong(tag));
             break;
         case NBT_FLOAT:
-            printf("): %f", *(float*)payload);
+            printf("): %f\n", GetNbtFloat(tag));
             break;
         case NBT_DOUBLE:
-            printf("): %f\n", *(double*)payload);
+            printf("): %f\n", GetNbtDouble(tag));
             break;
         case NBT_STRING:
-            printf("): '%s'\n", (char*)payload);
+            printf("): '%s'\n", GetNbtString(tag).data);
+            break;
+        case NBT_BYTE_ARRAY:
+        case NBT_INT_ARRAY:
+        case NBT_LONG_ARRAY:
+            PrintNbtArray(tag);
             break;
         default:
-            printf("): unknown (the tag type is invalid or it has not been implemented)\n");
+            printf("): unknown (the tag type is invalid)\n");
             break;
     }
 }
 
-void PrintNbtTag(NbtTag* tag) {
-    PrintNbtTagInner(tag->type, tag->payload, "", 0);
+void PrintNbtTag(const NbtTag* tag) {
+    PrintNbtTagInner(tag, "", 0);
 }
 
 const char* TranslateNbtType(enum NbtTagType type) {
@@ -0,0 +1,159 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "BedrockFormat/neighborhood.h"
+#include "BedrockFormat/cache.h"
+#include "BedrockFormat/registry.h"
+#include "BedrockFormat/storage.h"
+
+#include <stdio.h>
+
+/// @brief Copies the blocks a subchunk contributes to the padded view of a neighborhood
+/// @param neighborhood Neighborhood to fill
+/// @param subchunk Subchunk at the given offset, NULL if it does not exist
+/// @param dx Offset to the center subchunk on the x axis, from -1 to 1
+/// @param dy Offset to the center subchunk on the y axis, from -1 to 1
+/// @param dz Offset to the center subchunk on the z axis, from -1 to 1
+/// @attention Neighbors only contribute the face, edge or corner that touches the center, which is read
+///            block by block. The center is unpacked as a whole.
+/// @internal
+static void FillNeighborhoodView(SubchunkNeighborhood* neighborhood, const Subchunk* subchunk, int dx, int dy, int dz) {
+    // A neighbor below the center contributes its top layer, a neighbor above it its bottom layer
+    int minX = dx < 0 ? 15 : 0, maxX = dx > 0 ? 0 : 15;
+    int minY = dy < 0 ? 15 : 0, maxY = dy > 0 ? 0 : 15;
+    int minZ = dz < 0 ? 15 : 0, maxZ = dz > 0 ? 0 : 15;
+
+    if(subchunk != NULL && dx == 0 && dy == 0 && dz == 0) {
+        const BlockStorage* storage = &subchunk->storage;
+        unsigned short blocks[SUBCHUNK_BLOCK_COUNT];
+        if(storage->bitsPerBlock != 0) ExpandBlockStorage(storage, blocks);
+
+        const unsigned short* block = blocks;
+        for(int x = 0; x < 16; x++) {
+            for(int z = 0; z < 16; z++) {
+                unsigned int* ids = &neighborhood->ids[GetNeighborhoodIndex(x, 0, z)];
+                if(storage->bitsPerBlock == 0) {
+                    for(int y = 0; y < 16; y++) ids[y] = storage->palette[0];
+                } else {
+                    for(int y = 0; y < 16; y++) ids[y] = storage->palette[block[y]];
+                }
+                block += 16;
+            }
+        }
+        return;
+    }
+
+    for(int x = minX; x <= maxX; x++) {
+        for(int z = minZ; z <= maxZ; z++) {
+            for(int y = minY; y <= maxY; y++) {
+                unsigned int index = GetNeighborhoodIndex(x + 16 * dx, y + 16 * dy, z + 16 * dz);
+                neighborhood->ids[index] = subchunk != NULL
+                        ? GetBlockStorageId(&subchunk->storage, 256u * x + 16u * z + y) : INVALID_BLOCK_STATE_ID;
+            }
+        }
+    }
+}
+
+/// @brief Loads and pins a subchunk together with the 26 subchunks around it
+/// @param world World the subchunks are located in
+/// @param x X coordinate of the center subchunk
+/// @param y Y coordinate of the center subchunk, the subchunks above and below wrap around like their keys do
+/// @param z Z coordinate of the center subchunk
+/// @param dimension Dimension the subchunks are located in
+/// @param options Pipeline used to load missing subchunks in parallel, NULL loads them on the calling thread
+/// @param neighborhood Neighborhood to fill, usually reused for every center subchunk of a pass
+/// @returns Result, SUBCHUNK_NOT_FOUND if the center subchunk does not exist
+/// @attention On success the subchunks stay pinned in the chunk cache until ReleaseSubchunkNeighborhood is called.
+///            Every block of the center subchunk and the blocks of its neighbors that touch it are copied into a
+///            padded 18x18x18 view of runtime IDs, so a stencil can read all neighbors of a block without a lookup.
+///            Only the first block storage layer is part of the view.
+Result LoadSubchunkNeighborhood(
+        World* world, int x, unsigned char y, int z, Dimension dimension, const PipelineOptions* options,
+        SubchunkNeighborhood* neighborhood
+) {
+    neighborhood->world = world;
+    neighborhood->position.x = x;
+    neighborhood->position.y = y;
+    neighborhood->position.z = z;
+    neighborhood->position.dimension = dimension;
+
+    if(options != NULL) {
+        // Load every subchunk that is missing on the pipeline first, the loop below then only hits the cache
+        Position missing[27];
+        unsigned int missingCount = 0;
+        for(int dx = -1; dx <= 1; dx++) {
+            for(int dz = -1; dz <= 1; dz++) {
+                for(int dy = -1; dy <= 1; dy++) {
+                    unsigned char neighborY = (unsigned char)(y + dy);
+                    if(FindCachedSubchunk(world->chunkCache, PackSubchunkKey(x + dx, neighborY, z + dz, dimension)) != NULL) continue;
+
+                    missing[missingCount].x = x + dx;
+                    missing[missingCount].y = neighborY;
+                    missing[missingCount].z = z + dz;
+                    missing[missingCount].dimension = dimension;
+                    missingCount++;
+                }
+            }
+        }
+
+        // Subchunks that fail to load here fail again below, which is where the error is reported
+        if(missingCount > 1) {
+            unsigned int loaded;
+            LoadSubchunksParallel(world, missing, missingCount, options, &loaded);
+        }
+    }
+
+    unsigned int i = 0;
+    for(int dx = -1; dx <= 1; dx++) {
+        for(int dz = -1; dz <= 1; dz++) {
+            for(int dy = -1; dy <= 1; dy++, i++) {
+                Subchunk* subchunk;
+                Result result = LoadSubchunk(world, &subchunk, x + dx, (unsigned char)(y + dy), z + dz, dimension);
+                if(result == SUBCHUNK_NOT_FOUND && (dx != 0 || dy != 0 || dz != 0)) {
+                    subchunk = NULL;
+                } else if(BF_FAILED(result)) {
+                    neighborhood->subchunks[i] = NULL;
+                    while(i-- > 0) {
+                        if(neighborhood->subchunks[i] != NULL) UnpinSubchunk(world, neighborhood->subchunks[i]);
+                    }
+                    return result;
+                } else {
+                    // Loading the remaining neighbors must not evict the ones that are already in the view
+                    PinSubchunk(world, subchunk);
+                }
+
+                neighborhood->subchunks[i] = subchunk;
+            }
+        }
+    }
+
+    i = 0;
+    for(int dx = -1; dx <= 1; dx++) {
+        for(int dz = -1; dz <= 1; dz++) {
+            for(int dy = -1; dy <= 1; dy++, i++) {
+                FillNeighborhoodView(neighborhood, neighborhood->subchunks[i], dx, dy, dz);
+            }
+        }
+    }
+
+    return SUCCESS;
+}
+
+/// @brief Unpins the subchunks of a neighborhood so they can be evicted again
+/// @param neighborhood Neighborhood that has been loaded using LoadSubchunkNeighborhood
+void ReleaseSubchunkNeighborhood(SubchunkNeighborhood* neighborhood) {
+    for(unsigned int i = 0; i < 27; i++) {
+        if(neighborhood->subchunks[i] != NULL) UnpinSubchunk(neighborhood->world, neighborhood->subchunks[i]);
+        neighborhood->subchunks[i] = NULL;
+    }
+}
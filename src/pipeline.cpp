@@ -0,0 +1,507 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "BedrockFormat/format.h"
+
+extern "C" {
+    #include "BedrockFormat/chunk.h"
+    #include "BedrockFormat/cache.h"
+    #include "BedrockFormat/pipeline.h"
+    #include "BedrockFormat/presence.h"
+};
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    /// @brief Task queued on the worker threads of a world
+    /// @internal
+    struct QueuedTask {
+        PipelineTask task;
+        void* data;
+    };
+
+    /// @brief Worker threads of a world that run the decode pipelines and block searches
+    /// @internal
+    /// @attention The threads live as long as the world or until StopPipelineWorkers is called, so batching loads
+    ///            every tick does not create and join threads every tick. The pool grows to the largest thread count
+    ///            that has been requested and never shrinks.
+    class PipelineWorkers {
+    public:
+        explicit PipelineWorkers(unsigned int threadCount) {
+            Grow(threadCount);
+        }
+
+        ~PipelineWorkers() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closing = true;
+            }
+            taskAvailable.notify_all();
+
+            for(auto& worker : workers) {
+                worker.join();
+            }
+        }
+
+        /// @brief Starts more threads until the pool has at least the given amount
+        void Grow(unsigned int threadCount) {
+            while(workers.size() < threadCount) {
+                workers.emplace_back(&PipelineWorkers::Work, this);
+            }
+        }
+
+        /// @brief Queues a task that is run by the given amount of threads at the same time
+        void Submit(PipelineTask task, void* data, unsigned int count) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for(unsigned int i = 0; i < count; i++) {
+                    tasks.push_back({ task, data });
+                }
+            }
+            taskAvailable.notify_all();
+        }
+
+    private:
+        /// @brief Worker thread main loop
+        void Work() {
+            for(;;) {
+                QueuedTask queued;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    taskAvailable.wait(lock, [this] { return closing || !tasks.empty(); });
+                    if(tasks.empty()) break;
+
+                    queued = tasks.front();
+                    tasks.pop_front();
+                }
+
+                queued.task(queued.data);
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable taskAvailable;
+        std::deque<QueuedTask> tasks;
+        bool closing = false;
+
+        std::vector<std::thread> workers;
+    };
+
+    /// @brief Subchunk or whole column a worker has to read and decode
+    /// @internal
+    struct PipelineJob {
+        unsigned char key[SUBCHUNK_KEY_MAX_LENGTH];
+        unsigned int keyLength;
+        int x;
+        unsigned char y;
+        int z;
+        Dimension dimension;
+        bool wholeColumn;
+    };
+
+    /// @brief Decoded subchunk waiting to be published into the chunk cache
+    /// @internal
+    struct PipelineResult {
+        Subchunk* subchunk;
+        Result result;
+    };
+
+    /// @brief Reads and decodes subchunks on a pool of worker threads
+    /// @internal
+    /// @attention The reads happen on the worker threads of the world, so LevelDB decompresses the blocks there as
+    ///            well. Only the calling thread touches the chunk cache: it submits the jobs and publishes the decoded
+    ///            subchunks in between. At most queueDepth jobs are queued, being decoded or waiting to be published
+    ///            at any time.
+    class DecodePipeline {
+    public:
+        DecodePipeline(World* world, const PipelineOptions& options)
+            : world(world), queueDepth(std::max(options.queueDepth, 1u)) {
+            unsigned int threadCount = options.threadCount;
+            if(threadCount == 0) threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+            runningWorkers = threadCount;
+            SubmitPipelineTasks(world, threadCount, &DecodePipeline::RunWorker, this);
+        }
+
+        ~DecodePipeline() {
+            std::unique_lock<std::mutex> lock(mutex);
+            closing = true;
+            jobAvailable.notify_all();
+
+            // The workers belong to the world, only wait until they are done with this pipeline
+            workerFinished.wait(lock, [this] { return runningWorkers == 0; });
+            lock.unlock();
+
+            // Results that were never published are owned by nobody else
+            for(auto& result : results) {
+                if(result.subchunk != nullptr) FreeSubchunk(nullptr, result.subchunk);
+            }
+        }
+
+        /// @brief Queues a job, publishing finished results while the pipeline is full
+        void Submit(const PipelineJob& job) {
+            std::unique_lock<std::mutex> lock(mutex);
+            WaitUntil(lock, [this] { return inFlight < queueDepth; });
+
+            jobs.push_back(job);
+            inFlight++;
+            lock.unlock();
+
+            jobAvailable.notify_one();
+        }
+
+        /// @brief Waits for every queued job and publishes the remaining results
+        /// @attention The workers are released before the last results are published, so errors they report while
+        ///            closing their iterators end up in firstError as well
+        void Finish() {
+            std::unique_lock<std::mutex> lock(mutex);
+            WaitUntil(lock, [this] { return inFlight == 0; });
+
+            closing = true;
+            jobAvailable.notify_all();
+            workerFinished.wait(lock, [this] { return runningWorkers == 0; });
+
+            std::vector<PipelineResult> published;
+            published.swap(results);
+            lock.unlock();
+            Publish(published);
+        }
+
+        unsigned int loaded = 0;
+        Result firstError = SUCCESS;
+
+    private:
+        /// @brief Publishes results until the condition holds
+        template<typename Condition>
+        void WaitUntil(std::unique_lock<std::mutex>& lock, Condition condition) {
+            while(!condition()) {
+                if(results.empty() && finishedJobs == 0) {
+                    resultAvailable.wait(lock);
+                    continue;
+                }
+
+                std::vector<PipelineResult> published;
+                published.swap(results);
+                inFlight -= finishedJobs;
+                finishedJobs = 0;
+
+                lock.unlock();
+                Publish(published);
+                lock.lock();
+            }
+        }
+
+        /// @brief Inserts decoded subchunks into the chunk cache, runs on the calling thread
+        void Publish(std::vector<PipelineResult>& published) {
+            for(auto& result : published) {
+                if(result.subchunk == nullptr) {
+                    if(BF_FAILED(result.result) && result.result != SUBCHUNK_NOT_FOUND && !BF_FAILED(firstError)) {
+                        firstError = result.result;
+                    }
+                    continue;
+                }
+
+                Subchunk* cached;
+                Result adoptResult = AdoptCachedSubchunk(world->chunkCache, result.subchunk, &cached);
+                if(BF_FAILED(adoptResult)) {
+                    if(!BF_FAILED(firstError)) firstError = adoptResult;
+                    continue;
+                }
+                loaded++;
+            }
+        }
+
+        /// @brief Decodes a single database value into a subchunk
+        static PipelineResult Decode(
+                const unsigned char* data, unsigned int length, int x, unsigned char y, int z, Dimension dimension
+        ) {
+            PipelineResult result;
+            result.result = DecodeSubchunkValue(data, length, x, y, z, dimension, &result.subchunk);
+            if(BF_FAILED(result.result)) result.subchunk = nullptr;
+            return result;
+        }
+
+        /// @brief Reads and decodes every subchunk of a column with one seek
+        static void DecodeColumn(EntryIterator* iterator, const PipelineJob& job, std::vector<PipelineResult>& out) {
+            unsigned int prefixLength = job.keyLength - 1;
+
+            int valid = SeekEntryIterator(iterator, job.key, prefixLength);
+            for(; valid; valid = NextEntryIterator(iterator)) {
+                if(iterator->keyLength != job.keyLength || memcmp(iterator->key, job.key, prefixLength) != 0) {
+                    break;
+                }
+
+                out.push_back(Decode(
+                        iterator->data, iterator->length, job.x, iterator->key[prefixLength], job.z, job.dimension
+                ));
+            }
+        }
+
+        /// @brief Runs the worker loop of a pipeline on a thread of the world
+        static void RunWorker(void* data) {
+            static_cast<DecodePipeline*>(data)->Work();
+        }
+
+        /// @brief Worker loop, returns once the pipeline is closed
+        void Work() {
+            EntryIterator iterator;
+            bool iteratorOpen = false;
+            Result openResult = SUCCESS;
+            std::vector<PipelineResult> produced;
+
+            for(;;) {
+                PipelineJob job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    jobAvailable.wait(lock, [this] { return closing || !jobs.empty(); });
+                    if(jobs.empty()) break;
+
+                    job = jobs.front();
+                    jobs.pop_front();
+                }
+
+                if(job.wholeColumn) {
+                    // Every worker keeps its own iterator, they are not thread safe
+                    if(!iteratorOpen) {
+                        openResult = OpenEntryIterator(world, &iterator);
+                        iteratorOpen = !BF_FAILED(openResult);
+                    }
+
+                    if(iteratorOpen) {
+                        DecodeColumn(&iterator, job, produced);
+                    } else {
+                        produced.push_back({ nullptr, openResult });
+                    }
+                } else {
+                    Entry entry;
+                    Result result = AcquireScanEntry(world, job.key, job.keyLength, &entry);
+                    if(BF_FAILED(result)) {
+                        produced.push_back({ nullptr, result });
+                    } else {
+                        produced.push_back(Decode(entry.data, entry.length, job.x, job.y, job.z, job.dimension));
+                        ReleaseEntry(&entry);
+                    }
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    results.insert(results.end(), produced.begin(), produced.end());
+                    finishedJobs++;
+                }
+                produced.clear();
+                resultAvailable.notify_one();
+            }
+
+            // Iterators only see the database as it was when they were opened, so they never outlive a pipeline
+            Result result = iteratorOpen ? CloseEntryIterator(&iterator) : SUCCESS;
+
+            // Notified while locked, the pipeline can be destroyed as soon as the lock is released
+            std::lock_guard<std::mutex> lock(mutex);
+            if(BF_FAILED(result)) results.push_back({ nullptr, result });
+            runningWorkers--;
+            workerFinished.notify_one();
+        }
+
+        World* world;
+        unsigned int queueDepth;
+
+        std::mutex mutex;
+        std::condition_variable jobAvailable;
+        std::condition_variable resultAvailable;
+        std::condition_variable workerFinished;
+        std::deque<PipelineJob> jobs;
+        std::vector<PipelineResult> results;
+        unsigned int inFlight = 0;
+        unsigned int finishedJobs = 0;
+        unsigned int runningWorkers = 0;
+        bool closing = false;
+    };
+
+    /// @brief Orders jobs the same way LevelDB orders their keys
+    /// @internal
+    bool CompareJobKeys(const PipelineJob& a, const PipelineJob& b) {
+        unsigned int length = std::min(a.keyLength, b.keyLength);
+        int result = memcmp(a.key, b.key, length);
+        return result != 0 ? result < 0 : a.keyLength < b.keyLength;
+    }
+
+    /// @brief Runs a set of jobs through a pipeline in key order
+    /// @internal
+    Result RunPipeline(
+            World* world, std::vector<PipelineJob>& jobs, const PipelineOptions* options, unsigned int* loaded
+    ) {
+        PipelineOptions defaultOptions;
+        if(options == nullptr) {
+            InitPipelineOptions(&defaultOptions);
+            options = &defaultOptions;
+        }
+
+        if(jobs.empty()) {
+            return SUCCESS;
+        }
+        std::sort(jobs.begin(), jobs.end(), CompareJobKeys);
+
+        Result result;
+        {
+            DecodePipeline pipeline(world, *options);
+            for(const auto& job : jobs) {
+                pipeline.Submit(job);
+            }
+            pipeline.Finish();
+
+            *loaded += pipeline.loaded;
+            result = pipeline.firstError;
+        }
+
+        return result;
+    }
+}
+
+/// @brief Starts the worker threads the pipelines and block searches of a world run on
+/// @param world World the threads belong to
+/// @param threadCount Amount of worker threads, 0 uses one thread per hardware thread
+/// @returns Result
+/// @attention Calling this function is optional, the threads are started on first use otherwise. Pipelines that ask
+///            for more threads than the world has add the missing ones.
+Result StartPipelineWorkers(World* world, unsigned int threadCount) {
+    if(world->pipelineWorkers != nullptr) {
+        return INVALID_ARGUMENT;
+    }
+
+    if(threadCount == 0) threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    world->pipelineWorkers = new PipelineWorkers(threadCount);
+    return SUCCESS;
+}
+
+/// @brief Stops the worker threads of the pipelines
+/// @param world World the threads belong to
+/// @attention Must not be called while a pipeline or block search is running
+void StopPipelineWorkers(World* world) {
+    delete (PipelineWorkers*)world->pipelineWorkers;
+    world->pipelineWorkers = nullptr;
+}
+
+/// @brief Runs a task on the given amount of worker threads of a world at the same time
+/// @param world World the threads belong to
+/// @param threadCount Amount of threads that run the task, the pool is grown if it is smaller
+/// @param task Function that is called once per thread
+/// @param data Pointer that is passed to the task
+/// @attention The call returns right away, the caller has to wait for the tasks to finish by itself
+/// @internal
+void SubmitPipelineTasks(World* world, unsigned int threadCount, PipelineTask task, void* data) {
+    if(world->pipelineWorkers == nullptr) {
+        StartPipelineWorkers(world, threadCount);
+    }
+
+    auto workers = (PipelineWorkers*)world->pipelineWorkers;
+    workers->Grow(threadCount);
+    workers->Submit(task, data, threadCount);
+}
+
+/// @brief Populates the pipeline options with the default values
+/// @param options Options to be populated
+/// @attention A thread count of 0 uses one thread per hardware thread
+void InitPipelineOptions(PipelineOptions* options) {
+    options->threadCount = 0;
+    options->queueDepth = DEFAULT_PIPELINE_QUEUE_DEPTH;
+}
+
+/// @brief Loads a set of subchunks on a pool of worker threads and stores them in the world's chunk cache
+/// @param world World the subchunks are located in
+/// @param positions Positions of the subchunks in subchunk coordinates
+/// @param count Amount of positions
+/// @param options Thread count and queue depth of the pipeline, NULL uses the defaults
+/// @param loaded Pointer to an integer that will contain the amount of subchunks in the cache afterwards
+/// @returns Result
+/// @attention Subchunks that do not exist are skipped. Subchunks that fail to decode are skipped as well,
+///            the first error is returned after all positions have been processed.
+Result LoadSubchunksParallel(
+        World* world, const Position* positions, size_t count, const PipelineOptions* options, unsigned int* loaded
+) {
+    *loaded = 0;
+
+    std::vector<PipelineJob> jobs;
+    jobs.reserve(count);
+    for(size_t i = 0; i < count; i++) {
+        const Position& position = positions[i];
+        if(FindCachedSubchunk(
+                world->chunkCache, PackSubchunkKey(position.x, position.y, position.z, position.dimension)
+        ) != nullptr) {
+            (*loaded)++;
+            continue;
+        }
+        if(!IsSubchunkPresent(world, position.x, position.y, position.z, position.dimension)) {
+            continue;
+        }
+
+        PipelineJob job;
+        job.keyLength = GenerateSubchunkKey(position.x, position.y, position.z, position.dimension, job.key);
+        job.x = position.x;
+        job.y = position.y;
+        job.z = position.z;
+        job.dimension = position.dimension;
+        job.wholeColumn = false;
+        jobs.push_back(job);
+    }
+
+    return RunPipeline(world, jobs, options, loaded);
+}
+
+/// @brief Loads every subchunk in a rectangular region of chunk columns on a pool of worker threads
+/// @param world World the region is located in
+/// @param dimension Dimension the region is located in
+/// @param minX Smallest x-coordinate of the region in chunks
+/// @param minZ Smallest z-coordinate of the region in chunks
+/// @param maxX Largest x-coordinate of the region in chunks (inclusive)
+/// @param maxZ Largest z-coordinate of the region in chunks (inclusive)
+/// @param options Thread count and queue depth of the pipeline, NULL uses the defaults
+/// @param loaded Pointer to an integer that will contain the amount of subchunks in the region
+/// @returns Result
+/// @attention Every column is a single job, the workers read it with one seek of their own iterator.
+///            Make sure the chunk cache budget can hold the region.
+Result LoadRegionParallel(
+        World* world, Dimension dimension, int minX, int minZ, int maxX, int maxZ,
+        const PipelineOptions* options, unsigned int* loaded
+) {
+    *loaded = 0;
+    if(maxX < minX || maxZ < minZ) {
+        return SUCCESS;
+    }
+
+    std::vector<PipelineJob> jobs;
+    jobs.reserve(((size_t)maxX - minX + 1) * ((size_t)maxZ - minZ + 1));
+    for(int x = minX; x <= maxX; x++) {
+        for(int z = minZ; z <= maxZ; z++) {
+            if(!IsColumnPresent(world, x, z, dimension)) continue;
+
+            PipelineJob job;
+            job.keyLength = GenerateSubchunkKey(x, 0, z, dimension, job.key);
+            job.x = x;
+            job.y = 0;
+            job.z = z;
+            job.dimension = dimension;
+            job.wholeColumn = true;
+            jobs.push_back(job);
+        }
+    }
+
+    return RunPipeline(world, jobs, options, loaded);
+}
@@ -0,0 +1,274 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "BedrockFormat/presence.h"
+#include "BedrockFormat/cache.h"
+#include "BedrockFormat/chunk.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define INITIAL_PRESENCE_INDEX_SLOTS 256
+
+/// @brief Spreads the bits of a column key over the whole word so neighbouring columns end up in different slots
+/// @internal
+static inline unsigned long long MixColumnKey(unsigned long long key) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    key *= 0xC4CEB9FE1A85EC53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+/// @brief Checks if a slot of the index holds a column
+/// @internal
+static inline int IsColumnUsed(const PresenceColumn* column) {
+    return (column->layers[0] | column->layers[1] | column->layers[2] | column->layers[3]) != 0;
+}
+
+/// @brief Creates a new, empty presence index
+/// @returns Pointer to a presence index or NULL if the allocation failed
+/// @internal
+static PresenceIndex* CreatePresenceIndex(void) {
+    PresenceIndex* index = calloc(1, sizeof(PresenceIndex));
+    if(index == NULL) {
+        fprintf(stderr, "Failed to allocate presence index\n");
+        return NULL;
+    }
+
+    index->columns = calloc(INITIAL_PRESENCE_INDEX_SLOTS, sizeof(PresenceColumn));
+    if(index->columns == NULL) {
+        fprintf(stderr, "Failed to allocate presence index slots\n");
+        free(index);
+        return NULL;
+    }
+
+    index->slotMask = INITIAL_PRESENCE_INDEX_SLOTS - 1;
+    return index;
+}
+
+/// @brief Frees a presence index
+/// @param index Index to be freed, can be NULL
+/// @internal
+void DestroyPresenceIndex(PresenceIndex* index) {
+    if(index == NULL) return;
+
+    free(index->columns);
+    free(index);
+}
+
+/// @brief Looks up the slot of a column
+/// @returns The slot holding the column, or the empty slot it would be placed in
+/// @internal
+static PresenceColumn* FindColumnSlot(PresenceColumn* columns, unsigned int slotMask, unsigned long long key) {
+    for(unsigned int i = (unsigned int)MixColumnKey(key) & slotMask;; i = (i + 1) & slotMask) {
+        PresenceColumn* column = &columns[i];
+        if(!IsColumnUsed(column) || column->key == key) return column;
+    }
+}
+
+/// @brief Doubles the amount of slots once the table is half full
+/// @internal
+static Result GrowPresenceIndex(PresenceIndex* index) {
+    unsigned int slotCount = index->slotMask + 1;
+    if((index->columnCount + 1) * 2 <= slotCount) {
+        return SUCCESS;
+    }
+
+    PresenceColumn* columns = calloc(slotCount * 2, sizeof(PresenceColumn));
+    if(columns == NULL) {
+        fprintf(stderr, "Failed to grow presence index to %u slots\n", slotCount * 2);
+        return ALLOCATION_FAILED;
+    }
+
+    for(unsigned int i = 0; i < slotCount; i++) {
+        if(IsColumnUsed(&index->columns[i])) {
+            *FindColumnSlot(columns, slotCount * 2 - 1, index->columns[i].key) = index->columns[i];
+        }
+    }
+
+    free(index->columns);
+    index->columns = columns;
+    index->slotMask = slotCount * 2 - 1;
+    return SUCCESS;
+}
+
+/// @brief Sets the bit of a subchunk in the index
+/// @internal
+static Result AddSubchunk(PresenceIndex* index, int x, unsigned char y, int z, Dimension dimension) {
+    unsigned long long key = PackSubchunkKey(x, 0, z, dimension);
+    PresenceColumn* column = FindColumnSlot(index->columns, index->slotMask, key);
+    if(!IsColumnUsed(column)) {
+        Result result = GrowPresenceIndex(index);
+        if(BF_FAILED(result)) {
+            return result;
+        }
+
+        column = FindColumnSlot(index->columns, index->slotMask, key);
+        column->key = key;
+        column->x = x;
+        column->z = z;
+        index->columnCount++;
+    }
+
+    unsigned long long bit = 1ULL << (y % 64);
+    if((column->layers[y / 64] & bit) == 0) {
+        column->layers[y / 64] |= bit;
+        index->subchunkCount++;
+    }
+    return SUCCESS;
+}
+
+/// @brief Looks up a column in the index
+/// @returns The column or NULL if the column has no subchunks
+/// @internal
+static const PresenceColumn* FindColumn(const PresenceIndex* index, int x, int z, Dimension dimension) {
+    const PresenceColumn* column = FindColumnSlot(index->columns, index->slotMask, PackSubchunkKey(x, 0, z, dimension));
+    return IsColumnUsed(column) ? column : NULL;
+}
+
+/// @brief Builds the index of the subchunks that exist in the world
+/// @param world World to be indexed
+/// @returns Result
+/// @attention Every key of the database is visited once, the values are never decoded or copied. Once the index
+///            is built, LoadSubchunk and the bulk loaders answer lookups of subchunks that do not exist with a bit
+///            test instead of a database lookup. Subchunks written through this library are added to the index.
+///            Calling this function again rebuilds the index, which is needed if another process changed the world.
+Result BuildPresenceIndex(World* world) {
+    PresenceIndex* index = CreatePresenceIndex();
+    if(index == NULL) {
+        return ALLOCATION_FAILED;
+    }
+
+    EntryIterator iterator;
+    Result result = OpenEntryIterator(world, &iterator);
+    if(BF_FAILED(result)) {
+        DestroyPresenceIndex(index);
+        return result;
+    }
+
+    for(int valid = SeekEntryIterator(&iterator, NULL, 0); valid; valid = NextEntryIterator(&iterator)) {
+        int x, z;
+        unsigned char y;
+        Dimension dimension;
+        if(!ParseSubchunkKey(iterator.key, iterator.keyLength, &x, &y, &z, &dimension)) continue;
+
+        result = AddSubchunk(index, x, y, z, dimension);
+        if(BF_FAILED(result)) {
+            break;
+        }
+    }
+
+    Result closeResult = CloseEntryIterator(&iterator);
+    if(!BF_FAILED(result)) result = closeResult;
+    if(BF_FAILED(result)) {
+        DestroyPresenceIndex(index);
+        return result;
+    }
+
+    DestroyPresenceIndex(world->presenceIndex);
+    world->presenceIndex = index;
+    return SUCCESS;
+}
+
+/// @brief Records that a subchunk has been written to the database
+/// @param world World the subchunk is located in
+/// @param x X-coordinate of the subchunk
+/// @param y Y-coordinate of the subchunk
+/// @param z Z-coordinate of the subchunk
+/// @param dimension Dimension the subchunk is located in
+/// @attention Does nothing if the world has no presence index. If the index cannot grow it is dropped, so it
+///            never claims that a written subchunk does not exist.
+/// @internal
+void MarkSubchunkPresent(World* world, int x, unsigned char y, int z, Dimension dimension) {
+    if(world->presenceIndex == NULL) return;
+
+    if(BF_FAILED(AddSubchunk(world->presenceIndex, x, y, z, dimension))) {
+        DestroyPresenceIndex(world->presenceIndex);
+        world->presenceIndex = NULL;
+    }
+}
+
+/// @brief Checks if a subchunk exists in the world
+/// @param world World the subchunk is located in
+/// @param x X-coordinate of the subchunk
+/// @param y Y-coordinate of the subchunk
+/// @param z Z-coordinate of the subchunk
+/// @param dimension Dimension the subchunk is located in
+/// @returns 0 if the subchunk does not exist, 1 if it exists or the world has no presence index
+int IsSubchunkPresent(World* world, int x, unsigned char y, int z, Dimension dimension) {
+    if(world->presenceIndex == NULL) return 1;
+
+    const PresenceColumn* column = FindColumn(world->presenceIndex, x, z, dimension);
+    return column != NULL && ((column->layers[y / 64] >> (y % 64)) & 1) != 0;
+}
+
+/// @brief Checks if a chunk column has any subchunks
+/// @param world World the column is located in
+/// @param x X-coordinate of the column in chunks
+/// @param z Z-coordinate of the column in chunks
+/// @param dimension Dimension the column is located in
+/// @returns 0 if the column has no subchunks, 1 if it has or the world has no presence index
+int IsColumnPresent(World* world, int x, int z, Dimension dimension) {
+    if(world->presenceIndex == NULL) return 1;
+
+    return FindColumn(world->presenceIndex, x, z, dimension) != NULL;
+}
+
+/// @brief Retrieves the amount of chunks and the bounds of a dimension from the presence index
+/// @param world World to be queried
+/// @param dimension Dimension to be queried
+/// @param stats Struct that will be populated with the statistics
+/// @returns Result, INVALID_ARGUMENT if the world has no presence index
+Result GetPresenceStats(World* world, Dimension dimension, PresenceStats* stats) {
+    const PresenceIndex* index = world->presenceIndex;
+    if(index == NULL) {
+        fprintf(stderr, "The world has no presence index, call BuildPresenceIndex first\n");
+        return INVALID_ARGUMENT;
+    }
+
+    PresenceStats result = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    for(unsigned int i = 0; i <= index->slotMask; i++) {
+        const PresenceColumn* column = &index->columns[i];
+        if(!IsColumnUsed(column) || (Dimension)(column->key & 0xF) != dimension) continue;
+
+        // Subchunks with a negative y are stored in the upper half of the unsigned y byte
+        int minY = 128, maxY = -129;
+        for(unsigned int y = 0; y < 256; y++) {
+            if(((column->layers[y / 64] >> (y % 64)) & 1) == 0) continue;
+
+            int signedY = (signed char)y;
+            if(signedY < minY) minY = signedY;
+            if(signedY > maxY) maxY = signedY;
+            result.subchunkCount++;
+        }
+
+        if(result.columnCount == 0) {
+            result.minX = result.maxX = column->x;
+            result.minZ = result.maxZ = column->z;
+            result.minY = minY;
+            result.maxY = maxY;
+        } else {
+            if(column->x < result.minX) result.minX = column->x;
+            if(column->x > result.maxX) result.maxX = column->x;
+            if(column->z < result.minZ) result.minZ = column->z;
+            if(column->z > result.maxZ) result.maxZ = column->z;
+            if(minY < result.minY) result.minY = minY;
+            if(maxY > result.maxY) result.maxY = maxY;
+        }
+        result.columnCount++;
+    }
+
+    *stats = result;
+    return SUCCESS;
+}
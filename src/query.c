@@ -0,0 +1,249 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "BedrockFormat/query.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// @brief Parses a path expression, or only measures it when path is NULL
+/// @internal
+/// @returns Amount of steps, -1 if the expression is invalid
+static int ParseNbtPath(const char* expression, NbtPath* path, char* names, size_t* nameBytes) {
+    const char* c = expression;
+    int count = 0;
+    *nameBytes = 0;
+
+    while(*c != '\0') {
+        NbtPathStep step = { NULL, 0, 0, 0 };
+
+        if(*c == '[') {
+            c++;
+            if(*c < '0' || *c > '9') return -1;
+
+            unsigned long long index = 0;
+            while(*c >= '0' && *c <= '9') {
+                index = index * 10 + (unsigned long long)(*c - '0');
+                if(index > 0x7FFFFFFF) return -1;
+                c++;
+            }
+            if(*c != ']') return -1;
+            c++;
+
+            step.index = (unsigned int)index;
+        } else {
+            const char* name = c;
+            size_t length;
+
+            if(*c == '"') {
+                name = ++c;
+                while(*c != '"' && *c != '\0') c++;
+                if(*c != '"') return -1;
+
+                length = (size_t)(c - name);
+                c++;
+            } else {
+                while(*c != '.' && *c != '[' && *c != '\0') c++;
+                length = (size_t)(c - name);
+                if(length == 0) return -1;
+            }
+
+            if(length > 0xFFFF) return -1;
+
+            if(path != NULL) {
+                memcpy(names, name, length);
+                names[length] = '\0';
+
+                step.name = names;
+                step.nameLength = (unsigned int)length;
+                step.hash = HashNbtName(names, (unsigned int)length);
+                names += length + 1;
+            }
+            *nameBytes += length + 1;
+        }
+
+        if(path != NULL) path->steps[count] = step;
+        count++;
+
+        // Steps are separated by dots, index steps can also directly follow another step
+        if(*c == '.') {
+            c++;
+            if(*c == '\0' || *c == '[' || *c == '.') return -1;
+        } else if(*c != '[' && *c != '\0') {
+            return -1;
+        }
+    }
+
+    return count;
+}
+
+/// @brief Compiles a path expression so it can be run many times
+/// @param expression Path such as "states.color", "Pos[1]" or "Items[0].Name".
+///                   Names that contain dots or brackets can be put between double quotes.
+/// @returns Pointer to the compiled path, NULL if the expression is invalid or the allocation failed
+/// @attention An empty expression matches the root tag. The path has to be freed using FreeNbtPath.
+NbtPath* CompileNbtPath(const char* expression) {
+    size_t nameBytes;
+    int count = ParseNbtPath(expression, NULL, NULL, &nameBytes);
+    if(count < 0) {
+        fprintf(stderr, "NBT path '%s' is invalid\n", expression);
+        return NULL;
+    }
+
+    // The path, its steps and their names share a single allocation
+    NbtPath* path = malloc(sizeof(NbtPath) + count * sizeof(NbtPathStep) + nameBytes);
+    if(path == NULL) {
+        fprintf(stderr, "Failed to allocate NBT path\n");
+        return NULL;
+    }
+
+    path->steps = (NbtPathStep*)(path + 1);
+    path->stepCount = (unsigned int)count;
+    ParseNbtPath(expression, path, (char*)(path->steps + count), &nameBytes);
+
+    return path;
+}
+
+/// @brief Frees a compiled path
+/// @param path Path to be freed
+void FreeNbtPath(NbtPath* path) {
+    free(path);
+}
+
+/// @brief Advances the stream to the payload of a compound entry
+/// @internal
+/// @returns 1 if the entry was found, 0 if it does not exist or the data is invalid
+static int FindNbtCompoundStep(ByteStream* stream, const NbtPathStep* step, enum NbtTagType* type) {
+    for(;;) {
+        if(stream->position >= stream->length) return 0;
+
+        enum NbtTagType entryType = ReadByte(stream);
+        if(entryType == NBT_END) return 0;
+
+        if(stream->length - stream->position < 2) return 0;
+        unsigned short nameLength = ReadShort(stream);
+        if(stream->length - stream->position < nameLength) return 0;
+
+        const char* name = (const char*)stream->buffer + stream->position;
+        stream->position += nameLength;
+
+        if(nameLength == step->nameLength && memcmp(name, step->name, nameLength) == 0) {
+            *type = entryType;
+            return 1;
+        }
+
+        // Siblings are jumped over without being decoded
+        if(!SkipNbtPayload(stream, entryType)) return 0;
+    }
+}
+
+/// @brief Advances the stream to the payload of a list element
+/// @internal
+/// @returns 1 if the element was found, 0 if it does not exist or the data is invalid
+static int FindNbtListStep(ByteStream* stream, const NbtPathStep* step, enum NbtTagType* type) {
+    if(stream->length - stream->position < 5) return 0;
+
+    enum NbtTagType elementType = ReadByte(stream);
+    int count = ReadInt(stream);
+    if(count < 0 || step->index >= (unsigned int)count) return 0;
+
+    for(unsigned int i = 0; i < step->index; i++) {
+        if(!SkipNbtPayload(stream, elementType)) return 0;
+    }
+
+    *type = elementType;
+    return 1;
+}
+
+/// @brief Runs a compiled path against raw NBT data
+/// @param stream Bytestream positioned at the payload of the root tag, it is left at the payload of the match
+/// @param type Type of the root tag
+/// @param path Compiled path
+/// @param matchType Pointer that will contain the type of the match
+/// @returns 1 if the path matched, 0 if it did not match or the data is invalid
+/// @attention Nothing is decoded or allocated, siblings that do not match are skipped by length arithmetic.
+///            The match can be read using ReadNbtScalar, VisitNbtPayload or the tree decoder.
+int FindNbtPath(ByteStream* stream, enum NbtTagType type, const NbtPath* path, enum NbtTagType* matchType) {
+    if(stream->position > stream->length) return 0;
+
+    for(unsigned int i = 0; i < path->stepCount; i++) {
+        const NbtPathStep* step = &path->steps[i];
+
+        if(step->name != NULL) {
+            if(type != NBT_COMPOUND || !FindNbtCompoundStep(stream, step, &type)) return 0;
+        } else {
+            if(type != NBT_LIST || !FindNbtListStep(stream, step, &type)) return 0;
+        }
+    }
+
+    *matchType = type;
+    return 1;
+}
+
+/// @brief Runs a compiled path against raw NBT data and reads the scalar it matches
+/// @param stream Bytestream positioned at the payload of the root tag, it is not modified
+/// @param type Type of the root tag
+/// @param path Compiled path
+/// @param value Tag that will contain the value
+/// @returns 1 if the path matched a byte, short, int, long, float or double, 0 otherwise
+int QueryNbtScalar(const ByteStream* stream, enum NbtTagType type, const NbtPath* path, NbtTag* value) {
+    ByteStream cursor = *stream;
+
+    enum NbtTagType matchType;
+    if(!FindNbtPath(&cursor, type, path, &matchType)) return 0;
+
+    return ReadNbtScalar(&cursor, matchType, value);
+}
+
+/// @brief Runs a compiled path against raw NBT data and retrieves the string it matches
+/// @param stream Bytestream positioned at the payload of the root tag, it is not modified
+/// @param type Type of the root tag
+/// @param path Compiled path
+/// @param value View that will point to the string inside the buffer of the stream
+/// @returns 1 if the path matched a string, 0 otherwise
+/// @attention The view is not NUL terminated and is only valid for as long as the buffer is
+int QueryNbtString(const ByteStream* stream, enum NbtTagType type, const NbtPath* path, NbtString* value) {
+    ByteStream cursor = *stream;
+
+    enum NbtTagType matchType;
+    if(!FindNbtPath(&cursor, type, path, &matchType) || matchType != NBT_STRING) return 0;
+    if(cursor.length - cursor.position < 2) return 0;
+
+    unsigned short length = ReadShort(&cursor);
+    if(cursor.length - cursor.position < length) return 0;
+
+    value->data = (const char*)cursor.buffer + cursor.position;
+    value->length = length;
+    return 1;
+}
+
+/// @brief Runs a compiled path against a decoded tree
+/// @param tag Root of the tree
+/// @param path Compiled path
+/// @returns Pointer to the matching tag, NULL if the path did not match
+NbtTag* QueryNbtTag(const NbtTag* tag, const NbtPath* path) {
+    NbtTag* current = (NbtTag*)tag;
+
+    for(unsigned int i = 0; i < path->stepCount && current != NULL; i++) {
+        const NbtPathStep* step = &path->steps[i];
+
+        if(step->name != NULL) {
+            current = FindNbtCompoundEntry(current, step->name, step->nameLength, step->hash);
+        } else {
+            current = GetNbtListElement(current, step->index);
+        }
+    }
+
+    return current;
+}
@@ -0,0 +1,290 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "BedrockFormat/format.h"
+
+extern "C" {
+    #include "BedrockFormat/arena.h"
+    #include "BedrockFormat/nbt.h"
+    #include "BedrockFormat/registry.h"
+};
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+    /// @brief Block state together with the bytes it was first serialized as
+    /// @internal
+    struct BlockStateEntry {
+        const NbtTag* state;
+        const unsigned char* serialized;
+        unsigned int length;
+    };
+
+    /// @brief Process wide table of every block state that has been seen, indexed by runtime ID
+    /// @internal
+    /// @attention States are never removed, so a runtime ID and the state it points to stay valid until the process
+    ///            exits. Lookups by ID do not lock, the states are published through the release store of the count.
+    class BlockStateRegistry {
+    public:
+        BlockStateRegistry() {
+            InitArena(&arena, MAX_ARENA_BLOCK_SIZE);
+        }
+
+        ~BlockStateRegistry() {
+            DestroyArena(&arena);
+        }
+
+        Result Intern(ByteStream* stream, unsigned int* runtimeId) {
+            unsigned int start = stream->position;
+            if(!SkipNbtPayload(stream, NBT_COMPOUND)) {
+                fprintf(stderr, "Block state is truncated or invalid\n");
+                return INVALID_DATA;
+            }
+
+            std::string_view serialized(
+                    reinterpret_cast<const char*>(stream->buffer) + start, stream->position - start
+            );
+
+            // Almost every palette entry has been seen before in exactly the same serialized form
+            {
+                std::shared_lock<std::shared_mutex> lock(mutex);
+                auto it = serializedIds.find(serialized);
+                if(it != serializedIds.end()) {
+                    *runtimeId = it->second;
+                    return SUCCESS;
+                }
+            }
+
+            // The state might still be known under a different entry order, so it is decoded and compared
+            Arena scratch;
+            InitArena(&scratch, 3 * serialized.size());
+
+            ByteStream copy;
+            InitByteStream(&copy, stream->buffer + start, static_cast<unsigned int>(serialized.size()));
+            NbtTag* state = DecodeNbtCompound(&copy, &scratch);
+            if(state == nullptr) {
+                fprintf(stderr, "Failed to decode block state\n");
+                DestroyArena(&scratch);
+                return DESERIALIZATION_FAILED;
+            }
+
+            unsigned int hash = HashNbtTag(state);
+
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            Result result = Insert(serialized, state, hash, runtimeId);
+            lock.unlock();
+
+            DestroyArena(&scratch);
+            return result;
+        }
+
+        unsigned int Find(const NbtTag* state) {
+            unsigned int hash = HashNbtTag(state);
+
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            return FindCanonical(state, hash);
+        }
+
+        const BlockStateEntry* Get(unsigned int runtimeId) const {
+            if(runtimeId >= stateCount.load(std::memory_order_acquire)) return nullptr;
+            return &pages[runtimeId / BLOCK_STATE_PAGE_SIZE][runtimeId % BLOCK_STATE_PAGE_SIZE];
+        }
+
+        unsigned int GetCount() const {
+            return stateCount.load(std::memory_order_acquire);
+        }
+
+        size_t GetMemorySize() {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+
+            // Node sizes are estimated, the standard library does not expose them
+            size_t nodeOverhead = 2 * sizeof(void*);
+            return GetArenaMemorySize(&arena)
+                    + serializedIds.bucket_count() * sizeof(void*)
+                    + serializedIds.size() * (sizeof(std::pair<std::string_view, unsigned int>) + nodeOverhead)
+                    + canonicalIds.bucket_count() * sizeof(void*)
+                    + canonicalIds.size() * (sizeof(std::pair<unsigned int, unsigned int>) + nodeOverhead);
+        }
+
+    private:
+        /// @attention The caller has to hold a lock
+        unsigned int FindCanonical(const NbtTag* state, unsigned int hash) {
+            auto range = canonicalIds.equal_range(hash);
+            for(auto it = range.first; it != range.second; ++it) {
+                if(CompareNbtTags(Get(it->second)->state, state)) return it->second;
+            }
+
+            return INVALID_BLOCK_STATE_ID;
+        }
+
+        /// @attention The caller has to hold the exclusive lock
+        Result Insert(std::string_view serialized, const NbtTag* state, unsigned int hash, unsigned int* runtimeId) {
+            // Another thread might have interned the same bytes in the meantime
+            auto it = serializedIds.find(serialized);
+            if(it != serializedIds.end()) {
+                *runtimeId = it->second;
+                return SUCCESS;
+            }
+
+            // Remember the serialized form, so the next palette entry with the same bytes is found without decoding
+            char* key = static_cast<char*>(AllocateFromArena(&arena, serialized.size()));
+            if(key == nullptr) {
+                fprintf(stderr, "Failed to allocate %zu bytes for a block state key\n", serialized.size());
+                return ALLOCATION_FAILED;
+            }
+            memcpy(key, serialized.data(), serialized.size());
+            std::string_view stored(key, serialized.size());
+
+            unsigned int id = FindCanonical(state, hash);
+            if(id == INVALID_BLOCK_STATE_ID) {
+                Result result = Add(stored, hash, &id);
+                if(BF_FAILED(result)) return result;
+            }
+            serializedIds.emplace(stored, id);
+
+            *runtimeId = id;
+            return SUCCESS;
+        }
+
+        /// @attention The caller has to hold the exclusive lock
+        /// @attention The serialized bytes have to be owned by the arena, they are used to encode the state again
+        Result Add(std::string_view serialized, unsigned int hash, unsigned int* runtimeId) {
+            unsigned int id = stateCount.load(std::memory_order_relaxed);
+            if(id == BLOCK_STATE_PAGE_SIZE * MAX_BLOCK_STATE_PAGES) {
+                fprintf(stderr, "Block state registry is full\n");
+                return ALLOCATION_FAILED;
+            }
+
+            if(id % BLOCK_STATE_PAGE_SIZE == 0) {
+                pages[id / BLOCK_STATE_PAGE_SIZE] = static_cast<BlockStateEntry*>(
+                        AllocateFromArena(&arena, BLOCK_STATE_PAGE_SIZE * sizeof(BlockStateEntry))
+                );
+                if(pages[id / BLOCK_STATE_PAGE_SIZE] == nullptr) {
+                    fprintf(stderr, "Failed to allocate block state page\n");
+                    return ALLOCATION_FAILED;
+                }
+            }
+
+            // The registry keeps its own copy, the state of the caller lives in a scratch arena
+            ByteStream stream;
+            InitByteStream(
+                    &stream, reinterpret_cast<const unsigned char*>(serialized.data()),
+                    static_cast<unsigned int>(serialized.size())
+            );
+            const NbtTag* state = DecodeNbtCompound(&stream, &arena);
+            if(state == nullptr) {
+                fprintf(stderr, "Failed to decode block state\n");
+                return DESERIALIZATION_FAILED;
+            }
+
+            BlockStateEntry& entry = pages[id / BLOCK_STATE_PAGE_SIZE][id % BLOCK_STATE_PAGE_SIZE];
+            entry.state = state;
+            entry.serialized = reinterpret_cast<const unsigned char*>(serialized.data());
+            entry.length = static_cast<unsigned int>(serialized.size());
+            canonicalIds.emplace(hash, id);
+            stateCount.store(id + 1, std::memory_order_release);
+
+            *runtimeId = id;
+            return SUCCESS;
+        }
+
+        std::shared_mutex mutex;
+        Arena arena; // Owns the states, their pages and the serialized keys
+        std::unordered_map<std::string_view, unsigned int> serializedIds;
+        std::unordered_multimap<unsigned int, unsigned int> canonicalIds; // Structural hash to runtime ID
+        BlockStateEntry* pages[MAX_BLOCK_STATE_PAGES] = {};
+        std::atomic<unsigned int> stateCount{0};
+    };
+
+    /// @internal
+    BlockStateRegistry& GetRegistry() {
+        static BlockStateRegistry registry;
+        return registry;
+    }
+}
+
+/// @brief Looks up the runtime ID of a serialized block state, registering the state when it is new
+/// @param stream Bytestream positioned at the payload of the block state compound, it is moved behind the payload
+/// @param runtimeId Pointer to an integer that will contain the runtime ID of the state
+/// @returns Result
+/// @attention States are canonicalized by their structure, so the same state always has the same runtime ID,
+///            regardless of the order its entries were serialized in. This function can be called from any thread.
+Result InternBlockState(ByteStream* stream, unsigned int* runtimeId) {
+    return GetRegistry().Intern(stream, runtimeId);
+}
+
+/// @brief Looks up the runtime ID of a block state without registering it
+/// @param state Block state compound, usually containing a name, states and version
+/// @returns Runtime ID, INVALID_BLOCK_STATE_ID if the state has never been seen
+unsigned int FindBlockStateId(const NbtTag* state) {
+    return GetRegistry().Find(state);
+}
+
+/// @brief Retrieves the block state a runtime ID refers to
+/// @param runtimeId Runtime ID of the state
+/// @returns Pointer to the shared state, NULL if the runtime ID is invalid
+/// @attention The state is shared by every subchunk and must not be modified or freed
+const NbtTag* GetBlockState(unsigned int runtimeId) {
+    const BlockStateEntry* entry = GetRegistry().Get(runtimeId);
+    return entry != nullptr ? entry->state : nullptr;
+}
+
+/// @brief Retrieves the serialized form of a block state, as it is stored in a palette
+/// @param runtimeId Runtime ID of the state
+/// @param data Pointer that will point to the payload of the block state compound
+/// @param length Pointer to an integer that will contain the length of the payload
+/// @returns Result, INVALID_ARGUMENT if the runtime ID is invalid
+/// @attention The bytes are the ones the state was first interned from. They are shared and must not be modified.
+Result GetSerializedBlockState(unsigned int runtimeId, const unsigned char** data, unsigned int* length) {
+    const BlockStateEntry* entry = GetRegistry().Get(runtimeId);
+    if(entry == nullptr) {
+        return INVALID_ARGUMENT;
+    }
+
+    *data = entry->serialized;
+    *length = entry->length;
+    return SUCCESS;
+}
+
+/// @brief Retrieves the amount of block states in the registry, runtime IDs are dense and lower than this value
+/// @returns Amount of block states
+unsigned int GetBlockStateCount(void) {
+    return GetRegistry().GetCount();
+}
+
+/// @brief Calculates how much heap memory the block state registry occupies
+/// @returns Size in bytes
+size_t GetBlockStateRegistryMemorySize(void) {
+    return GetRegistry().GetMemorySize();
+}
+
+/// @brief Block state predicate that matches every state of a block
+/// @param name Name of the block as a NUL terminated string, for example "minecraft:diamond_ore"
+/// @param runtimeId Runtime ID of the block state
+/// @param state Block state to be checked
+/// @returns 1 if the name of the state is equal to the given name, 0 otherwise
+int MatchBlockStateName(void* name, unsigned int runtimeId, const NbtTag* state) {
+    BF_UNUSED(runtimeId);
+
+    NbtTag* stateName = GetNbtCompoundEntry(state, "name");
+    if(stateName == nullptr || stateName->type != NBT_STRING) return 0;
+
+    NbtString value = GetNbtString(stateName);
+    return strlen((const char*)name) == value.length && memcmp(value.data, name, value.length) == 0;
+}
@@ -0,0 +1,324 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "BedrockFormat/format.h"
+
+extern "C" {
+    #include "BedrockFormat/binary.h"
+    #include "BedrockFormat/chunk.h"
+    #include "BedrockFormat/nbt.h"
+    #include "BedrockFormat/registry.h"
+    #include "BedrockFormat/search.h"
+    #include "BedrockFormat/storage.h"
+};
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    /// @brief Scratch memory of a single worker
+    /// @internal
+    struct SearchScratch {
+        unsigned int ids[SUBCHUNK_BLOCK_COUNT];
+        unsigned char matched[SUBCHUNK_BLOCK_COUNT];
+        unsigned short indices[SUBCHUNK_BLOCK_COUNT];
+        unsigned short positions[SUBCHUNK_BLOCK_COUNT];
+        std::vector<signed char> memo; // Predicate result per runtime ID, -1 if it has not been evaluated yet
+        std::vector<BlockMatch> found;
+    };
+
+    /// @brief Scans every subchunk of a dimension on the worker threads of the world
+    /// @internal
+    /// @attention The key space is split into 256 ranges by the first key byte, workers take the next range once they
+    ///            are done with their current one. Workers only read the database and the block state registry. Matches
+    ///            are handed to the callback on the calling thread in batches.
+    class BlockSearch {
+    public:
+        BlockSearch(
+                World* world, Dimension dimension, BlockStatePredicate predicate, void* predicateData,
+                const PipelineOptions& options
+        ) : world(world), dimension(dimension), predicate(predicate), predicateData(predicateData),
+            queueDepth(std::max(options.queueDepth, 1u)), threadCount(options.threadCount) {
+            if(threadCount == 0) threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        Result Run(BlockMatchCallback callback, void* userData) {
+            SubmitPipelineTasks(world, threadCount, &BlockSearch::RunWorker, this);
+
+            std::unique_lock<std::mutex> lock(mutex);
+            for(;;) {
+                batchAvailable.wait(lock, [this] { return !batches.empty() || finishedWorkers == threadCount; });
+                if(batches.empty()) break;
+
+                std::vector<BlockMatch> batch = std::move(batches.front());
+                batches.pop_front();
+                lock.unlock();
+                spaceAvailable.notify_all();
+
+                bool keepGoing = stopping || callback(userData, batch.data(), batch.size());
+
+                lock.lock();
+                if(!keepGoing) {
+                    // Set while holding the lock, so a worker that is about to wait for space does not miss it
+                    stopping = true;
+                    spaceAvailable.notify_all();
+                }
+            }
+
+            // Every worker has finished, the search no longer runs on the threads of the world
+            return firstError;
+        }
+
+    private:
+        /// @brief Checks if the key belongs to a subchunk of the searched dimension and extracts its position
+        bool ParseKey(const unsigned char* key, unsigned int keyLength, int* x, int* y, int* z) const {
+            unsigned char yByte;
+            Dimension keyDimension;
+            if(!ParseSubchunkKey(key, keyLength, x, &yByte, z, &keyDimension) || keyDimension != dimension) {
+                return false;
+            }
+
+            *y = (signed char)yByte;
+            return true;
+        }
+
+        /// @brief Evaluates the predicate for a runtime ID, every state is only evaluated once per worker
+        bool Matches(SearchScratch& scratch, unsigned int runtimeId) {
+            if(runtimeId >= scratch.memo.size()) {
+                scratch.memo.resize(std::max<size_t>(runtimeId + 1u, GetBlockStateCount()), -1);
+            }
+
+            if(scratch.memo[runtimeId] < 0) {
+                // The predicate is never called concurrently, so it does not have to be thread safe
+                std::lock_guard<std::mutex> lock(predicateMutex);
+                scratch.memo[runtimeId] = (signed char)(predicate(predicateData, runtimeId, GetBlockState(runtimeId)) ? 1 : 0);
+            }
+
+            return scratch.memo[runtimeId] != 0;
+        }
+
+        /// @brief Adds the blocks at the given storage positions to the matches of the worker
+        static void AddMatches(
+                SearchScratch& scratch, const unsigned short* positions, unsigned int count,
+                const unsigned int* palette, const unsigned short* indices, int x, int y, int z, unsigned char layer
+        ) {
+            for(unsigned int i = 0; i < count; i++) {
+                unsigned int block = positions[i];
+
+                BlockMatch match;
+                match.x = x * 16 + (int)(block >> 8);
+                match.y = y * 16 + (int)(block & 15);
+                match.z = z * 16 + (int)((block >> 4) & 15);
+                match.runtimeId = palette[indices != nullptr ? indices[block] : 0];
+                match.layer = layer;
+                scratch.found.push_back(match);
+            }
+        }
+
+        /// @brief Searches every layer of a subchunk value, indices are only unpacked when the palette has a match
+        Result SearchSubchunk(SearchScratch& scratch, const unsigned char* data, unsigned int length, int x, int y, int z) {
+            ByteStream stream;
+            InitByteStream(&stream, data, length);
+            if(length < 3) return INVALID_DATA;
+
+            unsigned char version = ReadByte(&stream);
+            unsigned char layerCount = 1;
+            if(version == 8 || version == 9) {
+                layerCount = ReadByte(&stream);
+                if(version == 9) stream.position++;
+            } else if(version != 1) {
+                return INVALID_DATA;
+            }
+
+            for(unsigned char layer = 0; layer < layerCount; layer++) {
+                unsigned char bitsPerBlock;
+                const unsigned char* words;
+                unsigned int paletteSize;
+                Result result = ReadBlockStorageHeader(&stream, &bitsPerBlock, &words, &paletteSize);
+                if(BF_FAILED(result)) return result;
+
+                unsigned int matchedCount = 0;
+                unsigned short lastMatched = 0;
+                for(unsigned int j = 0; j < paletteSize; j++) {
+                    if(stream.length - stream.position < 3) return INVALID_DATA;
+                    stream.position += 3; // Skip tag type and name
+
+                    result = InternBlockState(&stream, &scratch.ids[j]);
+                    if(BF_FAILED(result)) return result;
+
+                    scratch.matched[j] = Matches(scratch, scratch.ids[j]);
+                    if(scratch.matched[j]) {
+                        matchedCount++;
+                        lastMatched = (unsigned short)j;
+                    }
+                }
+
+                // Most subchunks do not contain the block at all, their indices are never unpacked
+                if(matchedCount == 0) continue;
+
+                if(bitsPerBlock == 0) {
+                    if(!scratch.matched[0]) continue;
+
+                    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i++) {
+                        scratch.positions[i] = (unsigned short)i;
+                    }
+                    AddMatches(scratch, scratch.positions, SUBCHUNK_BLOCK_COUNT, scratch.ids, nullptr, x, y, z, layer);
+                    continue;
+                }
+
+                UnpackBlockIndices(words, bitsPerBlock, scratch.indices);
+
+                // Rejected the same way DecodeSubchunk rejects it, so both agree on which subchunks exist
+                unsigned short maxIndex = 0;
+                for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i++) {
+                    maxIndex = std::max(maxIndex, scratch.indices[i]);
+                }
+                if(maxIndex >= paletteSize) return INVALID_DATA;
+
+                unsigned int count = 0;
+                if(matchedCount == 1) {
+                    count = FindBlockIndex(scratch.indices, lastMatched, scratch.positions);
+                } else {
+                    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i++) {
+                        if(scratch.matched[scratch.indices[i]]) scratch.positions[count++] = (unsigned short)i;
+                    }
+                }
+                AddMatches(scratch, scratch.positions, count, scratch.ids, scratch.indices, x, y, z, layer);
+            }
+
+            return SUCCESS;
+        }
+
+        /// @brief Hands the matches of a worker to the calling thread, waiting while too many batches are queued
+        void Publish(std::vector<BlockMatch>& found) {
+            if(found.empty()) return;
+
+            std::unique_lock<std::mutex> lock(mutex);
+            spaceAvailable.wait(lock, [this] { return stopping || batches.size() < queueDepth; });
+            if(!stopping) {
+                batches.push_back(std::move(found));
+                lock.unlock();
+                batchAvailable.notify_one();
+            }
+            found.clear();
+        }
+
+        void RecordError(Result result) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(!BF_FAILED(firstError)) firstError = result;
+        }
+
+        /// @brief Runs the worker loop of a search on a thread of the world
+        static void RunWorker(void* data) {
+            static_cast<BlockSearch*>(data)->Work();
+        }
+
+        /// @brief Worker loop, returns once every key range has been searched
+        void Work() {
+            SearchScratch* scratch = new SearchScratch();
+
+            // Every worker keeps its own iterator, they are not thread safe
+            EntryIterator iterator;
+            Result result = OpenEntryIterator(world, &iterator);
+            if(BF_FAILED(result)) {
+                RecordError(result);
+            } else {
+                for(unsigned int prefix = nextPrefix++; prefix < 256 && !stopping; prefix = nextPrefix++) {
+                    unsigned char key = (unsigned char)prefix;
+
+                    int valid = SeekEntryIterator(&iterator, &key, 1);
+                    for(; valid && !stopping; valid = NextEntryIterator(&iterator)) {
+                        if(iterator.keyLength == 0 || iterator.key[0] != key) break;
+
+                        int x, y, z;
+                        if(!ParseKey(iterator.key, iterator.keyLength, &x, &y, &z)) continue;
+
+                        // A single corrupt subchunk should not stop the search, but none of its matches are reported
+                        size_t previousCount = scratch->found.size();
+                        result = SearchSubchunk(*scratch, iterator.data, iterator.length, x, y, z);
+                        if(BF_FAILED(result)) {
+                            scratch->found.resize(previousCount);
+                            RecordError(result);
+                        }
+
+                        if(scratch->found.size() >= SEARCH_MATCH_BATCH_SIZE) Publish(scratch->found);
+                    }
+                }
+
+                Publish(scratch->found);
+
+                result = CloseEntryIterator(&iterator);
+                if(BF_FAILED(result)) RecordError(result);
+            }
+
+            delete scratch;
+
+            // Notified while locked, the search can be destroyed as soon as the lock is released
+            std::lock_guard<std::mutex> lock(mutex);
+            finishedWorkers++;
+            batchAvailable.notify_one();
+        }
+
+        World* world;
+        Dimension dimension;
+        BlockStatePredicate predicate;
+        void* predicateData;
+        unsigned int queueDepth;
+        unsigned int threadCount;
+
+        std::mutex mutex;
+        std::mutex predicateMutex;
+        std::condition_variable batchAvailable;
+        std::condition_variable spaceAvailable;
+        std::deque<std::vector<BlockMatch>> batches;
+        unsigned int finishedWorkers = 0;
+        Result firstError = SUCCESS;
+
+        std::atomic<unsigned int> nextPrefix{0};
+        std::atomic<bool> stopping{false};
+    };
+}
+
+/// @brief Finds every block of a dimension that matches a predicate
+/// @param world World to be searched
+/// @param dimension Dimension to be searched
+/// @param predicate Function that decides if a block state matches, it is called once per state and worker
+/// @param predicateData Pointer that is passed to the predicate
+/// @param options Thread count of the search and the amount of match batches that can be queued, NULL uses the defaults
+/// @param callback Function that receives the matches in batches, returning 0 stops the search
+/// @param userData Pointer that is passed to the callback
+/// @returns Result
+/// @attention Subchunks are read straight from the database and do not go through the chunk cache. Only the palette
+///            of a subchunk is looked at first, its indices are only unpacked when a palette entry matches. Every
+///            layer is searched. The callback runs on the calling thread, the predicate runs on the workers but never
+///            concurrently. Subchunks that fail to decode are skipped and the first error is returned at the end.
+Result SearchBlocks(
+        World* world, Dimension dimension, BlockStatePredicate predicate, void* predicateData,
+        const PipelineOptions* options, BlockMatchCallback callback, void* userData
+) {
+    PipelineOptions defaultOptions;
+    if(options == nullptr) {
+        InitPipelineOptions(&defaultOptions);
+        options = &defaultOptions;
+    }
+
+    BlockSearch search(world, dimension, predicate, predicateData, *options);
+    return search.Run(callback, userData);
+}
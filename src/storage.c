@@ -0,0 +1,526 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "BedrockFormat/storage.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(BEDROCK_FORMAT_AVX2)
+#include <immintrin.h>
+#elif defined(BEDROCK_FORMAT_SSE2)
+#include <emmintrin.h>
+#endif
+
+/// @brief Checks whether a block storage can use the given amount of bits per block
+/// @param bitsPerBlock Amount of bits used by every block index
+/// @returns 1 if the width is used by Bedrock, 0 otherwise
+int IsValidBitsPerBlock(unsigned char bitsPerBlock) {
+    switch(bitsPerBlock) {
+        case 0:
+        case 1:
+        case 2:
+        case 3:
+        case 4:
+        case 5:
+        case 6:
+        case 8:
+        case 16:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/// @brief Finds the smallest width Bedrock uses that can index every entry of a palette
+/// @param paletteSize Amount of entries in the palette
+/// @returns Amount of bits per block, 0 if the palette has a single entry
+unsigned char GetMinimalBitsPerBlock(unsigned int paletteSize) {
+    static const unsigned char widths[] = { 1, 2, 3, 4, 5, 6, 8, 16 };
+
+    if(paletteSize <= 1) return 0;
+    for(unsigned int i = 0; i < sizeof(widths) - 1; i++) {
+        if(paletteSize <= 1u << widths[i]) return widths[i];
+    }
+    return 16;
+}
+
+/// @brief Calculates how many words a block storage with the given width occupies
+/// @param bitsPerBlock Amount of bits used by every block index
+/// @returns Amount of 32-bit words
+/// @attention Blocks never span two words, widths that do not divide 32 leave the upper bits of every word unused
+unsigned int GetBlockStorageWordCount(unsigned char bitsPerBlock) {
+    if(bitsPerBlock == 0) return 0;
+
+    unsigned int blocksPerWord = 32 / bitsPerBlock;
+    return (SUBCHUNK_BLOCK_COUNT + blocksPerWord - 1) / blocksPerWord;
+}
+
+/// @brief Defines a scalar unpacking kernel for a single width
+/// @internal
+/// @attention The width is a constant inside every kernel, so the compiler unrolls the inner loop
+///            and folds the shifts and masks
+#define DEFINE_SCALAR_UNPACK_KERNEL(bits)                                                   \
+    static void UnpackScalar##bits(const unsigned char* words, unsigned short* blocks) {    \
+        const unsigned int blocksPerWord = 32 / (bits);                                     \
+        const unsigned int mask = (1u << (bits)) - 1;                                       \
+                                                                                            \
+        unsigned int i = 0;                                                                 \
+        for(; i + blocksPerWord <= SUBCHUNK_BLOCK_COUNT; i += blocksPerWord, words += 4) {  \
+            unsigned int word = LoadBlockStorageWord(words);                                \
+            for(unsigned int j = 0; j < blocksPerWord; j++) {                               \
+                blocks[i + j] = (unsigned short)(word & mask);                              \
+                word >>= (bits);                                                             \
+            }                                                                               \
+        }                                                                                   \
+                                                                                            \
+        if(i < SUBCHUNK_BLOCK_COUNT) {                                                      \
+            unsigned int word = LoadBlockStorageWord(words);                                \
+            for(; i < SUBCHUNK_BLOCK_COUNT; i++) {                                          \
+                blocks[i] = (unsigned short)(word & mask);                                  \
+                word >>= (bits);                                                             \
+            }                                                                               \
+        }                                                                                   \
+    }
+
+DEFINE_SCALAR_UNPACK_KERNEL(1)
+DEFINE_SCALAR_UNPACK_KERNEL(2)
+DEFINE_SCALAR_UNPACK_KERNEL(3)
+DEFINE_SCALAR_UNPACK_KERNEL(4)
+DEFINE_SCALAR_UNPACK_KERNEL(5)
+DEFINE_SCALAR_UNPACK_KERNEL(6)
+DEFINE_SCALAR_UNPACK_KERNEL(8)
+DEFINE_SCALAR_UNPACK_KERNEL(16)
+
+#if defined(BEDROCK_FORMAT_SSE2)
+/// @brief Widens 16 byte sized indices to shorts and stores them
+/// @internal
+static inline void StoreWidened(unsigned short* blocks, __m128i indices) {
+    const __m128i zero = _mm_setzero_si128();
+
+    _mm_storeu_si128((__m128i*)blocks, _mm_unpacklo_epi8(indices, zero));
+    _mm_storeu_si128((__m128i*)(blocks + 8), _mm_unpackhi_epi8(indices, zero));
+}
+
+/// @brief Unpacks 1 bit indices, every byte is spread over 8 lanes and tested against its bit
+/// @internal
+static void UnpackSimd1(const unsigned char* words, unsigned short* blocks) {
+    const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m128i ones = _mm_set1_epi8(1);
+
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i += 16, words += 2) {
+        __m128i v = _mm_cvtsi32_si128(words[0] | words[1] << 8);
+        v = _mm_unpacklo_epi8(v, v);
+        v = _mm_unpacklo_epi16(v, v);
+        v = _mm_unpacklo_epi32(v, v);
+        v = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(v, bits), bits), ones);
+
+        StoreWidened(blocks + i, v);
+    }
+}
+
+/// @brief Unpacks 2 bit indices by splitting every byte into four planes and interleaving them again
+/// @internal
+static void UnpackSimd2(const unsigned char* words, unsigned short* blocks) {
+    const __m128i mask = _mm_set1_epi8(0x03);
+
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i += 16, words += 4) {
+        __m128i v = _mm_cvtsi32_si128((int)LoadBlockStorageWord(words));
+        __m128i p0 = _mm_and_si128(v, mask);
+        __m128i p1 = _mm_and_si128(_mm_srli_epi16(v, 2), mask);
+        __m128i p2 = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+        __m128i p3 = _mm_and_si128(_mm_srli_epi16(v, 6), mask);
+
+        StoreWidened(blocks + i, _mm_unpacklo_epi16(_mm_unpacklo_epi8(p0, p1), _mm_unpacklo_epi8(p2, p3)));
+    }
+}
+
+/// @brief Unpacks 4 bit indices by splitting every byte into its low and high nibble
+/// @internal
+static void UnpackSimd4(const unsigned char* words, unsigned short* blocks) {
+    const __m128i mask = _mm_set1_epi8(0x0F);
+
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i += 16, words += 8) {
+        __m128i v = _mm_loadl_epi64((const __m128i*)words);
+
+        StoreWidened(blocks + i, _mm_unpacklo_epi8(_mm_and_si128(v, mask), _mm_and_si128(_mm_srli_epi16(v, 4), mask)));
+    }
+}
+
+/// @brief Unpacks 8 bit indices, every byte is a single index
+/// @internal
+static void UnpackSimd8(const unsigned char* words, unsigned short* blocks) {
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i += 16, words += 16) {
+        StoreWidened(blocks + i, _mm_loadu_si128((const __m128i*)words));
+    }
+}
+
+/// @brief Unpacks 16 bit indices, the little endian words already contain the indices in order
+/// @internal
+static void UnpackSimd16(const unsigned char* words, unsigned short* blocks) {
+    memcpy(blocks, words, SUBCHUNK_BLOCK_COUNT * sizeof(unsigned short));
+}
+#endif
+
+#if defined(BEDROCK_FORMAT_AVX2)
+/// @brief Defines an AVX2 unpacking kernel for widths that do not divide 32
+/// @internal
+/// @attention Every word is broadcast and shifted by a different amount per lane. Each group of 8 lanes is
+///            stored at once, so the last lanes of a word are overwritten by the next word. The final words
+///            are handled by the scalar loop to stay within the 4096 blocks.
+#define DEFINE_AVX2_UNPACK_KERNEL(bits)                                                                     \
+    static void UnpackSimd##bits(const unsigned char* words, unsigned short* blocks) {                      \
+        const unsigned int blocksPerWord = 32 / (bits);                                                     \
+        const unsigned int mask = (1u << (bits)) - 1;                                                       \
+        const __m256i laneMask = _mm256_set1_epi32((int)mask);                                              \
+        const __m256i low = _mm256_setr_epi32(0, (bits), 2 * (bits), 3 * (bits),                            \
+                                              4 * (bits), 5 * (bits), 6 * (bits), 7 * (bits));              \
+        const __m256i high = _mm256_add_epi32(low, _mm256_set1_epi32(8 * (bits)));                          \
+                                                                                                            \
+        unsigned int i = 0;                                                                                 \
+        for(; i + 16 <= SUBCHUNK_BLOCK_COUNT; i += blocksPerWord, words += 4) {                             \
+            __m256i word = _mm256_set1_epi32((int)LoadBlockStorageWord(words));                             \
+            __m256i first = _mm256_and_si256(_mm256_srlv_epi32(word, low), laneMask);                       \
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(first, first), 0x08);             \
+            _mm_storeu_si128((__m128i*)(blocks + i), _mm256_castsi256_si128(packed));                       \
+            if(blocksPerWord > 8) {                                                                         \
+                __m256i second = _mm256_and_si256(_mm256_srlv_epi32(word, high), laneMask);                 \
+                packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(second, second), 0x08);               \
+                _mm_storeu_si128((__m128i*)(blocks + i + 8), _mm256_castsi256_si128(packed));               \
+            }                                                                                               \
+        }                                                                                                   \
+                                                                                                            \
+        for(; i < SUBCHUNK_BLOCK_COUNT; words += 4) {                                                       \
+            unsigned int word = LoadBlockStorageWord(words);                                                \
+            for(unsigned int j = 0; j < blocksPerWord && i < SUBCHUNK_BLOCK_COUNT; i++, j++) {              \
+                blocks[i] = (unsigned short)((word >> (j * (bits))) & mask);                                \
+            }                                                                                               \
+        }                                                                                                   \
+    }
+
+DEFINE_AVX2_UNPACK_KERNEL(3)
+DEFINE_AVX2_UNPACK_KERNEL(5)
+DEFINE_AVX2_UNPACK_KERNEL(6)
+#endif
+
+/// @brief Unpacks the block indices of a block storage
+/// @param words Packed little endian words, at least GetBlockStorageWordCount(bitsPerBlock) * 4 bytes
+/// @param bitsPerBlock Amount of bits used by every block index
+/// @param blocks Array of 4096 indices to write the unpacked indices into, in XZY order
+/// @returns Result
+Result UnpackBlockIndices(const unsigned char* words, unsigned char bitsPerBlock, unsigned short* blocks) {
+    switch(bitsPerBlock) {
+        case 0:
+            memset(blocks, 0, SUBCHUNK_BLOCK_COUNT * sizeof(unsigned short));
+            return SUCCESS;
+#if defined(BEDROCK_FORMAT_SSE2)
+        case 1:
+            UnpackSimd1(words, blocks);
+            return SUCCESS;
+        case 2:
+            UnpackSimd2(words, blocks);
+            return SUCCESS;
+        case 4:
+            UnpackSimd4(words, blocks);
+            return SUCCESS;
+        case 8:
+            UnpackSimd8(words, blocks);
+            return SUCCESS;
+        case 16:
+            UnpackSimd16(words, blocks);
+            return SUCCESS;
+#else
+        case 1:
+            UnpackScalar1(words, blocks);
+            return SUCCESS;
+        case 2:
+            UnpackScalar2(words, blocks);
+            return SUCCESS;
+        case 4:
+            UnpackScalar4(words, blocks);
+            return SUCCESS;
+        case 8:
+            UnpackScalar8(words, blocks);
+            return SUCCESS;
+        case 16:
+            UnpackScalar16(words, blocks);
+            return SUCCESS;
+#endif
+#if defined(BEDROCK_FORMAT_AVX2)
+        case 3:
+            UnpackSimd3(words, blocks);
+            return SUCCESS;
+        case 5:
+            UnpackSimd5(words, blocks);
+            return SUCCESS;
+        case 6:
+            UnpackSimd6(words, blocks);
+            return SUCCESS;
+#else
+        case 3:
+            UnpackScalar3(words, blocks);
+            return SUCCESS;
+        case 5:
+            UnpackScalar5(words, blocks);
+            return SUCCESS;
+        case 6:
+            UnpackScalar6(words, blocks);
+            return SUCCESS;
+#endif
+        default:
+            fprintf(stderr, "Block storage has an invalid width of %i bits per block\n", bitsPerBlock);
+            return INVALID_DATA;
+    }
+}
+
+/// @brief Packs block indices of any width one word at a time
+/// @internal
+static void PackScalar(const unsigned short* blocks, unsigned char bitsPerBlock, unsigned char* words) {
+    unsigned int blocksPerWord = 32 / bitsPerBlock;
+    unsigned int i = 0;
+    for(unsigned int w = 0; w < GetBlockStorageWordCount(bitsPerBlock); w++, words += 4) {
+        unsigned int word = 0;
+        for(unsigned int j = 0; j < blocksPerWord && i < SUBCHUNK_BLOCK_COUNT; j++, i++) {
+            word |= (unsigned int)blocks[i] << (j * bitsPerBlock);
+        }
+
+        StoreBlockStorageWord(words, word);
+    }
+}
+
+#if defined(BEDROCK_FORMAT_SSE2)
+/// @brief Narrows 16 short sized indices to bytes
+/// @internal
+static inline __m128i LoadNarrowed(const unsigned short* blocks) {
+    return _mm_packus_epi16(
+            _mm_loadu_si128((const __m128i*)blocks), _mm_loadu_si128((const __m128i*)(blocks + 8))
+    );
+}
+
+/// @brief Merges the two nibbles of every pair of bytes into the low byte of their short
+/// @internal
+static inline __m128i MergeNibbles(__m128i v) {
+    return _mm_and_si128(_mm_or_si128(v, _mm_srli_epi16(v, 4)), _mm_set1_epi16(0x00FF));
+}
+
+/// @brief Packs 1 bit indices, the lowest bit of every index ends up in the sign bit and is gathered by movemask
+/// @internal
+static void PackSimd1(const unsigned short* blocks, unsigned char* words) {
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i += 16, words += 2) {
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_slli_epi16(LoadNarrowed(blocks + i), 7));
+        words[0] = (unsigned char)mask;
+        words[1] = (unsigned char)(mask >> 8);
+    }
+}
+
+/// @brief Packs 2 bit indices by merging neighboring indices into nibbles and the nibbles into bytes
+/// @internal
+static void PackSimd2(const unsigned short* blocks, unsigned char* words) {
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i += 16, words += 4) {
+        __m128i v = LoadNarrowed(blocks + i);
+        v = _mm_and_si128(_mm_or_si128(v, _mm_srli_epi16(v, 6)), _mm_set1_epi16(0x000F));
+        v = MergeNibbles(_mm_packus_epi16(v, v));
+        StoreBlockStorageWord(words, (unsigned int)_mm_cvtsi128_si32(_mm_packus_epi16(v, v)));
+    }
+}
+
+/// @brief Packs 4 bit indices by merging every pair of indices into a byte
+/// @internal
+static void PackSimd4(const unsigned short* blocks, unsigned char* words) {
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i += 16, words += 8) {
+        __m128i v = MergeNibbles(LoadNarrowed(blocks + i));
+        _mm_storel_epi64((__m128i*)words, _mm_packus_epi16(v, v));
+    }
+}
+
+/// @brief Packs 8 bit indices, every index becomes a single byte
+/// @internal
+static void PackSimd8(const unsigned short* blocks, unsigned char* words) {
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i += 16, words += 16) {
+        _mm_storeu_si128((__m128i*)words, LoadNarrowed(blocks + i));
+    }
+}
+#endif
+
+/// @brief Packs block indices into words in the layout Bedrock uses
+/// @param blocks Array of 4096 indices in XZY order, every index has to fit into bitsPerBlock bits
+/// @param bitsPerBlock Amount of bits used by every block index
+/// @param words Buffer of at least GetBlockStorageWordCount(bitsPerBlock) * 4 bytes to write the words into
+/// @attention Widths that divide 32 are packed 16 indices at a time when SSE2 is available
+void PackBlockIndices(const unsigned short* blocks, unsigned char bitsPerBlock, unsigned char* words) {
+    switch(bitsPerBlock) {
+        case 0:
+            return;
+#if defined(BEDROCK_FORMAT_SSE2)
+        case 1:
+            PackSimd1(blocks, words);
+            return;
+        case 2:
+            PackSimd2(blocks, words);
+            return;
+        case 4:
+            PackSimd4(blocks, words);
+            return;
+        case 8:
+            PackSimd8(blocks, words);
+            return;
+#endif
+        case 16:
+            // The little endian words contain the indices in order
+            for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i++) {
+                words[2 * i] = (unsigned char)blocks[i];
+                words[2 * i + 1] = (unsigned char)(blocks[i] >> 8);
+            }
+            return;
+        default:
+            PackScalar(blocks, bitsPerBlock, words);
+            return;
+    }
+}
+
+/// @brief Unpacks the palette indices of every block of a decoded block storage
+/// @param storage Block storage to be expanded
+/// @param blocks Array of 4096 indices to write the indices into, in XZY order
+/// @attention Use this when most blocks of a storage are needed, GetBlockStorageIndex is cheaper for a few of them
+void ExpandBlockStorage(const BlockStorage* storage, unsigned short* blocks) {
+    // The width has been validated when the storage was decoded
+    UnpackBlockIndices(storage->words, storage->bitsPerBlock, blocks);
+}
+
+/// @brief Drops the palette entries no block uses and renumbers the indices of the remaining ones
+/// @param blocks Array of 4096 indices in XZY order, they are rewritten in place
+/// @param palette Palette the indices refer to, it is compacted in place
+/// @param paletteSize Amount of entries in the palette, every index in blocks has to be smaller
+/// @returns Amount of entries left in the palette, their order is kept
+unsigned int CompactBlockIndices(unsigned short* blocks, unsigned int* palette, unsigned int paletteSize) {
+    unsigned short remap[SUBCHUNK_BLOCK_COUNT];
+    unsigned char used[SUBCHUNK_BLOCK_COUNT];
+    memset(used, 0, paletteSize);
+
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i++) {
+        used[blocks[i]] = 1;
+    }
+
+    unsigned int usedCount = 0;
+    for(unsigned int i = 0; i < paletteSize; i++) {
+        if(!used[i]) continue;
+        remap[i] = (unsigned short)usedCount;
+        palette[usedCount++] = palette[i];
+    }
+
+    if(usedCount != paletteSize) {
+        for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i++) {
+            blocks[i] = remap[blocks[i]];
+        }
+    }
+
+    return usedCount;
+}
+
+/// @brief Finds every block that uses a given palette index
+/// @param blocks Array of 4096 indices in XZY order
+/// @param index Palette index to search for
+/// @param matches Array of at least 4096 entries the positions of the matching blocks are written into, in XZY order
+/// @returns Amount of matching blocks
+/// @attention Eight indices are compared at once when SSE2 is available, groups without a match are skipped as a whole
+unsigned int FindBlockIndex(const unsigned short* blocks, unsigned short index, unsigned short* matches) {
+    unsigned int count = 0;
+
+#if defined(BEDROCK_FORMAT_SSE2)
+    const __m128i needle = _mm_set1_epi16((short)index);
+
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i += 16) {
+        __m128i low = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)(blocks + i)), needle);
+        __m128i high = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)(blocks + i + 8)), needle);
+
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_packs_epi16(low, high));
+        for(unsigned int j = 0; mask != 0; j++, mask >>= 1) {
+            if(mask & 1) matches[count++] = (unsigned short)(i + j);
+        }
+    }
+#else
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i++) {
+        if(blocks[i] == index) matches[count++] = (unsigned short)i;
+    }
+#endif
+
+    return count;
+}
+
+/// @brief Turns the palette indices of a subchunk into a bitmask using a truth table over the palette
+/// @param blocks Array of 4096 indices in XZY order
+/// @param table Truth table with one entry per palette index, non-zero if blocks using the index should be set
+/// @param paletteSize Amount of entries in the truth table, every index in blocks has to be smaller
+/// @param bits Array of 64 words the mask is written into, bit i % 64 of word i / 64 belongs to block i
+/// @attention When SSE2 is available and only a few palette entries are true (or false), eight indices are
+///            compared against each of them at once, otherwise the table is looked up per block
+void BuildBlockIndexMask(const unsigned short* blocks, const unsigned char* table, unsigned int paletteSize, unsigned long long* bits) {
+    unsigned int trueCount = 0;
+    for(unsigned int i = 0; i < paletteSize; i++) {
+        if(table[i]) trueCount++;
+    }
+
+    if(trueCount == 0 || trueCount == paletteSize) {
+        memset(bits, trueCount == 0 ? 0 : 0xFF, SUBCHUNK_BLOCK_COUNT / 8);
+        return;
+    }
+
+#if defined(BEDROCK_FORMAT_SSE2)
+    // Compare against whichever side of the table is smaller and invert the mask if that was the false side
+    int wanted = trueCount * 2 <= paletteSize;
+    unsigned int selectedCount = wanted ? trueCount : paletteSize - trueCount;
+
+    if(selectedCount <= BLOCK_MASK_MAX_COMPARES) {
+        unsigned short selected[BLOCK_MASK_MAX_COMPARES];
+        selectedCount = 0;
+        for(unsigned int i = 0; i < paletteSize; i++) {
+            if((table[i] != 0) == wanted) selected[selectedCount++] = (unsigned short)i;
+        }
+
+        unsigned long long invert = wanted ? 0 : ~0ull;
+        for(unsigned int word = 0; word < SUBCHUNK_BLOCK_COUNT / 64; word++) {
+            unsigned long long value = 0;
+
+            for(unsigned int group = 0; group < 4; group++) {
+                const unsigned short* base = blocks + word * 64 + group * 16;
+                __m128i low = _mm_loadu_si128((const __m128i*)base);
+                __m128i high = _mm_loadu_si128((const __m128i*)(base + 8));
+                __m128i lowMatch = _mm_setzero_si128();
+                __m128i highMatch = _mm_setzero_si128();
+
+                for(unsigned int i = 0; i < selectedCount; i++) {
+                    __m128i needle = _mm_set1_epi16((short)selected[i]);
+                    lowMatch = _mm_or_si128(lowMatch, _mm_cmpeq_epi16(low, needle));
+                    highMatch = _mm_or_si128(highMatch, _mm_cmpeq_epi16(high, needle));
+                }
+
+                unsigned long long mask = (unsigned int)_mm_movemask_epi8(_mm_packs_epi16(lowMatch, highMatch));
+                value |= mask << (group * 16);
+            }
+
+            bits[word] = value ^ invert;
+        }
+        return;
+    }
+#endif
+
+    for(unsigned int word = 0; word < SUBCHUNK_BLOCK_COUNT / 64; word++) {
+        const unsigned short* base = blocks + word * 64;
+        unsigned long long value = 0;
+
+        for(unsigned int i = 0; i < 64; i++) {
+            value |= (unsigned long long)(table[base[i]] != 0) << i;
+        }
+        bits[word] = value;
+    }
+}
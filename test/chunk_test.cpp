@@ -0,0 +1,221 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "test_helpers.h"
+
+extern "C" {
+    #include "BedrockFormat/binary.h"
+    #include "BedrockFormat/registry.h"
+}
+
+static const unsigned char widths[] = { 1, 2, 3, 4, 5, 6, 8, 16 };
+
+/// @brief Interns the entries of a palette and returns their runtime IDs
+static std::vector<unsigned int> InternPalette(const std::vector<std::string>& palette) {
+    std::vector<unsigned int> ids;
+    for(const auto& entry : palette) {
+        ByteStream stream;
+        InitByteStream(&stream, reinterpret_cast<const unsigned char*>(entry.data()), (unsigned int)entry.size());
+        stream.position = 3; // Skip tag type and name
+
+        unsigned int id;
+        CHECK(InternBlockState(&stream, &id) == SUCCESS);
+        ids.push_back(id);
+    }
+    return ids;
+}
+
+/// @brief Decodes a subchunk value, the subchunk has to be freed with FreeSubchunk
+static Subchunk* Decode(const std::string& value, unsigned char y) {
+    Subchunk* subchunk = nullptr;
+    CHECK(DecodeSubchunkValue(
+            reinterpret_cast<const unsigned char*>(value.data()), (unsigned int)value.size(), 0, y, 0, OVERWORLD, &subchunk
+    ) == SUCCESS);
+    return subchunk;
+}
+
+/// @brief Checks that every block of a layer has the expected runtime ID
+static void CheckLayer(
+        Subchunk* subchunk, unsigned char layer,
+        const std::vector<unsigned short>& blocks, const std::vector<unsigned int>& ids
+) {
+    BlockStorage* storage;
+    CHECK(GetSubchunkLayer(subchunk, layer, &storage) == SUCCESS);
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i++) {
+        CHECK(GetBlockStorageId(storage, i) == ids[blocks[i]]);
+    }
+}
+
+/// @brief Encodes a subchunk and checks that decoding the result gives the same blocks
+static std::string EncodeAndDecode(
+        Subchunk* subchunk, const std::vector<unsigned short>& blocks, const std::vector<unsigned int>& ids
+) {
+    SubchunkEncoder* encoder = new SubchunkEncoder();
+    InitSubchunkEncoder(encoder);
+    CHECK(EncodeSubchunk(encoder, subchunk) == SUCCESS);
+    std::string encoded(reinterpret_cast<const char*>(encoder->buffer), encoder->length);
+    DestroySubchunkEncoder(encoder);
+    delete encoder;
+
+    Subchunk* decoded = Decode(encoded, subchunk->position.y);
+    CHECK(decoded->layerCount == subchunk->layerCount);
+    CHECK(decoded->storage.bitsPerBlock == subchunk->storage.bitsPerBlock);
+    CheckLayer(decoded, 0, blocks, ids);
+    FreeSubchunk(nullptr, decoded);
+    return encoded;
+}
+
+/// @brief Every width survives a decode and encode cycle, values that are already minimal are written back unchanged
+static void TestRoundTripEveryWidth() {
+    for(unsigned char bitsPerBlock : widths) {
+        unsigned int paletteSize = bitsPerBlock == 16 ? 300 : 1u << bitsPerBlock;
+        std::vector<std::string> palette = MakePalette(paletteSize);
+        std::vector<unsigned int> ids = InternPalette(palette);
+        std::vector<unsigned short> blocks = MakeBlocks(paletteSize, bitsPerBlock);
+
+        for(unsigned char version : { 1, 8, 9 }) {
+            std::string value = MakeSubchunk(version, 4, { MakeBlockStorage(blocks, bitsPerBlock, palette) });
+
+            Subchunk* subchunk = Decode(value, 4);
+            CHECK(subchunk->version == version);
+            CHECK(subchunk->storage.paletteSize == paletteSize);
+            CHECK(subchunk->storage.bitsPerBlock == GetMinimalBitsPerBlock(paletteSize));
+            CheckLayer(subchunk, 0, blocks, ids);
+
+            std::string encoded = EncodeAndDecode(subchunk, blocks, ids);
+            if(version != 1 && bitsPerBlock == GetMinimalBitsPerBlock(paletteSize)) {
+                CHECK(encoded == value);
+            }
+            FreeSubchunk(nullptr, subchunk);
+        }
+    }
+}
+
+/// @brief Palette entries no block uses are dropped and the width shrinks to fit the remaining ones
+static void TestRoundTripUnusedPaletteEntries() {
+    std::vector<std::string> palette = MakePalette(40);
+    std::vector<unsigned int> ids = InternPalette(palette);
+    std::vector<unsigned short> blocks = MakeBlocks(3, 5);
+
+    Subchunk* subchunk = Decode(MakeSubchunk(8, 0, { MakeBlockStorage(blocks, 8, palette) }), 0);
+    CHECK(subchunk->storage.paletteSize == 40 && subchunk->storage.bitsPerBlock == 2);
+
+    std::string encoded = EncodeAndDecode(subchunk, blocks, ids);
+    CHECK((unsigned char)encoded[2] >> 1 == 2);
+    FreeSubchunk(nullptr, subchunk);
+}
+
+/// @brief The layers after the first are kept as they are and still decode after a round trip
+static void TestRoundTripMultipleLayers() {
+    std::vector<std::string> palette = MakePalette(5);
+    std::vector<unsigned int> ids = InternPalette(palette);
+    std::vector<unsigned short> blocks = MakeBlocks(5, 11);
+
+    std::vector<std::string> water = { MakeBlockState("minecraft:air", -1), MakeBlockState("minecraft:water", -1) };
+    std::vector<unsigned int> waterIds = InternPalette(water);
+    std::vector<unsigned short> waterBlocks = MakeBlocks(2, 12);
+
+    for(unsigned char version : { 8, 9 }) {
+        std::string value = MakeSubchunk(version, 250, {
+            MakeBlockStorage(blocks, 3, palette),
+            MakeBlockStorage(waterBlocks, 1, water),
+            MakeBlockStorage(blocks, 4, palette)
+        });
+
+        Subchunk* subchunk = Decode(value, 250);
+        CHECK(subchunk->layerCount == 3);
+        CheckLayer(subchunk, 1, waterBlocks, waterIds);
+
+        std::string encoded = EncodeAndDecode(subchunk, blocks, ids);
+        CHECK(encoded == value);
+        if(version == 9) CHECK((unsigned char)encoded[2] == 250);
+
+        Subchunk* decoded = Decode(encoded, 250);
+        CheckLayer(decoded, 1, waterBlocks, waterIds);
+        CheckLayer(decoded, 2, blocks, ids);
+        FreeSubchunk(nullptr, decoded);
+        FreeSubchunk(nullptr, subchunk);
+    }
+}
+
+/// @brief Storages with a width of 0 have a single implied palette entry and no palette size
+static void TestDecodeUniformStorage() {
+    std::vector<std::string> palette = { MakeBlockState("minecraft:stone", -1) };
+    std::vector<unsigned int> ids = InternPalette(palette);
+    std::vector<unsigned short> blocks(SUBCHUNK_BLOCK_COUNT, 0);
+
+    // Width byte followed directly by the palette entry
+    std::string storage(1, '\0');
+    storage += palette[0];
+    CHECK(MakeBlockStorage(blocks, 0, palette) == storage);
+
+    for(unsigned char version : { 1, 8, 9 }) {
+        std::string value = MakeSubchunk(version, 3, { storage });
+
+        Subchunk* subchunk = Decode(value, 3);
+        CHECK(subchunk->storage.paletteSize == 1 && subchunk->storage.bitsPerBlock == 0);
+        CheckLayer(subchunk, 0, blocks, ids);
+
+        std::string encoded = EncodeAndDecode(subchunk, blocks, ids);
+        if(version != 1) CHECK(encoded == value);
+        FreeSubchunk(nullptr, subchunk);
+    }
+
+    // Uniform layers in front of other layers are skipped without reading a palette size
+    std::vector<std::string> water = { MakeBlockState("minecraft:air", -1), MakeBlockState("minecraft:water", -1) };
+    std::vector<unsigned int> waterIds = InternPalette(water);
+    std::vector<unsigned short> waterBlocks = MakeBlocks(2, 7);
+    std::string value = MakeSubchunk(9, 3, { storage, storage, MakeBlockStorage(waterBlocks, 1, water) });
+
+    Subchunk* layered = Decode(value, 3);
+    CHECK(layered->layerCount == 3);
+    CheckLayer(layered, 1, blocks, ids);
+    CheckLayer(layered, 2, waterBlocks, waterIds);
+    CHECK(EncodeAndDecode(layered, blocks, ids) == value);
+    FreeSubchunk(nullptr, layered);
+
+    // The palette entry is required, the width byte alone is truncated
+    std::string truncated = MakeSubchunk(8, 0, { std::string(1, '\0') });
+    Subchunk* subchunk = nullptr;
+    CHECK(BF_FAILED(DecodeSubchunkValue(
+            reinterpret_cast<const unsigned char*>(truncated.data()), (unsigned int)truncated.size(), 0, 0, 0, OVERWORLD, &subchunk
+    )));
+}
+
+/// @brief Truncated values and out of range palette indices are rejected instead of being read past their end
+static void TestRejectCorruptValues() {
+    std::vector<std::string> palette = MakePalette(4);
+    std::string value = MakeSubchunk(8, 0, { MakeBlockStorage(MakeBlocks(4, 2), 2, palette) });
+
+    for(size_t length : { (size_t)2, (size_t)100, value.size() - 1 }) {
+        Subchunk* subchunk = nullptr;
+        CHECK(BF_FAILED(DecodeSubchunkValue(
+                reinterpret_cast<const unsigned char*>(value.data()), (unsigned int)length, 0, 0, 0, OVERWORLD, &subchunk
+        )));
+    }
+
+    // A palette of 3 entries cannot be indexed by index 3
+    std::string outOfRange = MakeSubchunk(8, 0, { MakeBlockStorage(MakeBlocks(4, 2), 2, MakePalette(3)) });
+    Subchunk* subchunk = nullptr;
+    CHECK(DecodeSubchunkValue(
+            reinterpret_cast<const unsigned char*>(outOfRange.data()), (unsigned int)outOfRange.size(), 0, 0, 0, OVERWORLD, &subchunk
+    ) == INVALID_DATA);
+}
+
+int main() {
+    TestRoundTripEveryWidth();
+    TestRoundTripUnusedPaletteEntries();
+    TestRoundTripMultipleLayers();
+    TestDecodeUniformStorage();
+    TestRejectCorruptValues();
+    return 0;
+}
@@ -0,0 +1,492 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "test_helpers.h"
+
+extern "C" {
+    #include "BedrockFormat/binary.h"
+    #include "BedrockFormat/nbt.h"
+    #include "BedrockFormat/query.h"
+}
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+/// @brief Appends the type and name of a compound entry
+static void AppendNbtKey(std::string& value, enum NbtTagType type, const std::string& name) {
+    value.push_back((char)type);
+    AppendNbtString(value, name);
+}
+
+/// @brief Creates a named compound with every tag type, lists of scalars and compounds and nested compounds
+/// @attention Compounds begin in the order root, states[0], states[1], nested, nested.inner and lists in the order
+///            empty, numbers, states
+static std::string MakeDocument() {
+    std::string value;
+    AppendNbtKey(value, NBT_COMPOUND, "root");
+
+    AppendNbtKey(value, NBT_BYTE, "byte");
+    value.push_back(7);
+    AppendNbtKey(value, NBT_SHORT, "short");
+    value += "\x34\x12";
+    AppendNbtKey(value, NBT_INT, "int");
+    AppendInt(value, 123456);
+    AppendNbtKey(value, NBT_LONG, "long");
+    AppendInt(value, 1);
+    AppendInt(value, 2);
+    AppendNbtKey(value, NBT_FLOAT, "float");
+    AppendInt(value, 0x3F800000);
+    AppendNbtKey(value, NBT_DOUBLE, "double");
+    AppendInt(value, 0);
+    AppendInt(value, 0x3FF00000);
+    AppendNbtKey(value, NBT_STRING, "string");
+    AppendNbtString(value, "minecraft:stone");
+
+    AppendNbtKey(value, NBT_BYTE_ARRAY, "bytes");
+    AppendInt(value, 3);
+    value += "abc";
+    AppendNbtKey(value, NBT_INT_ARRAY, "ints");
+    AppendInt(value, 2);
+    AppendInt(value, 5);
+    AppendInt(value, 6);
+    AppendNbtKey(value, NBT_LONG_ARRAY, "longs");
+    AppendInt(value, 1);
+    AppendInt(value, 8);
+    AppendInt(value, 0);
+
+    AppendNbtKey(value, NBT_LIST, "empty");
+    value.push_back(NBT_END);
+    AppendInt(value, 0);
+    AppendNbtKey(value, NBT_LIST, "numbers");
+    value.push_back(NBT_INT);
+    AppendInt(value, 3);
+    for(unsigned int number : { 10, 20, 30 }) AppendInt(value, number);
+    AppendNbtKey(value, NBT_LIST, "states");
+    value.push_back(NBT_COMPOUND);
+    AppendInt(value, 2);
+    for(unsigned int color = 0; color < 2; color++) {
+        AppendNbtKey(value, NBT_STRING, "name");
+        AppendNbtString(value, "minecraft:wool");
+        AppendNbtKey(value, NBT_INT, "color");
+        AppendInt(value, color);
+        value.push_back(NBT_END);
+    }
+
+    AppendNbtKey(value, NBT_COMPOUND, "nested");
+    AppendNbtKey(value, NBT_COMPOUND, "inner");
+    AppendNbtKey(value, NBT_STRING, "name");
+    AppendNbtString(value, "deep");
+    value.push_back(NBT_END);
+    AppendNbtKey(value, NBT_INT, "after");
+    AppendInt(value, 9);
+    value.push_back(NBT_END);
+
+    AppendNbtKey(value, NBT_INT, "last");
+    AppendInt(value, 42);
+    value.push_back(NBT_END);
+    return value;
+}
+
+/// @brief Visitor state that records every event and decides what each handler returns
+struct VisitRecorder {
+    std::vector<std::string> events;
+    std::string skipKey;
+    std::string stopKey;
+    unsigned int skipCompound = 0; // Position of the compound or list to act on, counted from 1, 0 for none
+    unsigned int stopCompound = 0;
+    unsigned int skipList = 0;
+    unsigned int stopList = 0;
+    unsigned int compoundCount = 0;
+    unsigned int listCount = 0;
+
+    size_t Count(const std::string& event) const {
+        return (size_t)std::count(events.begin(), events.end(), event);
+    }
+
+    bool Has(const std::string& event) const {
+        return Count(event) != 0;
+    }
+};
+
+static NbtVisitResult RecordKey(void* userData, enum NbtTagType, const char* name, unsigned int nameLength) {
+    auto recorder = static_cast<VisitRecorder*>(userData);
+    std::string key(name, nameLength);
+    recorder->events.push_back("key " + key);
+    if(key == recorder->stopKey) return NBT_VISIT_STOP;
+    return key == recorder->skipKey ? NBT_VISIT_SKIP : NBT_VISIT_CONTINUE;
+}
+
+static NbtVisitResult RecordBeginCompound(void* userData) {
+    auto recorder = static_cast<VisitRecorder*>(userData);
+    recorder->events.push_back("{");
+    recorder->compoundCount++;
+    if(recorder->compoundCount == recorder->stopCompound) return NBT_VISIT_STOP;
+    return recorder->compoundCount == recorder->skipCompound ? NBT_VISIT_SKIP : NBT_VISIT_CONTINUE;
+}
+
+static NbtVisitResult RecordEndCompound(void* userData) {
+    static_cast<VisitRecorder*>(userData)->events.push_back("}");
+    return NBT_VISIT_CONTINUE;
+}
+
+static NbtVisitResult RecordBeginList(void* userData, enum NbtTagType, unsigned int count) {
+    auto recorder = static_cast<VisitRecorder*>(userData);
+    recorder->events.push_back("[" + std::to_string(count));
+    recorder->listCount++;
+    if(recorder->listCount == recorder->stopList) return NBT_VISIT_STOP;
+    return recorder->listCount == recorder->skipList ? NBT_VISIT_SKIP : NBT_VISIT_CONTINUE;
+}
+
+static NbtVisitResult RecordEndList(void* userData) {
+    static_cast<VisitRecorder*>(userData)->events.push_back("]");
+    return NBT_VISIT_CONTINUE;
+}
+
+static NbtVisitResult RecordScalar(void* userData, const NbtTag* value) {
+    static_cast<VisitRecorder*>(userData)->events.push_back("scalar " + std::to_string(value->type));
+    return NBT_VISIT_CONTINUE;
+}
+
+static NbtVisitResult RecordString(void* userData, const char* data, unsigned int length) {
+    static_cast<VisitRecorder*>(userData)->events.push_back("string " + std::string(data, length));
+    return NBT_VISIT_CONTINUE;
+}
+
+static NbtVisitResult RecordArray(void* userData, enum NbtTagType type, const unsigned char*, unsigned int count) {
+    static_cast<VisitRecorder*>(userData)->events.push_back(
+            "array " + std::to_string(type) + " " + std::to_string(count)
+    );
+    return NBT_VISIT_CONTINUE;
+}
+
+static const NbtVisitor recordingVisitor = {
+    RecordKey, RecordBeginCompound, RecordEndCompound, RecordBeginList, RecordEndList,
+    RecordScalar, RecordString, RecordArray
+};
+
+/// @brief Creates a stream over a value
+static ByteStream MakeStream(const std::string& value) {
+    ByteStream stream;
+    InitByteStream(&stream, reinterpret_cast<const unsigned char*>(value.data()), (unsigned int)value.size());
+    return stream;
+}
+
+/// @brief Visits a named tag and returns the position the stream ends at, -1 if the visit failed
+static long long Visit(const std::string& value, VisitRecorder& recorder) {
+    ByteStream stream = MakeStream(value);
+    return VisitNbt(&stream, &recordingVisitor, &recorder) ? (long long)stream.position : -1;
+}
+
+/// @brief Skips a named tag and returns the position the stream ends at, -1 if the data was rejected
+static long long Skip(const std::string& value) {
+    ByteStream stream = MakeStream(value);
+    stream.position = 1;
+    stream.position += 2 + (unsigned char)value[1];
+    return SkipNbtPayload(&stream, (enum NbtTagType)value[0]) ? (long long)stream.position : -1;
+}
+
+/// @brief Decodes a named compound and returns the position the stream ends at, -1 if the data was rejected
+static long long Decode(const std::string& value) {
+    ByteStream stream = MakeStream(value);
+    stream.position = 3 + (unsigned char)value[1];
+    NbtTag* tag = DecodeNbtCompound(&stream, nullptr);
+    if(tag == nullptr) return -1;
+
+    FreeNbtTag(tag, nullptr);
+    return (long long)stream.position;
+}
+
+/// @brief Skipping and visiting end where decoding ends and report every tag once
+static void TestVisitMatchesDecode() {
+    std::string value = MakeDocument();
+    CHECK(Decode(value) == (long long)value.size());
+    CHECK(Skip(value) == (long long)value.size());
+
+    VisitRecorder recorder;
+    CHECK(Visit(value, recorder) == (long long)value.size());
+    CHECK(recorder.Count("{") == 5 && recorder.Count("}") == 5);
+    CHECK(recorder.Count("[0") == 1 && recorder.Count("[3") == 1 && recorder.Count("[2") == 1 && recorder.Count("]") == 3);
+    CHECK(recorder.Count("scalar " + std::to_string(NBT_INT)) == 8);
+    CHECK(recorder.Has("string deep") && recorder.Has("array 11 2") && recorder.Has("array 12 1"));
+    CHECK(recorder.events.front() == "key root" && recorder.events[recorder.events.size() - 2] == "scalar 3");
+    CHECK(recorder.events.back() == "}");
+}
+
+/// @brief Skipped payloads and containers are not reported and the stream still ends where decoding ends
+static void TestVisitSkip() {
+    std::string value = MakeDocument();
+
+    VisitRecorder key;
+    key.skipKey = "nested";
+    CHECK(Visit(value, key) == (long long)value.size());
+    CHECK(key.Has("key nested") && !key.Has("key inner") && key.Has("key last"));
+
+    VisitRecorder root;
+    root.skipKey = "root";
+    CHECK(Visit(value, root) == (long long)value.size());
+    CHECK(root.events.size() == 1);
+
+    // The end handler of a skipped container is not called
+    VisitRecorder compound;
+    compound.skipCompound = 4;
+    CHECK(Visit(value, compound) == (long long)value.size());
+    CHECK(!compound.Has("key inner") && !compound.Has("key after") && compound.Has("key last"));
+    CHECK(compound.Count("{") == 4 && compound.Count("}") == 3);
+
+    VisitRecorder list;
+    list.skipList = 2;
+    CHECK(Visit(value, list) == (long long)value.size());
+    CHECK(list.Count("scalar " + std::to_string(NBT_INT)) == 5 && list.Count("]") == 2);
+    CHECK(list.Has("key color") && list.Has("key last"));
+}
+
+/// @brief Stopping ends the visit successfully without reporting anything after it
+static void TestVisitStop() {
+    std::string value = MakeDocument();
+
+    VisitRecorder key;
+    key.stopKey = "numbers";
+    CHECK(Visit(value, key) != -1);
+    CHECK(key.events.back() == "key numbers");
+
+    VisitRecorder compound;
+    compound.stopCompound = 2;
+    CHECK(Visit(value, compound) != -1);
+    CHECK(compound.events.back() == "{" && !compound.Has("key name"));
+
+    VisitRecorder list;
+    list.stopList = 3;
+    CHECK(Visit(value, list) != -1);
+    CHECK(list.events.back() == "[2" && !list.Has("key color"));
+}
+
+/// @brief Negative, oversized and truncated counts are rejected by every reader
+static void TestRejectInvalidCounts() {
+    std::vector<std::string> payloads;
+
+    std::string negativeList(1, NBT_INT);
+    AppendInt(negativeList, 0xFFFFFFFF);
+    payloads.push_back(negativeList);
+
+    std::string oversizedList(1, NBT_LONG);
+    AppendInt(oversizedList, 0x7FFFFFFF);
+    payloads.push_back(oversizedList);
+
+    std::string truncatedList(1, NBT_COMPOUND);
+    AppendInt(truncatedList, 2);
+    truncatedList.push_back(NBT_END);
+    payloads.push_back(truncatedList);
+
+    std::string endList(1, NBT_END);
+    AppendInt(endList, 1);
+    payloads.push_back(endList);
+
+    for(const std::string& payload : payloads) {
+        std::string value;
+        AppendNbtKey(value, NBT_COMPOUND, "root");
+        AppendNbtKey(value, NBT_LIST, "list");
+        value += payload;
+        value.push_back(NBT_END);
+
+        VisitRecorder recorder;
+        CHECK(Decode(value) == -1 && Skip(value) == -1 && Visit(value, recorder) == -1);
+    }
+
+    for(enum NbtTagType type : { NBT_BYTE_ARRAY, NBT_INT_ARRAY, NBT_LONG_ARRAY }) {
+        for(unsigned int count : { 0xFFFFFFFFu, 0x7FFFFFFFu, 2u }) {
+            std::string value;
+            AppendNbtKey(value, NBT_COMPOUND, "root");
+            AppendNbtKey(value, type, "array");
+            AppendInt(value, count);
+            value.push_back(1);
+            value.push_back(NBT_END);
+
+            VisitRecorder recorder;
+            CHECK(Decode(value) == -1 && Skip(value) == -1 && Visit(value, recorder) == -1);
+        }
+    }
+}
+
+/// @brief Creates a compound holding lists nested depth levels deep
+static std::string MakeNestedLists(unsigned int depth) {
+    std::string value;
+    AppendNbtKey(value, NBT_COMPOUND, "root");
+    AppendNbtKey(value, NBT_LIST, "lists");
+    for(unsigned int i = 0; i < depth; i++) {
+        value.push_back(NBT_LIST);
+        AppendInt(value, 1);
+    }
+    value.push_back(NBT_END);
+    AppendInt(value, 0);
+    value.push_back(NBT_END);
+    return value;
+}
+
+/// @brief Data nested deeper than MAX_NBT_DEPTH is rejected by every reader, data below it is read to the end
+static void TestDepthLimit() {
+    std::string shallow = MakeNestedLists(MAX_NBT_DEPTH - 10);
+    VisitRecorder recorder;
+    CHECK(Decode(shallow) == (long long)shallow.size());
+    CHECK(Skip(shallow) == (long long)shallow.size());
+    CHECK(Visit(shallow, recorder) == (long long)shallow.size());
+
+    std::string deep = MakeNestedLists(MAX_NBT_DEPTH + 10);
+    CHECK(Decode(deep) == -1 && Skip(deep) == -1 && Visit(deep, recorder) == -1);
+}
+
+/// @brief Runs an expression against the payload of a named compound and reads the scalar it matches
+static bool QueryScalar(const unsigned char* data, size_t length, const char* expression, NbtTag* value) {
+    NbtPath* path = CompileNbtPath(expression);
+    CHECK(path != nullptr);
+
+    ByteStream stream;
+    InitByteStream(&stream, data, (unsigned int)length);
+    stream.position = length > 1 ? std::min<unsigned int>(3 + data[1], (unsigned int)length) : (unsigned int)length;
+    bool found = QueryNbtScalar(&stream, NBT_COMPOUND, path, value) != 0;
+
+    FreeNbtPath(path);
+    return found;
+}
+
+/// @brief Runs an expression against the payload of a named compound and retrieves the string it matches
+static bool QueryString(const unsigned char* data, size_t length, const char* expression, std::string* value) {
+    NbtPath* path = CompileNbtPath(expression);
+    CHECK(path != nullptr);
+
+    ByteStream stream;
+    InitByteStream(&stream, data, (unsigned int)length);
+    stream.position = length > 1 ? std::min<unsigned int>(3 + data[1], (unsigned int)length) : (unsigned int)length;
+    NbtString string;
+    bool found = QueryNbtString(&stream, NBT_COMPOUND, path, &string) != 0;
+    if(found) value->assign(string.data, string.length);
+
+    FreeNbtPath(path);
+    return found;
+}
+
+/// @brief Paths find names, list elements and index steps that directly follow another step, in raw data and trees
+static void TestQueryPaths() {
+    std::string value = MakeDocument();
+    auto data = reinterpret_cast<const unsigned char*>(value.data());
+
+    NbtTag scalar;
+    CHECK(QueryScalar(data, value.size(), "int", &scalar) && GetNbtInt(&scalar) == 123456);
+    CHECK(QueryScalar(data, value.size(), "numbers[2]", &scalar) && GetNbtInt(&scalar) == 30);
+    CHECK(QueryScalar(data, value.size(), "states[1].color", &scalar) && GetNbtInt(&scalar) == 1);
+    CHECK(QueryScalar(data, value.size(), "nested.after", &scalar) && GetNbtInt(&scalar) == 9);
+    CHECK(QueryScalar(data, value.size(), "last", &scalar) && GetNbtInt(&scalar) == 42);
+
+    std::string string;
+    CHECK(QueryString(data, value.size(), "nested.inner.name", &string) && string == "deep");
+    CHECK(QueryString(data, value.size(), "\"states\"[0].\"name\"", &string) && string == "minecraft:wool");
+
+    // Missing names, indices past the end and steps into the wrong type do not match
+    CHECK(!QueryScalar(data, value.size(), "missing", &scalar));
+    CHECK(!QueryScalar(data, value.size(), "numbers[3]", &scalar));
+    CHECK(!QueryScalar(data, value.size(), "int[0]", &scalar));
+    CHECK(!QueryScalar(data, value.size(), "numbers.int", &scalar));
+    CHECK(!QueryScalar(data, value.size(), "string", &scalar));
+    CHECK(!QueryString(data, value.size(), "int", &string));
+
+    // Trees are queried the same way
+    ByteStream stream = MakeStream(value);
+    stream.position = 3 + (unsigned char)value[1];
+    NbtTag* tree = DecodeNbtCompound(&stream, nullptr);
+    CHECK(tree != nullptr);
+
+    NbtPath* path = CompileNbtPath("states[1].color");
+    CHECK(path != nullptr && path->stepCount == 3);
+    NbtTag* match = QueryNbtTag(tree, path);
+    CHECK(match != nullptr && GetNbtInt(match) == 1);
+    FreeNbtPath(path);
+
+    path = CompileNbtPath("");
+    CHECK(path != nullptr && path->stepCount == 0 && QueryNbtTag(tree, path) == tree);
+    FreeNbtPath(path);
+    FreeNbtTag(tree, nullptr);
+
+    // Quoted names can contain dots and brackets, index steps can follow each other
+    std::string quoted;
+    AppendNbtKey(quoted, NBT_COMPOUND, "");
+    AppendNbtKey(quoted, NBT_INT, "a.b[0]");
+    AppendInt(quoted, 5);
+    AppendNbtKey(quoted, NBT_LIST, "grid");
+    quoted.push_back(NBT_LIST);
+    AppendInt(quoted, 2);
+    for(unsigned int row = 0; row < 2; row++) {
+        quoted.push_back(NBT_INT);
+        AppendInt(quoted, 2);
+        AppendInt(quoted, row * 2);
+        AppendInt(quoted, row * 2 + 1);
+    }
+    quoted.push_back(NBT_END);
+    auto quotedData = reinterpret_cast<const unsigned char*>(quoted.data());
+
+    CHECK(QueryScalar(quotedData, quoted.size(), "\"a.b[0]\"", &scalar) && GetNbtInt(&scalar) == 5);
+    CHECK(!QueryScalar(quotedData, quoted.size(), "a.b[0]", &scalar));
+    CHECK(QueryScalar(quotedData, quoted.size(), "grid[1][0]", &scalar) && GetNbtInt(&scalar) == 2);
+    CHECK(QueryScalar(quotedData, quoted.size(), "grid[0][1]", &scalar) && GetNbtInt(&scalar) == 1);
+}
+
+/// @brief Malformed expressions are rejected when they are compiled
+static void TestRejectInvalidPaths() {
+    for(const char* expression : {
+            "a..b", "[", "\"x", "a.", ".a", "[]", "[1", "[a]", "a.[0]", "\"x\"y", "[99999999999]", "[2147483648]"
+    }) {
+        NbtPath* path = CompileNbtPath(expression);
+        if(path != nullptr) std::cerr << "Accepted " << expression << std::endl;
+        CHECK(path == nullptr);
+    }
+
+    NbtPath* path = CompileNbtPath("[2147483647]");
+    CHECK(path != nullptr && path->stepCount == 1 && path->steps[0].name == nullptr);
+    CHECK(path->steps[0].index == 0x7FFFFFFF);
+    FreeNbtPath(path);
+
+    path = CompileNbtPath("\"\"[0]");
+    CHECK(path != nullptr && path->stepCount == 2 && path->steps[0].nameLength == 0);
+    FreeNbtPath(path);
+}
+
+/// @brief Truncated data never matches a value that lies past its end and is never read past its end
+static void TestQueryTruncatedData() {
+    std::string value = MakeDocument();
+
+    for(size_t length = 0; length < value.size(); length++) {
+        // Copied into an allocation of the exact size, so reads past the end are caught by the sanitizers
+        std::unique_ptr<unsigned char[]> data(new unsigned char[length + (length == 0 ? 1 : 0)]);
+        memcpy(data.get(), value.data(), length);
+
+        NbtTag scalar;
+        if(QueryScalar(data.get(), length, "last", &scalar)) {
+            CHECK(length >= value.size() - 1 && GetNbtInt(&scalar) == 42);
+        }
+        if(QueryScalar(data.get(), length, "states[1].color", &scalar)) CHECK(GetNbtInt(&scalar) == 1);
+
+        std::string string;
+        if(QueryString(data.get(), length, "nested.inner.name", &string)) CHECK(string == "deep");
+        if(QueryString(data.get(), length, "string", &string)) CHECK(string == "minecraft:stone");
+    }
+}
+
+int main() {
+    TestVisitMatchesDecode();
+    TestVisitSkip();
+    TestVisitStop();
+    TestRejectInvalidCounts();
+    TestDepthLimit();
+    TestQueryPaths();
+    TestRejectInvalidPaths();
+    TestQueryTruncatedData();
+    return 0;
+}
@@ -0,0 +1,107 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "test_helpers.h"
+
+extern "C" {
+    #include "BedrockFormat/storage.h"
+}
+
+#include <cstring>
+
+static const unsigned char widths[] = { 1, 2, 3, 4, 5, 6, 8, 16 };
+
+/// @brief Packing and unpacking agree with the reference layout for every width Bedrock uses
+static void TestPackRoundTrip() {
+    for(unsigned char bitsPerBlock : widths) {
+        unsigned int paletteSize = bitsPerBlock >= 12 ? SUBCHUNK_BLOCK_COUNT : 1u << bitsPerBlock;
+        std::vector<unsigned short> blocks = MakeBlocks(paletteSize, bitsPerBlock);
+
+        // The reference storage starts with the width byte, the palette size follows the words
+        std::string reference = MakeBlockStorage(blocks, bitsPerBlock, std::vector<std::string>());
+        unsigned int wordBytes = GetBlockStorageWordCount(bitsPerBlock) * 4;
+        CHECK(reference.size() == 1 + wordBytes + 4);
+
+        std::vector<unsigned char> words(wordBytes, 0xFF);
+        PackBlockIndices(blocks.data(), bitsPerBlock, words.data());
+        CHECK(memcmp(words.data(), reference.data() + 1, wordBytes) == 0);
+
+        std::vector<unsigned short> unpacked(SUBCHUNK_BLOCK_COUNT);
+        CHECK(UnpackBlockIndices(words.data(), bitsPerBlock, unpacked.data()) == SUCCESS);
+        CHECK(unpacked == blocks);
+
+        BlockStorage storage = {};
+        storage.bitsPerBlock = bitsPerBlock;
+        storage.blocksPerWord = (unsigned char)(32 / bitsPerBlock);
+        storage.words = words.data();
+        for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i += 97) {
+            CHECK(GetBlockStorageIndex(&storage, i) == blocks[i]);
+        }
+    }
+}
+
+/// @brief Unused palette entries are dropped and the remaining indices keep pointing at the same runtime IDs
+static void TestCompactBlockIndices() {
+    std::vector<unsigned short> blocks(SUBCHUNK_BLOCK_COUNT);
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i++) {
+        blocks[i] = (unsigned short)(i % 3 == 0 ? 7 : (i % 3 == 1 ? 2 : 5));
+    }
+    std::vector<unsigned short> original = blocks;
+
+    unsigned int palette[8] = { 100, 101, 102, 103, 104, 105, 106, 107 };
+    CHECK(CompactBlockIndices(blocks.data(), palette, 8) == 3);
+    CHECK(palette[0] == 102 && palette[1] == 105 && palette[2] == 107);
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i++) {
+        CHECK(palette[blocks[i]] == 100u + original[i]);
+    }
+}
+
+/// @brief Every palette index is found exactly where it is stored
+static void TestFindBlockIndex() {
+    std::vector<unsigned short> blocks = MakeBlocks(13, 1);
+    std::vector<unsigned short> matches(SUBCHUNK_BLOCK_COUNT);
+    for(unsigned short index = 0; index < 14; index++) {
+        unsigned int count = FindBlockIndex(blocks.data(), index, matches.data());
+
+        unsigned int expected = 0;
+        for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i++) {
+            if(blocks[i] == index) CHECK(matches[expected++] == i);
+        }
+        CHECK(count == expected);
+    }
+}
+
+/// @brief The compare and table lookup paths of the mask builder produce the same bits
+static void TestBuildBlockIndexMask() {
+    const unsigned int paletteSize = 40;
+    std::vector<unsigned short> blocks = MakeBlocks(paletteSize, 3);
+
+    // All false, few true, few false and all true tables take different paths
+    for(unsigned int trueCount : { 0u, 1u, 3u, BLOCK_MASK_MAX_COMPARES + 1u, paletteSize - 2u, paletteSize }) {
+        unsigned char table[paletteSize] = {};
+        for(unsigned int i = 0; i < trueCount; i++) table[(i * 7) % paletteSize] = 1;
+
+        unsigned long long bits[SUBCHUNK_BLOCK_COUNT / 64];
+        BuildBlockIndexMask(blocks.data(), table, paletteSize, bits);
+        for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i++) {
+            CHECK(((bits[i / 64] >> (i % 64)) & 1) == table[blocks[i]]);
+        }
+    }
+}
+
+int main() {
+    TestPackRoundTrip();
+    TestCompactBlockIndices();
+    TestFindBlockIndex();
+    TestBuildBlockIndexMask();
+    return 0;
+}
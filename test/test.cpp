@@ -48,13 +48,13 @@ int main() {
 	std::cout << path << std::endl;
 
 	World* world;
-	Result result = OpenWorld(path.c_str(), &world);
+	Result result = OpenWorld(path.c_str(), NULL, &world);
 	if(BF_FAILED(result)) {
 	    return 1;
 	}
 
 	Position position = { 0, 6, 0, OVERWORLD };
-	NbtTag* block = GetBlockAtWorldPosition(world, &position);
+	const NbtTag* block = GetBlockAtWorldPosition(world, &position);
 
 	if(block != NULL) {
         PrintNbtTag(block);
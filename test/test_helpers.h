@@ -0,0 +1,190 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef BEDROCKFORMAT_TEST_HELPERS_H
+#define BEDROCKFORMAT_TEST_HELPERS_H
+
+extern "C" {
+    #include "BedrockFormat/format.h"
+    #include "BedrockFormat/chunk.h"
+}
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+#include <leveldb/db.h>
+#include <leveldb/options.h>
+#include <leveldb/zlib_compressor.h>
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+/// @brief Stops the test with the location of the failed condition
+#define CHECK(condition)                                                                                \
+    do {                                                                                                \
+        if(!(condition)) {                                                                              \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl;  \
+            std::exit(1);                                                                               \
+        }                                                                                               \
+    } while(0)
+
+/// @brief Appends a little endian integer to a value
+inline void AppendInt(std::string& value, unsigned int number) {
+    for(int i = 0; i < 4; i++) value.push_back((char)(number >> (i * 8)));
+}
+
+/// @brief Appends a length prefixed NBT string to a value
+inline void AppendNbtString(std::string& value, const std::string& string) {
+    value.push_back((char)(string.size() & 0xFF));
+    value.push_back((char)(string.size() >> 8));
+    value += string;
+}
+
+/// @brief Serializes a palette entry the way Bedrock stores it, an unnamed compound with a name and states
+/// @param name Name of the block
+/// @param color Value of the color state, negative to leave the states empty
+inline std::string MakeBlockState(const std::string& name, int color) {
+    std::string state;
+    state.push_back(NBT_COMPOUND);
+    AppendNbtString(state, "");
+
+    state.push_back(NBT_STRING);
+    AppendNbtString(state, "name");
+    AppendNbtString(state, name);
+
+    state.push_back(NBT_COMPOUND);
+    AppendNbtString(state, "states");
+    if(color >= 0) {
+        state.push_back(NBT_INT);
+        AppendNbtString(state, "color");
+        AppendInt(state, (unsigned int)color);
+    }
+    state.push_back(NBT_END);
+
+    state.push_back(NBT_INT);
+    AppendNbtString(state, "version");
+    AppendInt(state, 17959425);
+    state.push_back(NBT_END);
+    return state;
+}
+
+/// @brief Creates a palette of distinct block states, the first one is air
+inline std::vector<std::string> MakePalette(unsigned int size) {
+    std::vector<std::string> palette;
+    for(unsigned int i = 0; i < size; i++) {
+        palette.push_back(i == 0 ? MakeBlockState("minecraft:air", -1) : MakeBlockState("minecraft:wool", (int)i));
+    }
+    return palette;
+}
+
+/// @brief Creates pseudo random block indices that use every entry of a palette
+inline std::vector<unsigned short> MakeBlocks(unsigned int paletteSize, unsigned int seed) {
+    std::vector<unsigned short> blocks(SUBCHUNK_BLOCK_COUNT);
+    unsigned int state = seed * 2654435761u + 1;
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i++) {
+        state = state * 1103515245u + 12345u;
+        blocks[i] = (unsigned short)(i < paletteSize ? i : (state >> 16) % paletteSize);
+    }
+    return blocks;
+}
+
+/// @brief Serializes a block storage with the given width
+/// @attention Storages with a width of 0 are written the way the game writes them, without words and without a
+///            palette size, only the first palette entry is kept
+inline std::string MakeBlockStorage(
+        const std::vector<unsigned short>& blocks, unsigned char bitsPerBlock, const std::vector<std::string>& palette
+) {
+    std::string storage;
+    storage.push_back((char)(bitsPerBlock << 1));
+    if(bitsPerBlock == 0) return storage + palette[0];
+
+    unsigned int blocksPerWord = 32 / bitsPerBlock;
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i += blocksPerWord) {
+        unsigned int word = 0;
+        for(unsigned int j = 0; j < blocksPerWord && i + j < SUBCHUNK_BLOCK_COUNT; j++) {
+            word |= (unsigned int)blocks[i + j] << (j * bitsPerBlock);
+        }
+        AppendInt(storage, word);
+    }
+
+    AppendInt(storage, (unsigned int)palette.size());
+    for(const auto& entry : palette) storage += entry;
+    return storage;
+}
+
+/// @brief Serializes a subchunk value from its block storages
+inline std::string MakeSubchunk(unsigned char version, unsigned char y, const std::vector<std::string>& layers) {
+    std::string value;
+    value.push_back((char)version);
+    if(version != 1) value.push_back((char)layers.size());
+    if(version == 9) value.push_back((char)y);
+    for(const auto& layer : layers) value += layer;
+    return value;
+}
+
+/// @brief Generates the database key of a subchunk
+inline std::string MakeSubchunkKey(int x, unsigned char y, int z, Dimension dimension) {
+    unsigned char key[SUBCHUNK_KEY_MAX_LENGTH];
+    unsigned int keyLen = GenerateSubchunkKey(x, y, z, dimension, key);
+    return std::string(reinterpret_cast<const char*>(key), keyLen);
+}
+
+/// @brief Database in a temporary directory that is removed again when the test is done
+class TemporaryDatabase {
+public:
+    /// @param entries Keys and values the database is created with
+    explicit TemporaryDatabase(const std::map<std::string, std::string>& entries) {
+        static std::atomic<unsigned int> databaseCount{0};
+        path = std::filesystem::temp_directory_path() / ("BedrockFormatTest-"
+                + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count())
+                + "-" + std::to_string(databaseCount.fetch_add(1)));
+        std::filesystem::create_directories(path.parent_path());
+
+        leveldb::Options options;
+        options.create_if_missing = true;
+        options.compressors[0] = new leveldb::ZlibCompressorRaw(-1);
+
+        leveldb::DB* db = nullptr;
+        leveldb::Status status = leveldb::DB::Open(options, path.string(), &db);
+        CHECK(status.ok());
+        for(const auto& entry : entries) {
+            CHECK(db->Put(leveldb::WriteOptions(), entry.first, entry.second).ok());
+        }
+
+        delete db;
+        delete options.compressors[0];
+    }
+
+    ~TemporaryDatabase() {
+        std::error_code error;
+        std::filesystem::remove_all(path, error);
+    }
+
+    TemporaryDatabase(const TemporaryDatabase&) = delete;
+    TemporaryDatabase& operator=(const TemporaryDatabase&) = delete;
+
+    std::filesystem::path path;
+};
+
+#endif // BEDROCKFORMAT_TEST_HELPERS_H
@@ -0,0 +1,489 @@
+// Copyright (c) 2021 Pathfinders
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// * All advertising materials mentioning features or use of this software must display the following acknowledgement: This product includes software developed by Pathfinders and its contributors.
+// * Neither the name of Pathfinders nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "test_helpers.h"
+
+extern "C" {
+    #include "BedrockFormat/async.h"
+    #include "BedrockFormat/batch.h"
+    #include "BedrockFormat/box.h"
+    #include "BedrockFormat/cache.h"
+    #include "BedrockFormat/flush.h"
+    #include "BedrockFormat/mask.h"
+    #include "BedrockFormat/neighborhood.h"
+    #include "BedrockFormat/pipeline.h"
+    #include "BedrockFormat/presence.h"
+    #include "BedrockFormat/registry.h"
+    #include "BedrockFormat/search.h"
+}
+
+#include <fstream>
+
+/// @brief Blocks of the stone and water subchunks the test world is made of
+static const std::vector<unsigned short> stoneBlocks = MakeBlocks(4, 1);
+static const std::vector<unsigned short> waterBlocks = MakeBlocks(2, 2);
+
+/// @brief Palette of the first layer, index 1 is stone
+static std::vector<std::string> MakeStonePalette() {
+    return { MakeBlockState("minecraft:air", -1), MakeBlockState("minecraft:stone", -1),
+             MakeBlockState("minecraft:dirt", -1), MakeBlockState("minecraft:grass", -1) };
+}
+
+/// @brief Creates a world with eight overworld subchunks, a negative one among them, one nether subchunk and one
+///        end subchunk that is all stone
+static std::map<std::string, std::string> MakeWorldEntries() {
+    std::vector<std::string> water = { MakeBlockState("minecraft:air", -1), MakeBlockState("minecraft:water", -1) };
+    std::string value = MakeSubchunk(8, 0, {
+        MakeBlockStorage(stoneBlocks, 2, MakeStonePalette()),
+        MakeBlockStorage(waterBlocks, 1, water)
+    });
+
+    std::map<std::string, std::string> entries;
+    for(int i = 0; i < 4; i++) {
+        entries[MakeSubchunkKey(i, 0, -i, OVERWORLD)] = value;
+        entries[MakeSubchunkKey(i, 1, -i, OVERWORLD)] = value;
+    }
+    entries[MakeSubchunkKey(-3, (unsigned char)-4, 7, OVERWORLD)] = value;
+    entries[MakeSubchunkKey(5, 2, 5, NETHER)] = value;
+    entries[MakeSubchunkKey(2, 0, 2, END)] = MakeSubchunk(8, 0, {
+        MakeBlockStorage(std::vector<unsigned short>(SUBCHUNK_BLOCK_COUNT, 0), 0, { MakeBlockState("minecraft:stone", -1) })
+    });
+    entries["~local_player"] = "not a subchunk";
+    return entries;
+}
+
+/// @brief Counts how often a palette index is used
+static size_t CountIndex(const std::vector<unsigned short>& blocks, unsigned short index) {
+    size_t count = 0;
+    for(unsigned short block : blocks) count += block == index;
+    return count;
+}
+
+/// @brief Retrieves the runtime IDs of the stone palette, in the order the palette is stored in
+static std::vector<unsigned int> GetStonePaletteIds(World* world) {
+    Subchunk* subchunk;
+    CHECK(LoadSubchunk(world, &subchunk, 0, 0, 0, OVERWORLD) == SUCCESS);
+    return std::vector<unsigned int>(subchunk->storage.palette, subchunk->storage.palette + 4);
+}
+
+/// @brief Calculates the runtime ID of an overworld block from the layout of the test world
+static unsigned int GetExpectedBlockId(const std::vector<unsigned int>& palette, int x, int y, int z) {
+    int subchunkX = x >> 4, subchunkY = y >> 4, subchunkZ = z >> 4;
+    if(subchunkY < 0 || subchunkY > 1 || subchunkX < 0 || subchunkX > 3 || subchunkZ != -subchunkX) {
+        return INVALID_BLOCK_STATE_ID;
+    }
+    return palette[stoneBlocks[(unsigned int)((x & 15) * 256 + (z & 15) * 16 + (y & 15))]];
+}
+
+/// @brief Repeated loads hit the cache, pinned subchunks survive a budget that is too small for them
+static void TestChunkCache(World* world) {
+    ClearChunkCache(world);
+
+    Subchunk* first;
+    CHECK(LoadSubchunk(world, &first, 0, 0, 0, OVERWORLD) == SUCCESS);
+    Subchunk* again;
+    CHECK(LoadSubchunk(world, &again, 0, 0, 0, OVERWORLD) == SUCCESS);
+    CHECK(again == first);
+
+    Subchunk* missing;
+    CHECK(LoadSubchunk(world, &missing, 40, 0, 40, OVERWORLD) == SUBCHUNK_NOT_FOUND);
+
+    unsigned int loaded;
+    CHECK(LoadRegion(world, OVERWORLD, 0, -3, 3, 0, &loaded) == SUCCESS);
+    CHECK(loaded == 8);
+
+    ChunkCacheStats stats;
+    GetChunkCacheStats(world, &stats);
+    CHECK(stats.entryCount == 8 && stats.hits >= 1);
+
+    CHECK(PinSubchunk(world, first) == SUCCESS);
+    SetChunkCacheBudget(world, 1);
+    GetChunkCacheStats(world, &stats);
+    CHECK(stats.entryCount == 1 && stats.pinnedCount == 1);
+    CHECK(LoadSubchunk(world, &again, 0, 0, 0, OVERWORLD) == SUCCESS && again == first);
+
+    UnpinSubchunk(world, first);
+    GetChunkCacheStats(world, &stats);
+    CHECK(stats.entryCount == 0 && stats.size == 0);
+    SetChunkCacheBudget(world, DEFAULT_CHUNK_CACHE_BUDGET);
+}
+
+/// @brief Parallel loads run on the worker threads of the world, which outlive a single call
+static void TestParallelLoads(World* world) {
+    ClearChunkCache(world);
+    CHECK(StartPipelineWorkers(world, 2) == SUCCESS);
+    CHECK(StartPipelineWorkers(world, 2) == INVALID_ARGUMENT);
+    void* workers = world->pipelineWorkers;
+
+    PipelineOptions options;
+    InitPipelineOptions(&options);
+    options.threadCount = 3;
+    options.queueDepth = 2;
+
+    unsigned int loaded = 0;
+    CHECK(LoadRegionParallel(world, OVERWORLD, 0, -3, 3, 0, &options, &loaded) == SUCCESS);
+    CHECK(loaded == 8);
+
+    // Loads every tick reuse the same threads
+    std::vector<Position> positions;
+    for(int i = 0; i < 4; i++) positions.push_back({ i, 1, -i, OVERWORLD });
+    positions.push_back({ 40, 1, 40, OVERWORLD });
+    for(int tick = 0; tick < 20; tick++) {
+        ClearChunkCache(world);
+        CHECK(LoadSubchunksParallel(world, positions.data(), positions.size(), &options, &loaded) == SUCCESS);
+        CHECK(loaded == 4);
+    }
+    CHECK(world->pipelineWorkers == workers);
+
+    StopPipelineWorkers(world);
+    CHECK(world->pipelineWorkers == nullptr);
+    CHECK(LoadSubchunksParallel(world, positions.data(), positions.size(), &options, &loaded) == SUCCESS);
+    CHECK(world->pipelineWorkers != nullptr);
+}
+
+/// @brief The presence index knows every subchunk of the world and its bounds
+static void TestPresenceIndex(World* world) {
+    CHECK(BuildPresenceIndex(world) == SUCCESS);
+    CHECK(IsSubchunkPresent(world, 3, 1, -3, OVERWORLD));
+    CHECK(IsSubchunkPresent(world, -3, (unsigned char)-4, 7, OVERWORLD));
+    CHECK(!IsSubchunkPresent(world, 3, 2, -3, OVERWORLD));
+    CHECK(!IsSubchunkPresent(world, 5, 2, 5, OVERWORLD));
+    CHECK(IsColumnPresent(world, 5, 5, NETHER) && !IsColumnPresent(world, 5, 5, END));
+
+    PresenceStats stats;
+    CHECK(GetPresenceStats(world, OVERWORLD, &stats) == SUCCESS);
+    CHECK(stats.columnCount == 5 && stats.subchunkCount == 9);
+    CHECK(stats.minX == -3 && stats.maxX == 3 && stats.minZ == -3 && stats.maxZ == 7);
+    CHECK(stats.minY == -4 && stats.maxY == 1);
+
+    CHECK(GetPresenceStats(world, NETHER, &stats) == SUCCESS);
+    CHECK(stats.columnCount == 1 && stats.subchunkCount == 1);
+
+    Subchunk* missing;
+    CHECK(LoadSubchunk(world, &missing, 3, 2, -3, OVERWORLD) == SUBCHUNK_NOT_FOUND);
+}
+
+/// @brief Counts the blocks of the runs reported by ForEachBlockInBox that exist and checks that all are below y 0
+static int CountNegativeRuns(void* userData, const BlockRun* run) {
+    CHECK(run->y >= -2048 && run->y < 0);
+    if(run->subchunk != nullptr) {
+        CHECK(run->y >= -64 && run->y < -48);
+        *static_cast<size_t*>(userData) += run->length;
+    }
+    return 1;
+}
+
+/// @brief Boxes below y 0 reach the subchunks with a negative y byte
+static void TestNegativeBox(World* world) {
+    BlockBox box = { -48, -64, 112, -33, -49, 127 };
+    size_t count = 0;
+    CHECK(ForEachBlockInBox(world, OVERWORLD, &box, CountNegativeRuns, &count) == SUCCESS);
+    CHECK(count == SUBCHUNK_BLOCK_COUNT);
+
+    // Boxes reaching past the lowest subchunk are clamped instead of wrapping around to the top of the world
+    box.minY = -5000;
+    box.maxY = -2033;
+    CHECK(ForEachBlockInBox(world, OVERWORLD, &box, CountNegativeRuns, &count) == SUCCESS);
+    CHECK(count == SUBCHUNK_BLOCK_COUNT);
+}
+
+/// @brief Records the result of a background load
+static void RecordAsyncResult(void* userData, AsyncLoadId, Result result, Subchunk*) {
+    static_cast<std::vector<Result>*>(userData)->push_back(result);
+}
+
+/// @brief Background loads of subchunks the presence index knows not to exist finish without a worker
+static void TestAsyncLoads(World* world) {
+    ClearChunkCache(world);
+    std::vector<Result> results;
+
+    AsyncLoadId missing;
+    CHECK(LoadSubchunkAsync(world, 3, 2, -3, OVERWORLD, 0, RecordAsyncResult, &results, &missing) == SUCCESS);
+    CHECK(PollAsyncLoads(world) == 1);
+    CHECK(results.size() == 1 && results[0] == SUBCHUNK_NOT_FOUND);
+
+    AsyncLoadId present;
+    CHECK(LoadSubchunkAsync(world, 3, 1, -3, OVERWORLD, 0, RecordAsyncResult, &results, &present) == SUCCESS);
+    Subchunk* subchunk;
+    CHECK(WaitAsyncLoad(world, present, &subchunk) == SUCCESS && subchunk != nullptr);
+    CHECK(results.size() == 2 && results[1] == SUCCESS);
+}
+
+/// @brief Batched lookups of unsorted positions with duplicates keep the order of the positions
+static void TestBatchLookups(World* world) {
+    std::vector<unsigned int> palette = GetStonePaletteIds(world);
+
+    std::vector<Position> positions;
+    unsigned int state = 7;
+    for(unsigned int i = 0; i < 600; i++) {
+        state = state * 1103515245u + 12345u;
+        // Mostly blocks of the diagonal columns, the fifth column does not exist
+        int column = (int)((state >> 24) % 5);
+        int x = column * 16 + (int)((state >> 8) & 15);
+        int y = (int)((state >> 12) % 40);
+        int z = -column * 16 + (int)((state >> 18) & 15);
+        positions.push_back({ x, (unsigned char)y, z, OVERWORLD });
+    }
+    positions.insert(positions.end(), positions.rbegin(), positions.rbegin() + 100);
+    positions.push_back({ 17, 3, -17, OVERWORLD });
+    positions.push_back({ 17, 3, -17, NETHER });
+
+    PipelineOptions options;
+    InitPipelineOptions(&options);
+    options.threadCount = 2;
+
+    for(const PipelineOptions* pipeline : { (const PipelineOptions*)nullptr, (const PipelineOptions*)&options }) {
+        ClearChunkCache(world);
+        std::vector<unsigned int> ids(positions.size(), 7);
+        CHECK(GetBlockIds(world, positions.data(), positions.size(), pipeline, ids.data()) == SUCCESS);
+
+        ClearChunkCache(world);
+        std::vector<const NbtTag*> blocks(positions.size());
+        CHECK(GetBlocks(world, positions.data(), positions.size(), pipeline, blocks.data()) == SUCCESS);
+
+        size_t found = 0;
+        for(size_t i = 0; i < positions.size(); i++) {
+            const Position& position = positions[i];
+            unsigned int expected = position.dimension != OVERWORLD ? INVALID_BLOCK_STATE_ID
+                    : GetExpectedBlockId(palette, position.x, position.y, position.z);
+            CHECK(ids[i] == expected);
+            CHECK(blocks[i] == (expected == INVALID_BLOCK_STATE_ID ? nullptr : GetBlockState(expected)));
+            found += expected != INVALID_BLOCK_STATE_ID;
+        }
+        CHECK(found > 100 && found < positions.size());
+    }
+}
+
+/// @brief Matches stone and grass
+static int MatchStoneOrGrass(void*, unsigned int runtimeId, const NbtTag* state) {
+    char stone[] = "minecraft:stone";
+    char grass[] = "minecraft:grass";
+    return MatchBlockStateName(stone, runtimeId, state) || MatchBlockStateName(grass, runtimeId, state);
+}
+
+/// @brief Masks of uniform and packed layers agree with the blocks they were built from
+static void TestBlockMasks(World* world) {
+    char stone[] = "minecraft:stone";
+    char water[] = "minecraft:water";
+    BlockMask mask;
+
+    // The uniform end subchunk is entirely stone
+    Subchunk* uniform;
+    CHECK(LoadSubchunk(world, &uniform, 2, 0, 2, END) == SUCCESS && uniform->storage.bitsPerBlock == 0);
+    CHECK(ExtractBlockMask(uniform, 0, MatchBlockStateName, stone, &mask) == SUCCESS);
+    CHECK(CountBlockMasks(&mask, 1) == SUBCHUNK_BLOCK_COUNT);
+    CHECK(ExtractBlockMask(uniform, 0, MatchBlockStateName, water, &mask) == SUCCESS);
+    CHECK(CountBlockMasks(&mask, 1) == 0);
+    CHECK(ExtractBlockMask(uniform, 1, MatchBlockStateName, water, &mask) == INVALID_ARGUMENT);
+
+    Subchunk* subchunk;
+    CHECK(LoadSubchunk(world, &subchunk, 0, 1, 0, OVERWORLD) == SUCCESS);
+    CHECK(ExtractBlockMask(subchunk, 0, MatchStoneOrGrass, nullptr, &mask) == SUCCESS);
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i++) {
+        int expected = stoneBlocks[i] == 1 || stoneBlocks[i] == 3;
+        CHECK(TestBlockMask(&mask, (unsigned char)(i >> 8), (unsigned char)(i & 15), (unsigned char)((i >> 4) & 15)) == expected);
+    }
+    CHECK(CountBlockMasks(&mask, 1) == CountIndex(stoneBlocks, 1) + CountIndex(stoneBlocks, 3));
+
+    CHECK(ExtractBlockMask(subchunk, 1, MatchBlockStateName, water, &mask) == SUCCESS);
+    for(unsigned int i = 0; i < SUBCHUNK_BLOCK_COUNT; i++) {
+        CHECK(((mask.bits[i / 64] >> (i % 64)) & 1) == (waterBlocks[i] == 1 ? 1u : 0u));
+    }
+}
+
+/// @brief The padded view of a neighborhood holds the blocks of every neighbor that touches the center subchunk
+static void TestNeighborhood(World* world) {
+    std::vector<unsigned int> palette = GetStonePaletteIds(world);
+
+    PipelineOptions options;
+    InitPipelineOptions(&options);
+    options.threadCount = 2;
+
+    auto neighborhood = new SubchunkNeighborhood();
+    for(const PipelineOptions* pipeline : { (const PipelineOptions*)nullptr, (const PipelineOptions*)&options }) {
+        ClearChunkCache(world);
+        CHECK(LoadSubchunkNeighborhood(world, 1, 1, -1, OVERWORLD, pipeline, neighborhood) == SUCCESS);
+
+        unsigned int present = 0;
+        for(int dx = -1; dx <= 1; dx++) {
+            for(int dy = -1; dy <= 1; dy++) {
+                for(int dz = -1; dz <= 1; dz++) {
+                    bool exists = GetExpectedBlockId(palette, (1 + dx) * 16, (1 + dy) * 16, (-1 + dz) * 16)
+                            != INVALID_BLOCK_STATE_ID;
+                    CHECK((GetNeighborSubchunk(neighborhood, dx, dy, dz) != nullptr) == exists);
+                    present += exists;
+                }
+            }
+        }
+        CHECK(present == 6);
+
+        ChunkCacheStats stats;
+        GetChunkCacheStats(world, &stats);
+        CHECK(stats.pinnedCount == present);
+
+        for(int x = -1; x <= 16; x++) {
+            for(int y = -1; y <= 16; y++) {
+                for(int z = -1; z <= 16; z++) {
+                    unsigned int expected = GetExpectedBlockId(palette, 16 + x, 16 + y, -16 + z);
+                    CHECK(GetNeighborhoodBlockId(neighborhood, x, y, z) == expected);
+                }
+            }
+        }
+
+        // A face and a corner of existing neighbors, faces of missing ones
+        CHECK(GetNeighborhoodBlockId(neighborhood, 5, -1, 5) == palette[stoneBlocks[5 * 256 + 5 * 16 + 15]]);
+        CHECK(GetNeighborhoodBlockId(neighborhood, -1, -1, 16) == palette[stoneBlocks[15 * 256 + 0 * 16 + 15]]);
+        CHECK(GetNeighborhoodBlockId(neighborhood, 16, 5, -1) == palette[stoneBlocks[0 * 256 + 15 * 16 + 5]]);
+        CHECK(GetNeighborhoodBlockId(neighborhood, -1, 5, 5) == INVALID_BLOCK_STATE_ID);
+        CHECK(GetNeighborhoodBlockId(neighborhood, 5, 16, 5) == INVALID_BLOCK_STATE_ID);
+        CHECK(GetNeighborhoodBlockId(neighborhood, 16, 16, 16) == INVALID_BLOCK_STATE_ID);
+
+        // Released subchunks are no longer pinned and can be evicted
+        ReleaseSubchunkNeighborhood(neighborhood);
+        GetChunkCacheStats(world, &stats);
+        CHECK(stats.pinnedCount == 0);
+        ClearChunkCache(world);
+        GetChunkCacheStats(world, &stats);
+        CHECK(stats.entryCount == 0);
+    }
+
+    CHECK(LoadSubchunkNeighborhood(world, 1, 2, -1, OVERWORLD, nullptr, neighborhood) == SUBCHUNK_NOT_FOUND);
+    delete neighborhood;
+}
+
+/// @brief Collects every match reported by SearchBlocks
+static int CollectMatches(void* userData, const BlockMatch* matches, size_t count) {
+    auto found = static_cast<std::vector<BlockMatch>*>(userData);
+    found->insert(found->end(), matches, matches + count);
+    return 1;
+}
+
+/// @brief The search finds every block of a state in every layer and only in the requested dimension
+static void TestSearchBlocks(World* world) {
+    PipelineOptions options;
+    InitPipelineOptions(&options);
+    options.threadCount = 2;
+
+    char stone[] = "minecraft:stone";
+    std::vector<BlockMatch> found;
+    CHECK(SearchBlocks(world, OVERWORLD, MatchBlockStateName, stone, &options, CollectMatches, &found) == SUCCESS);
+    CHECK(found.size() == 9 * CountIndex(stoneBlocks, 1));
+    for(const BlockMatch& match : found) {
+        CHECK(match.layer == 0);
+        unsigned int index = (unsigned int)((match.x & 15) * 256 + (match.z & 15) * 16 + (match.y & 15));
+        CHECK(stoneBlocks[index] == 1);
+    }
+
+    char water[] = "minecraft:water";
+    found.clear();
+    CHECK(SearchBlocks(world, NETHER, MatchBlockStateName, water, &options, CollectMatches, &found) == SUCCESS);
+    CHECK(found.size() == CountIndex(waterBlocks, 1));
+    for(const BlockMatch& match : found) CHECK(match.layer == 1 && match.y >= 32 && match.y < 48);
+
+    // Uniform storages have no palette size, every block of them matches
+    found.clear();
+    CHECK(SearchBlocks(world, END, MatchBlockStateName, stone, &options, CollectMatches, &found) == SUCCESS);
+    CHECK(found.size() == SUBCHUNK_BLOCK_COUNT);
+    for(const BlockMatch& match : found) CHECK(match.layer == 0 && match.x >= 32 && match.x < 48 && match.y < 16);
+}
+
+/// @brief Edited subchunks are written back by FlushWorld and read back after the world is reopened
+static void TestFlushWorld(World** world, const std::string& path) {
+    Subchunk* subchunk;
+    CHECK(LoadSubchunk(*world, &subchunk, 1, 0, -1, OVERWORLD) == SUCCESS);
+
+    // Decoded palettes keep the order of the stored one
+    char grass[] = "minecraft:grass";
+    unsigned int grassId = subchunk->storage.palette[3];
+    CHECK(MatchBlockStateName(grass, grassId, GetBlockState(grassId)));
+
+    unsigned int index = SUBCHUNK_BLOCK_COUNT - 1;
+    while(stoneBlocks[index] == 3) index--;
+    unsigned char x = (unsigned char)(index >> 8), y = (unsigned char)(index & 15), z = (unsigned char)((index >> 4) & 15);
+
+    CHECK(SetBlockIdAtSubchunkPosition(*world, subchunk, x, y, z, grassId) == SUCCESS);
+    CHECK(subchunk->dirty);
+
+    FlushStats stats;
+    CHECK(FlushWorld(*world, nullptr, &stats) == SUCCESS);
+    CHECK(stats.subchunkCount == 1 && stats.batchCount == 1 && !subchunk->dirty);
+
+    CHECK(CloseWorld(*world) == SUCCESS);
+    CHECK(OpenWorld(path.c_str(), nullptr, world) == SUCCESS);
+    CHECK(LoadSubchunk(*world, &subchunk, 1, 0, -1, OVERWORLD) == SUCCESS);
+    CHECK(GetBlockIdAtSubchunkPosition(subchunk, x, y, z) == grassId);
+}
+
+/// @brief Counts the read-only mirrors next to a database directory
+static size_t CountMirrors(const std::filesystem::path& path) {
+    std::string prefix = path.filename().string() + "-mirror-";
+    size_t count = 0;
+    for(const auto& entry : std::filesystem::directory_iterator(path.parent_path())) {
+        count += entry.path().filename().string().compare(0, prefix.size(), prefix) == 0;
+    }
+    return count;
+}
+
+/// @brief Read-only worlds open a mirror next to the original while it is in use and remove it again
+static void TestReadOnlyWorld(const std::filesystem::path& path) {
+    // Mirrors nobody holds the lock of are left over from a crash
+    std::filesystem::path stale = path.parent_path() / (path.filename().string() + "-mirror-stale");
+    std::filesystem::create_directory(stale);
+    std::ofstream(stale / "LOCK").close();
+
+    World* world;
+    CHECK(OpenWorldReadOnly(path.string().c_str(), nullptr, &world) == SUCCESS && world->readOnly);
+    CHECK(!std::filesystem::exists(stale));
+    CHECK(CountMirrors(path) == 1);
+
+    // The mirror of a world that is still open is not stale
+    World* second;
+    CHECK(OpenWorldReadOnly(path.string().c_str(), nullptr, &second) == SUCCESS);
+    CHECK(CountMirrors(path) == 2);
+
+    Subchunk* subchunk;
+    CHECK(LoadSubchunk(world, &subchunk, 2, 1, -2, OVERWORLD) == SUCCESS);
+    CHECK(LoadSubchunk(second, &subchunk, 2, 1, -2, OVERWORLD) == SUCCESS);
+    CHECK(FlushWorld(world, nullptr, nullptr) == INVALID_ARGUMENT);
+    CHECK(CloseWorld(second) == SUCCESS);
+    CHECK(CloseWorld(world) == SUCCESS);
+    CHECK(CountMirrors(path) == 0);
+
+    // Missing worlds fail without leaving a mirror behind
+    std::filesystem::path missing = path.parent_path() / (path.filename().string() + "-missing");
+    world = nullptr;
+    CHECK(OpenWorldReadOnly(missing.string().c_str(), nullptr, &world) == DATABASE_OPEN_ERROR && world == nullptr);
+    CHECK(CountMirrors(missing) == 0);
+}
+
+int main() {
+    TemporaryDatabase database(MakeWorldEntries());
+    std::string path = database.path.string();
+
+    World* world;
+    CHECK(OpenWorld(path.c_str(), nullptr, &world) == SUCCESS);
+
+    TestReadOnlyWorld(database.path);
+    TestChunkCache(world);
+    TestParallelLoads(world);
+    TestPresenceIndex(world);
+    TestAsyncLoads(world);
+    TestSearchBlocks(world);
+    TestNegativeBox(world);
+    TestBatchLookups(world);
+    TestBlockMasks(world);
+    TestNeighborhood(world);
+    TestFlushWorld(&world, path);
+
+    CHECK(CloseWorld(world) == SUCCESS);
+    return 0;
+}